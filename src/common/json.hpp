@@ -16,6 +16,9 @@
  * limitations under the License.
  */
 
+#ifndef __JSON_HPP__
+#define __JSON_HPP__
+
 #include <iostream>
 #include <list>
 #include <map>
@@ -180,3 +183,5 @@ inline void render(std::ostream& out, const Array& array)
 }
 
 } // namespace JSON {
+
+#endif // __JSON_HPP__
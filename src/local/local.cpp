@@ -69,6 +69,7 @@ void registerOptions(Configurator* configurator)
 {
   Logging::registerOptions(configurator);
   Master::registerOptions(configurator);
+  SimpleAllocator::registerOptions(configurator);
   Slave::registerOptions(configurator);
   configurator->addOption<int>("num_slaves",
                                "Number of slaves to create for local cluster",
@@ -106,7 +107,7 @@ PID<Master> launch(const Configuration& conf, Allocator* _allocator)
 
   if (_allocator == NULL) {
     // Create default allocator, save it for deleting later.
-    _allocator = allocator = new SimpleAllocator();
+    _allocator = allocator = new SimpleAllocator(conf);
   } else {
     // TODO(benh): Figure out the behavior of allocator pointer and remove the
     // else block.
@@ -20,6 +20,7 @@
 #define __ALLOCATOR_HPP__
 
 #include "common/hashmap.hpp"
+#include "common/json.hpp"
 #include "common/resources.hpp"
 
 #include "master/master.hpp"
@@ -68,13 +69,38 @@ public:
       const SlaveID& slaveId,
       const Resources& resources) {}
 
+  // Whenever resources are allocated to a framework other than
+  // through an offer (e.g., the tasks that slaves and frameworks
+  // report when they re-register after a master failover) the master
+  // invokes this callback.
+  virtual void resourcesAllocated(
+      const FrameworkID& frameworkId,
+      const SlaveID& slaveId,
+      const Resources& resources) {}
+
   // Whenever a framework that has filtered resources want's to revive
   // offers for those resources the master invokes this callback.
   virtual void offersRevived(Framework* framework) {}
 
   virtual void timerTick() {}
 
+  // Allocators that batch their work have the master invoke this
+  // (from its own process) by delaying Master::allocate.
+  virtual void allocate() {}
+
+  // Adds the statistics of the allocator (if any) to the master's.
+  virtual void getStats(JSON::Object* object) {}
+
   virtual void gotUsage(const UsageMessage& usage) {}
+
+  // Whenever an executor exits or gets removed along with its
+  // framework (before frameworkRemoved) the master invokes this
+  // callback, also when an executor of an already removed framework
+  // exits (but not for the executors of removed slaves).
+  virtual void executorRemoved(
+      const FrameworkID& frameworkId,
+      const SlaveID& slaveId,
+      const ExecutorID& executorId) {}
 };
 
 } // namespace master {
@@ -44,6 +44,14 @@ const int32_t MAX_CPUS = 1000 * 1000;
 // Maximum amount of memory / machine.
 const int32_t MAX_MEM = 1024 * 1024 * Megabyte;
 
+// Minimum number of seconds between two allocations; the events in
+// between are handled in one batch.
+const double ALLOCATION_INTERVAL = 0.1;
+
+// Headroom kept above the estimated peak usage of a slave before its
+// allocated but unused resources are offered as revocable.
+const double OVERSUBSCRIPTION_MARGIN = 0.2;
+
 // Acceptable timeout for slave PONG.
 const double SLAVE_PONG_TIMEOUT = 15.0;
 
@@ -27,6 +27,7 @@
 #include "common/type_utils.hpp"
 #include "common/utils.hpp"
 
+#include "master/allocator.hpp"
 #include "master/http.hpp"
 #include "master/master.hpp"
 
@@ -205,16 +206,19 @@ Future<HttpResponse> stats(
   object.values["valid_status_updates"] = master.stats.validStatusUpdates;
   object.values["invalid_status_updates"] = master.stats.invalidStatusUpdates;
 
+  master.allocator->getStats(&object);
+
   // Get total and used (note, not offered) resources in order to
   // compute capacity of scalar resources.
   Resources totalResources;
   Resources usedResources;
-  Resources resourcesObservedUsed;
+  ObservedUsage observedUsage;
   foreach (Slave* slave, master.getActiveSlaves()) {
     totalResources += slave->info.resources();
     usedResources += slave->resourcesInUse;
-    resourcesObservedUsed += slave->resourcesObservedUsed;
+    observedUsage += slave->resourcesObservedUsed;
   }
+  Resources resourcesObservedUsed = observedUsage.resources();
 
   foreach (const Resource& resource, totalResources) {
     if (resource.type() == Value::SCALAR) {
@@ -59,6 +59,7 @@ int main(int argc, char **argv)
   Configurator configurator;
   Logging::registerOptions(&configurator);
   Master::registerOptions(&configurator);
+  SimpleAllocator::registerOptions(&configurator);
   configurator.addOption<int>("port", 'p', "Port to listen on", 5050);
   configurator.addOption<string>("ip", "IP address to listen on");
   configurator.addOption<string>("url", 'u', "URL used for leader election");
@@ -101,7 +102,7 @@ int main(int argc, char **argv)
     fatalerror("Could not chdir into %s", dirname(argv[0]));
   }
 
-  Allocator* allocator = new SimpleAllocator();
+  Allocator* allocator = new SimpleAllocator(conf);
 
   Master* master = new Master(allocator, conf);
   process::spawn(master);
@@ -407,6 +407,8 @@ void Master::initialize()
 
   install<UsageMessage>(&Master::updateUsage);
 
+  install<SlaveUsageMessage>(&Master::updateSlaveUsage);
+
   // Setup HTTP request handlers.
   route("vars", bind(&http::vars, cref(*this), params::_1));
   route("stats.json", bind(&http::json::stats, cref(*this), params::_1));
@@ -628,6 +630,8 @@ void Master::reregisterFramework(const FrameworkID& frameworkId,
       foreachvalue (Task* task, slave->tasks) {
         if (framework->id == task->framework_id()) {
           framework->addTask(task);
+          allocator->resourcesAllocated(
+              framework->id, slave->id, task->resources());
           // Also add the task's executor for resource accounting.
           if (!framework->hasExecutor(slave->id, task->executor_id())) {
             CHECK(slave->hasExecutor(framework->id, task->executor_id()));
@@ -1093,10 +1097,22 @@ void Master::exitedExecutor(const SlaveID& slaveId,
       // Remove executor from slave and framework.
       slave->removeExecutor(frameworkId, executorId);
       framework->removeExecutor(slave->id, executorId);
+      allocator->executorRemoved(frameworkId, slave->id, executorId);
 
       // TODO(benh): Send the framework it's executor's exit status?
       // Or maybe at least have something like
       // Scheduler::executorLost?
+    } else {
+      LOG(INFO) << "Executor " << executorId
+                << " of removed framework " << frameworkId
+                << " on slave " << slave->id
+                << " (" << slave->info.hostname() << ") "
+                << "exited with status " << status;
+
+      // The slave may have resources to offer again even though the
+      // executor got removed along with its framework.
+      slave->removeExecutor(frameworkId, executorId);
+      allocator->executorRemoved(frameworkId, slave->id, executorId);
     }
   }
 }
@@ -1148,6 +1164,12 @@ void Master::timerTick()
 }
 
 
+void Master::allocate()
+{
+  allocator->allocate();
+}
+
+
 void Master::frameworkFailoverTimeout(const FrameworkID& frameworkId,
                                       double reregisteredTime)
 {
@@ -1162,7 +1184,8 @@ void Master::frameworkFailoverTimeout(const FrameworkID& frameworkId,
 
 
 void Master::makeOffers(Framework* framework,
-                        const hashmap<Slave*, Resources>& offered)
+                        const hashmap<Slave*, Resources>& offered,
+                        bool revocable)
 {
   // Create an offer for each slave and add it to the message.
   ResourceOffersMessage message;
@@ -1176,6 +1199,10 @@ void Master::makeOffers(Framework* framework,
     offer->mutable_resources()->MergeFrom(resources);
     offer->mutable_attributes()->MergeFrom(slave->info.attributes());
 
+    if (revocable) {
+      offer->set_revocable(true);
+    }
+
     // Add all framework's executors running on this slave.
     if (slave->executors.contains(framework->id)) {
       const hashmap<ExecutorID, ExecutorInfo>& executors =
@@ -1196,6 +1223,7 @@ void Master::makeOffers(Framework* framework,
   }
 
   LOG(INFO) << "Sending " << message.offers().size()
+            << (revocable ? " revocable" : "")
             << " offers to framework " << framework->id;
 
   send(framework->pid, message);
@@ -1579,12 +1607,14 @@ void Master::removeFramework(Framework* framework)
     removeOffer(offer);
   }
 
-  // Remove the framework's executors for correct resource accounting.
+  // Remove the framework's executors for correct resource accounting,
+  // and tell the allocator that their resources are free again.
   foreachkey (const SlaveID& slaveId, framework->executors) {
     Slave* slave = getSlave(slaveId);
     if (slave != NULL) {
       foreachkey (const ExecutorID& executorId, framework->executors[slaveId]) {
         slave->removeExecutor(framework->id, executorId);
+        allocator->executorRemoved(framework->id, slaveId, executorId);
       }
     }
   }
@@ -1688,6 +1718,7 @@ void Master::readdSlave(Slave* slave,
     Framework* framework = getFramework(task.framework_id());
     if (framework != NULL) {
       framework->addTask(t);
+      allocator->resourcesAllocated(framework->id, slave->id, t->resources());
       UpdateFrameworkMessage message;
       message.mutable_framework_id()->MergeFrom(framework->id);
       message.set_pid(framework->pid);
@@ -1896,10 +1927,51 @@ SlaveID Master::newSlaveId()
 
 void Master::updateUsage(const UsageMessage& message) {
   Slave* slave = getSlave(message.slave_id());
-  if (slave && slave->active) {
+
+  // Usage may arrive after the executor (or its framework) is gone.
+  if (slave && slave->active &&
+      slave->hasExecutor(message.framework_id(), message.executor_id())) {
     slave->addUsageMessage(message);
+    allocator->gotUsage(message);
+  }
+}
+
+
+// Applies the usage of every executor in one pass, reusing a single
+// UsageMessage to hand each of them to the slave and the allocator.
+void Master::updateSlaveUsage(const SlaveUsageMessage& message)
+{
+  Slave* slave = getSlave(message.slave_id());
+
+  UsageMessage usage;
+  usage.mutable_slave_id()->MergeFrom(message.slave_id());
+
+  foreach (const ExecutorUsage& executor, message.executors()) {
+    usage.mutable_framework_id()->CopyFrom(executor.framework_id());
+    usage.mutable_executor_id()->CopyFrom(executor.executor_id());
+    usage.mutable_resources()->CopyFrom(executor.resources());
+    usage.set_timestamp(executor.timestamp());
+
+    if (executor.has_duration()) {
+      usage.set_duration(executor.duration());
+    } else {
+      usage.clear_duration();
+    }
+
+    if (executor.has_statistics()) {
+      usage.mutable_statistics()->CopyFrom(executor.statistics());
+    } else {
+      usage.clear_statistics();
+    }
+
+    usage.mutable_history()->CopyFrom(executor.history());
+
+    if (slave && slave->active &&
+        slave->hasExecutor(usage.framework_id(), usage.executor_id())) {
+      slave->addUsageMessage(usage);
+      allocator->gotUsage(usage);
+    }
   }
-  allocator->gotUsage(message);
 }
 
 } // namespace master {
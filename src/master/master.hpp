@@ -111,6 +111,7 @@ public:
                                 double reregisteredTime);
 
   void updateUsage(const UsageMessage& update);
+  void updateSlaveUsage(const SlaveUsageMessage& update);
 
   // Return connected frameworks that are not in the process of being removed
   std::vector<Framework*> getActiveFrameworks() const;
@@ -118,8 +119,13 @@ public:
   // Return connected slaves that are not in the process of being removed
   std::vector<Slave*> getActiveSlaves() const;
 
+  // Invokes Allocator::allocate.
+  void allocate();
+
+  // Revocable offers are marked as such (see Offer.revocable).
   void makeOffers(Framework* framework,
-                  const hashmap<Slave*, Resources>& offered);
+                  const hashmap<Slave*, Resources>& offered,
+                  bool revocable = false);
 
 protected:
   virtual void initialize();
@@ -236,6 +242,89 @@ private:
 };
 
 
+// Observed usage of the well-known scalar resources, kept as plain
+// numbers so that adding or subtracting the usage of an executor takes
+// constant time. Usage of any other resource is not tracked.
+struct ObservedUsage
+{
+  enum Dimension
+  {
+    CPUS,
+    MEM,
+    DISK,
+    DIMENSIONS
+  };
+
+  ObservedUsage()
+  {
+    clear();
+  }
+
+  explicit ObservedUsage(
+      const google::protobuf::RepeatedPtrField<Resource>& resources)
+  {
+    clear();
+    foreach (const Resource& resource, resources) {
+      if (resource.type() == Value::SCALAR) {
+        for (int i = 0; i < DIMENSIONS; i++) {
+          if (resource.name() == name((Dimension) i)) {
+            values[i] += resource.scalar().value();
+            break;
+          }
+        }
+      }
+    }
+  }
+
+  static const char* name(Dimension dimension)
+  {
+    static const char* names[DIMENSIONS] = { "cpus", "mem", "disk" };
+    return names[dimension];
+  }
+
+  void clear()
+  {
+    for (int i = 0; i < DIMENSIONS; i++) {
+      values[i] = 0;
+    }
+  }
+
+  ObservedUsage& operator += (const ObservedUsage& that)
+  {
+    for (int i = 0; i < DIMENSIONS; i++) {
+      values[i] += that.values[i];
+    }
+    return *this;
+  }
+
+  ObservedUsage& operator -= (const ObservedUsage& that)
+  {
+    for (int i = 0; i < DIMENSIONS; i++) {
+      values[i] -= that.values[i];
+    }
+    return *this;
+  }
+
+  // Only for the allocator and the endpoints, this is not cheap.
+  Resources resources() const
+  {
+    Resources result;
+    for (int i = 0; i < DIMENSIONS; i++) {
+      if (values[i] != 0) {
+        Resource resource;
+        resource.set_name(name((Dimension) i));
+        resource.set_type(Value::SCALAR);
+        resource.mutable_scalar()->set_value(values[i]);
+        result += resource;
+      }
+    }
+    return result;
+  }
+
+  double values[DIMENSIONS];
+};
+
+
 // A connected slave.
 struct Slave
 {
@@ -248,7 +337,8 @@ struct Slave
       pid(_pid),
       active(true),
       registeredTime(time),
-      lastHeartbeat(time) {}
+      lastHeartbeat(time),
+      executorsEstimated(0) {}
 
   ~Slave() {}
 
@@ -329,9 +419,9 @@ struct Slave
       resourcesInUse -= executors[frameworkId][executorId].resources();
       clearObservedUsageFor(frameworkId, executorId);
 
+      executors[frameworkId].erase(executorId);
       if (executors[frameworkId].size() == 0) {
 	executors.erase(frameworkId);
-        usageMessages.erase(frameworkId);
       }
     }
   }
@@ -339,19 +429,116 @@ struct Slave
   void clearObservedUsageFor(const FrameworkID& frameworkId,
                      const ExecutorID& executorId)
   {
-    if (usageMessages.count(frameworkId) > 0 &&
-        usageMessages[frameworkId].count(executorId) > 0) {
-      resourcesObservedUsed -=
-          usageMessages[frameworkId][executorId].resources();
-      usageMessages[frameworkId].erase(executorId);
+    hashmap<FrameworkID, hashmap<ExecutorID, ObservedExecutor> >::iterator
+      framework = executorsObservedUsed.find(frameworkId);
+    if (framework != executorsObservedUsed.end()) {
+      hashmap<ExecutorID, ObservedExecutor>::iterator executor =
+        framework->second.find(executorId);
+      if (executor != framework->second.end()) {
+        resourcesObservedUsed -= executor->second.used;
+        if (executor->second.estimated) {
+          resourcesObservedPeak -= executor->second.peak;
+          executorsEstimated--;
+        }
+        framework->second.erase(executor);
+        if (framework->second.empty()) {
+          executorsObservedUsed.erase(framework);
+        }
+      }
+    }
+
+    // Start over from zero once nothing is observed, so that rounding
+    // errors do not pile up.
+    if (executorsObservedUsed.empty()) {
+      resourcesObservedUsed.clear();
+      resourcesObservedPeak.clear();
     }
   }
 
   void addUsageMessage(const UsageMessage& usage)
   {
-    clearObservedUsageFor(usage.framework_id(), usage.executor_id());
-    resourcesObservedUsed += usage.resources();
-    usageMessages[usage.framework_id()][usage.executor_id()] = usage;
+    ObservedExecutor& executor =
+      executorsObservedUsed[usage.framework_id()][usage.executor_id()];
+
+    resourcesObservedUsed -= executor.used;
+    executor.used = ObservedUsage(usage.resources());
+    resourcesObservedUsed += executor.used;
+
+    // Only the periodic full reports of a slave carry the history, so
+    // a peak estimated from it holds until the next one.
+    if (executor.fromHistory && !hasHistory(usage)) {
+      return;
+    }
+
+    if (executor.estimated) {
+      resourcesObservedPeak -= executor.peak;
+      executorsEstimated--;
+    }
+    executor.estimated = estimatePeak(usage, &executor.peak);
+    executor.fromHistory = executor.estimated && hasHistory(usage);
+    if (executor.estimated) {
+      resourcesObservedPeak += executor.peak;
+      executorsEstimated++;
+    }
+  }
+
+  // Returns whether the history of a usage has any samples.
+  static bool hasHistory(const UsageMessage& usage)
+  {
+    foreach (const UsageWindow& window, usage.history()) {
+      if (window.samples() > 0) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // Estimates the 95th percentile of the usage of an executor, in the
+  // units resources are allocated in (cpus and megabytes), from the
+  // longest window of its history that has samples. Without a history
+  // the latest usage is taken instead. Returns false if there is
+  // nothing to go by.
+  static bool estimatePeak(const UsageMessage& usage, ObservedUsage* peak)
+  {
+    peak->clear();
+
+    const UsageWindow* longest = NULL;
+    foreach (const UsageWindow& window, usage.history()) {
+      if (window.samples() > 0 &&
+          (longest == NULL || window.duration() > longest->duration())) {
+        longest = &window;
+      }
+    }
+
+    if (longest != NULL) {
+      peak->values[ObservedUsage::CPUS] = longest->cpus_p95();
+      peak->values[ObservedUsage::MEM] = longest->mem_p95() / 1048576.0;
+      return true;
+    }
+
+    // The cpu usage is in seconds over the duration, memory in bytes.
+    if (usage.has_duration() && usage.duration() > 0) {
+      ObservedUsage used(usage.resources());
+      peak->values[ObservedUsage::CPUS] =
+        used.values[ObservedUsage::CPUS] / usage.duration();
+      peak->values[ObservedUsage::MEM] =
+        used.values[ObservedUsage::MEM] / 1048576.0;
+      return true;
+    }
+
+    return false;
+  }
+
+  // Returns the number of executors running on this slave.
+  size_t executorCount() const
+  {
+    size_t count = 0;
+    hashmap<FrameworkID, hashmap<ExecutorID, ExecutorInfo> >::const_iterator
+      iterator;
+    for (iterator = executors.begin(); iterator != executors.end(); ++iterator) {
+      count += iterator->second.size();
+    }
+    return count;
   }
 
   Resources resourcesFree()
@@ -376,13 +563,27 @@ struct Slave
 
   Resources resourcesOffered; // Resources currently in offers.
   Resources resourcesInUse;   // Resources currently used by tasks.
-  Resources resourcesObservedUsed; // Used resources based on last usage
-                                   // message.
+  ObservedUsage resourcesObservedUsed; // Used resources based on last
+                                       // usage message.
+  ObservedUsage resourcesObservedPeak; // Sum of the estimated peaks of
+                                       // the executors (see estimatePeak).
 
   // Executors running on this slave.
   hashmap<FrameworkID, hashmap<ExecutorID, ExecutorInfo> > executors;
-  // Map of most recent UsageMessages applying to each live executor.
-  hashmap<FrameworkID, hashmap<ExecutorID, UsageMessage> > usageMessages;
+
+  struct ObservedExecutor
+  {
+    ObservedExecutor() : estimated(false), fromHistory(false) {}
+
+    ObservedUsage used; // Most recent usage.
+    ObservedUsage peak; // Only if estimated.
+    bool estimated;
+    bool fromHistory; // Whether the peak came from history windows.
+  };
+
+  // Most recent usage of each live executor.
+  hashmap<FrameworkID, hashmap<ExecutorID, ObservedExecutor> > executorsObservedUsed;
+  size_t executorsEstimated; // Number of them with an estimated peak.
 
   // Tasks running on this slave, indexed by FrameworkID x TaskID.
   hashmap<std::pair<FrameworkID, TaskID>, Task*> tasks;
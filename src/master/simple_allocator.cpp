@@ -20,12 +20,20 @@
 
 #include <algorithm>
 
+#include <process/clock.hpp>
+#include <process/dispatch.hpp>
+#include <process/timer.hpp>
+
 #include "common/utils.hpp"
 
 #include "master/simple_allocator.hpp"
 
+using process::Clock;
+
+using std::make_pair;
 using std::max;
-using std::sort;
+using std::min;
+using std::pair;
 using std::vector;
 
 
@@ -33,10 +41,63 @@ namespace mesos {
 namespace internal {
 namespace master {
 
+SimpleAllocator::SimpleAllocator(const Configuration& conf)
+  : initialized(false)
+{
+  oversubscribe = conf.get<bool>("oversubscribe", false);
+  oversubscriptionMargin =
+    conf.get<double>("oversubscription_margin", OVERSUBSCRIPTION_MARGIN);
+  usageWeight = conf.get<double>("drf_usage_weight", 0);
+  CHECK(usageWeight >= 0 && usageWeight <= 1)
+    << "drf_usage_weight must be between 0 and 1";
+  allocationInterval =
+    conf.get<double>("allocation_interval", ALLOCATION_INTERVAL);
+}
+
+
+void SimpleAllocator::registerOptions(Configurator* configurator)
+{
+  configurator->addOption<bool>(
+      "oversubscribe",
+      "Offer resources that are allocated but unused, going by\n"
+      "the usage reported by slaves, as revocable",
+      false);
+
+  configurator->addOption<double>(
+      "oversubscription_margin",
+      "Fraction of the estimated peak usage of a slave to keep\n"
+      "back when oversubscribing",
+      OVERSUBSCRIPTION_MARGIN);
+
+  configurator->addOption<double>(
+      "drf_usage_weight",
+      "Weight (between 0 and 1) of the observed usage of a framework,\n"
+      "rather than its allocation, in its dominant share",
+      0);
+
+  configurator->addOption<double>(
+      "allocation_interval",
+      "Minimum number of seconds between two allocations, the\n"
+      "events in between are allocated for in one batch",
+      ALLOCATION_INTERVAL);
+}
+
+
 void SimpleAllocator::initialize(Master* _master)
 {
   master = _master;
   initialized = true;
+
+  allocationPending = false;
+  pendingSince = 0;
+  lastAllocation = 0;
+  allocateAll = false;
+
+  stats.events = 0;
+  stats.allocations = 0;
+  stats.time = 0;
+  stats.latency = 0;
+  stats.maxLatency = 0;
 }
 
 
@@ -44,7 +105,9 @@ void SimpleAllocator::frameworkAdded(Framework* framework)
 {
   CHECK(initialized);
   LOG(INFO) << "Added framework " << framework->id;
-  makeNewOffers();
+  frameworks[framework->id] = framework;
+  dirty.insert(framework->id);
+  requestAllocation();
 }
 
 
@@ -52,13 +115,24 @@ void SimpleAllocator::frameworkRemoved(Framework* framework)
 {
   CHECK(initialized);
 
+  executorsObserved.erase(framework->id);
+  frameworksObserved.erase(framework->id);
+  observedShares.erase(framework->id);
+
+  if (shares.contains(framework->id)) {
+    sorted.erase(make_pair(shares[framework->id], framework));
+    shares.erase(framework->id);
+  }
+  frameworks.erase(framework->id);
+  dirty.erase(framework->id);
+
   foreachkey (const SlaveID& slaveId, utils::copy(refusers)) {
     refusers.remove(slaveId, framework->id);
   }
 
   LOG(INFO) << "Removed framework " << framework->id;
 
-  makeNewOffers();
+  requestAllocation();
 }
 
 
@@ -70,7 +144,9 @@ void SimpleAllocator::slaveAdded(Slave* slave)
             << " with " << slave->info.resources();
 
   totalResources += slave->info.resources();
-  makeNewOffers(slave);
+  updateObservedShares();
+  invalidateShares();
+  requestAllocation(slave->id);
 }
 
 
@@ -82,6 +158,23 @@ void SimpleAllocator::slaveRemoved(Slave* slave)
 
   totalResources -= slave->info.resources();
   refusers.remove(slave->id);
+  slavesToAllocate.erase(slave->id);
+  freeSlaves.erase(slave->id);
+
+  // Forget the usage of the executors that ran on the slave.
+  foreachkey (const FrameworkID& frameworkId, utils::copy(executorsObserved)) {
+    hashmap<SlaveExecutor, ObservedUsage>& executors =
+      executorsObserved[frameworkId];
+    foreachkey (const SlaveExecutor& key, utils::copy(executors)) {
+      if (key.first == slave->id) {
+        frameworksObserved[frameworkId] -= executors[key];
+        executors.erase(key);
+      }
+    }
+  }
+
+  updateObservedShares();
+  invalidateShares();
 }
 
 
@@ -109,7 +202,11 @@ void SimpleAllocator::resourcesUnused(
     refusers.put(slaveId, frameworkId);
   }
 
-  makeNewOffers();
+  requestAllocation(slaveId);
+
+  // The master takes the resources away from the framework once this
+  // returns, so its share needs another look.
+  dirty.insert(frameworkId);
 }
 
 
@@ -127,7 +224,26 @@ void SimpleAllocator::resourcesRecovered(
     refusers.remove(slaveId);
   }
 
-  makeNewOffers();
+  requestAllocation(slaveId);
+
+  // As in resourcesUnused, the framework still holds the resources
+  // until this returns.
+  dirty.insert(frameworkId);
+}
+
+
+void SimpleAllocator::resourcesAllocated(
+    const FrameworkID& frameworkId,
+    const SlaveID& slaveId,
+    const Resources& resources)
+{
+  CHECK(initialized);
+
+  VLOG(1) << "Allocated " << resources
+          << " on slave " << slaveId
+          << " to framework " << frameworkId;
+
+  dirty.insert(frameworkId);
 }
 
 
@@ -142,87 +258,323 @@ void SimpleAllocator::offersRevived(Framework* framework)
   // decisions.
   LOG(INFO) << "Filters removed for framework " << framework->id;
 
-  makeNewOffers();
+  requestAllocation();
 }
 
 
 void SimpleAllocator::timerTick()
 {
   CHECK(initialized);
-  makeNewOffers();
+  requestAllocation();
 }
 
 
-namespace {
-
-struct DominantShareComparator
+void SimpleAllocator::allocate()
 {
-  DominantShareComparator(const Resources& _resources)
-    : resources(_resources) {}
+  CHECK(initialized);
 
-  bool operator () (Framework* framework1, Framework* framework2)
-  {
-    double share1 = 0;
-    double share2 = 0;
+  if (!allocationPending) {
+    return;
+  }
 
-    // TODO(benh): This implementaion of "dominant resource fairness"
-    // currently does not take into account resources that are not
-    // scalars.
+  allocationPending = false;
 
-    foreach (const Resource& resource, resources) {
-      if (resource.type() == Value::SCALAR) {
-        double total = resource.scalar().value();
+  double started = Clock::now();
 
-        if (total > 0) {
-          Value::Scalar none;
-          const Value::Scalar& scalar1 =
-            framework1->resources.get(resource.name(), none);
-          const Value::Scalar& scalar2 =
-            framework2->resources.get(resource.name(), none);
-          share1 = max(share1, scalar1.value() / total);
-          share2 = max(share2, scalar2.value() / total);
-        }
+  if (allocateAll) {
+    allocateAll = false;
+    slavesToAllocate.clear();
+    makeNewOffers();
+  } else {
+    vector<Slave*> slaves;
+    foreach (const SlaveID& slaveId, slavesToAllocate) {
+      Slave* slave = master->getSlave(slaveId);
+      if (slave != NULL) {
+        slaves.push_back(slave);
       }
     }
+    slavesToAllocate.clear();
+    makeNewOffers(slaves);
+  }
 
-    if (share1 == share2) {
-      // Make the sort deterministic for unit testing.
-      return framework1->id.value() < framework2->id.value();
-    } else {
-      return share1 < share2;
+  lastAllocation = Clock::now();
+
+  stats.allocations++;
+  stats.time += lastAllocation - started;
+  stats.latency += started - pendingSince;
+  stats.maxLatency = max(stats.maxLatency, started - pendingSince);
+}
+
+
+void SimpleAllocator::getStats(JSON::Object* object)
+{
+  CHECK(initialized);
+
+  object->values["allocation_events"] = stats.events;
+  object->values["allocations"] = stats.allocations;
+  object->values["allocation_time_secs"] = stats.time;
+  object->values["allocation_latency_secs"] = stats.latency;
+  object->values["allocation_max_latency_secs"] = stats.maxLatency;
+}
+
+
+void SimpleAllocator::requestAllocation()
+{
+  allocateAll = true;
+  scheduleAllocation();
+}
+
+
+void SimpleAllocator::requestAllocation(const SlaveID& slaveId)
+{
+  freeSlaves.insert(slaveId);
+  slavesToAllocate.insert(slaveId);
+  scheduleAllocation();
+}
+
+
+void SimpleAllocator::scheduleAllocation()
+{
+  stats.events++;
+
+  if (allocationPending) {
+    return; // Batched with the events before it.
+  }
+
+  allocationPending = true;
+  pendingSince = Clock::now();
+
+  // Never allocate from within the event itself: the master tells
+  // the allocator about unused or recovered resources before it
+  // removes the offer, so they would still look used (and the slave
+  // would be dropped from freeSlaves). Instead allocate once the
+  // master is done handling the event.
+  double wait = lastAllocation + allocationInterval - pendingSince;
+  if (wait <= 0) {
+    process::dispatch(master->self(), &Master::allocate);
+  } else {
+    process::delay(wait, master->self(), &Master::allocate);
+  }
+}
+
+
+// Returns the rate at which an executor used cpus, and the memory it
+// used in megabytes, or false if the usage has no duration.
+static bool observedRate(const UsageMessage& usage, ObservedUsage* rate)
+{
+  if (!usage.has_duration() || usage.duration() <= 0) {
+    return false;
+  }
+
+  *rate = ObservedUsage(usage.resources());
+  rate->values[ObservedUsage::CPUS] /= usage.duration();
+  rate->values[ObservedUsage::MEM] /= 1048576.0;
+  rate->values[ObservedUsage::DISK] = 0;
+  return true;
+}
+
+
+void SimpleAllocator::gotUsage(const UsageMessage& usage)
+{
+  CHECK(initialized);
+
+  if (oversubscribe) {
+    // The slack of the slave may have changed.
+    freeSlaves.insert(usage.slave_id());
+  }
+
+  if (usageWeight == 0) {
+    return;
+  }
+
+  ObservedUsage rate;
+  if (!observedRate(usage, &rate)) {
+    return;
+  }
+
+  const FrameworkID& frameworkId = usage.framework_id();
+
+  ObservedUsage& executor = executorsObserved[frameworkId]
+    [std::make_pair(usage.slave_id(), usage.executor_id())];
+
+  ObservedUsage& framework = frameworksObserved[frameworkId];
+  framework -= executor;
+  framework += rate;
+  executor = rate;
+
+  updateObservedShare(frameworkId);
+  dirty.insert(frameworkId);
+}
+
+
+void SimpleAllocator::executorRemoved(
+    const FrameworkID& frameworkId,
+    const SlaveID& slaveId,
+    const ExecutorID& executorId)
+{
+  CHECK(initialized);
+
+  // The executor's resources are no longer allocated either.
+  dirty.insert(frameworkId);
+  freeSlaves.insert(slaveId);
+
+  if (!executorsObserved.contains(frameworkId)) {
+    return;
+  }
+
+  hashmap<SlaveExecutor, ObservedUsage>& executors =
+    executorsObserved[frameworkId];
+
+  const SlaveExecutor key = std::make_pair(slaveId, executorId);
+  if (executors.contains(key)) {
+    frameworksObserved[frameworkId] -= executors[key];
+    executors.erase(key);
+    updateObservedShare(frameworkId);
+  }
+}
+
+
+void SimpleAllocator::updateObservedShare(const FrameworkID& frameworkId)
+{
+  const ObservedUsage& observed = frameworksObserved[frameworkId];
+
+  double share = 0;
+  for (int i = 0; i < ObservedUsage::DIMENSIONS; i++) {
+    ObservedUsage::Dimension dimension = (ObservedUsage::Dimension) i;
+    Value::Scalar none;
+    double total =
+      totalResources.get(ObservedUsage::name(dimension), none).value();
+    if (total > 0) {
+      share = max(share, observed.values[dimension] / total);
+    }
+  }
+
+  observedShares[frameworkId] = share;
+}
+
+
+void SimpleAllocator::updateObservedShares()
+{
+  foreachkey (const FrameworkID& frameworkId, frameworksObserved) {
+    updateObservedShare(frameworkId);
+  }
+}
+
+
+namespace {
+
+// The dominant share of the resources allocated to a framework.
+double allocatedShare(Framework* framework, const Resources& resources)
+{
+  double share = 0;
+
+  // TODO(benh): This implementaion of "dominant resource fairness"
+  // currently does not take into account resources that are not
+  // scalars.
+
+  foreach (const Resource& resource, resources) {
+    if (resource.type() == Value::SCALAR) {
+      double total = resource.scalar().value();
+
+      if (total > 0) {
+        Value::Scalar none;
+        const Value::Scalar& scalar =
+          framework->resources.get(resource.name(), none);
+        share = max(share, scalar.value() / total);
+      }
     }
   }
 
-  Resources resources;
-};
+  return share;
+}
 
 } // namespace {
 
 
-vector<Framework*> SimpleAllocator::getAllocationOrdering()
+bool SimpleAllocator::DominantShareComparator::operator () (
+    const pair<double, Framework*>& framework1,
+    const pair<double, Framework*>& framework2) const
 {
-  CHECK(initialized) << "Cannot get allocation ordering before initialization!";
-  vector<Framework*> frameworks = master->getActiveFrameworks();
-  DominantShareComparator comp(totalResources);
-  sort(frameworks.begin(), frameworks.end(), comp);
-  return frameworks;
+  if (framework1.first == framework2.first) {
+    // Make the ordering deterministic for unit testing.
+    return framework1.second->id.value() < framework2.second->id.value();
+  } else {
+    return framework1.first < framework2.first;
+  }
 }
 
 
-void SimpleAllocator::makeNewOffers()
+double SimpleAllocator::dominantShare(Framework* framework)
 {
-  // TODO: Create a method in master so that we don't return the whole list of slaves
-  CHECK(initialized) << "Cannot make new offers before initialization!";
-  vector<Slave*> slaves = master->getActiveSlaves();
-  makeNewOffers(slaves);
+  double share = 0;
+  if (usageWeight < 1) {
+    share += (1 - usageWeight) * allocatedShare(framework, totalResources);
+  }
+  if (usageWeight > 0 && observedShares.contains(framework->id)) {
+    share += usageWeight * observedShares[framework->id];
+  }
+  return share;
+}
+
+
+void SimpleAllocator::invalidateShares()
+{
+  foreachkey (const FrameworkID& frameworkId, frameworks) {
+    dirty.insert(frameworkId);
+  }
 }
 
 
-void SimpleAllocator::makeNewOffers(Slave* slave)
+vector<Framework*> SimpleAllocator::getAllocationOrdering()
+{
+  CHECK(initialized) << "Cannot get allocation ordering before initialization!";
+
+  // Re-sort the frameworks whose shares may have changed.
+  foreach (const FrameworkID& frameworkId, dirty) {
+    if (!frameworks.contains(frameworkId)) {
+      continue; // The allocator was told about it before it was added.
+    }
+
+    Framework* framework = frameworks[frameworkId];
+
+    if (shares.contains(frameworkId)) {
+      sorted.erase(make_pair(shares[frameworkId], framework));
+    }
+
+    double share = dominantShare(framework);
+    shares[frameworkId] = share;
+    sorted.insert(make_pair(share, framework));
+  }
+
+  dirty.clear();
+
+  vector<Framework*> ordering;
+  typedef pair<double, Framework*> Share;
+  foreach (const Share& share, sorted) {
+    if (share.second->active) {
+      ordering.push_back(share.second);
+    }
+  }
+  return ordering;
+}
+
+
+void SimpleAllocator::makeNewOffers()
 {
   CHECK(initialized) << "Cannot make new offers before initialization!";
+
+  // Only the slaves that may have something to offer (the others
+  // have had all of their resources offered or used).
   vector<Slave*> slaves;
-  slaves.push_back(slave);
+  foreach (const SlaveID& slaveId, utils::copy(freeSlaves)) {
+    Slave* slave = master->getSlave(slaveId);
+    if (slave != NULL) {
+      slaves.push_back(slave);
+    } else {
+      freeSlaves.erase(slaveId);
+    }
+  }
+
   makeNewOffers(slaves);
 }
 
@@ -239,6 +591,7 @@ void SimpleAllocator::makeNewOffers(const vector<Slave*>& slaves)
 
   // Find all the available resources that can be allocated.
   hashmap<Slave*, Resources> available;
+  hashmap<Slave*, Resources> revocable;
   foreach (Slave* slave, slaves) {
     if (slave->active) {
       Resources resources = slave->resourcesFree().allocatable();
@@ -264,30 +617,71 @@ void SimpleAllocator::makeNewOffers(const vector<Slave*>& slaves)
                 << " on slave " << slave->id;
         available[slave] = resources;
       }
+
+      if (oversubscribe) {
+        resources = slack(slave);
+
+        cpus = resources.get("cpus", none);
+        mem = resources.get("mem", none);
+
+        if (cpus.value() >= MIN_CPUS && mem.value() > MIN_MEM) {
+          VLOG(1) << "Found revocable resources: " << resources
+                  << " on slave " << slave->id;
+          revocable[slave] = resources;
+        }
+      }
+    }
+
+    if (!available.contains(slave) && !revocable.contains(slave)) {
+      freeSlaves.erase(slave->id);
     }
   }
 
-  if (available.size() == 0) {
+  if (available.size() == 0 && revocable.size() == 0) {
     VLOG(1) << "No resources available to allocate!";
     return;
   }
 
   // Clear refusers on any slave that has been refused by everyone.
-  foreachkey (Slave* slave, available) {
-    if (refusers.get(slave->id).size() == ordering.size()) {
+  foreach (Slave* slave, slaves) {
+    if ((available.contains(slave) || revocable.contains(slave)) &&
+        refusers.get(slave->id).size() == ordering.size()) {
       VLOG(1) << "Clearing refusers for slave " << slave->id
               << " because EVERYONE has refused resources from it";
       refusers.remove(slave->id);
     }
   }
 
+  makeNewOffers(ordering, &available, false);
+  makeNewOffers(ordering, &revocable, true);
+
+  // The slaves that were offered everything they had are left out of
+  // allocations until they get resources back.
+  foreach (Slave* slave, slaves) {
+    if (!available.contains(slave) && !revocable.contains(slave)) {
+      freeSlaves.erase(slave->id);
+    }
+  }
+}
+
+
+void SimpleAllocator::makeNewOffers(
+    const vector<Framework*>& ordering,
+    hashmap<Slave*, Resources>* available,
+    bool revocable)
+{
   foreach (Framework* framework, ordering) {
+    if (available->empty()) {
+      return;
+    }
+
     // Check if we should offer resources to this framework.
     hashmap<Slave*, Resources> offerable;
-    foreachpair (Slave* slave, const Resources& resources, available) {
+    foreachpair (Slave* slave, const Resources& resources, *available) {
       if (!refusers.contains(slave->id, framework->id) &&
           !framework->filters(slave, resources)) {
         VLOG(1) << "Offering " << resources
+                << (revocable ? " (revocable)" : "")
                 << " on slave " << slave->id
                 << " to framework " << framework->id;
         offerable[slave] = resources;
@@ -296,14 +690,61 @@ void SimpleAllocator::makeNewOffers(const vector<Slave*>& slaves)
 
     if (offerable.size() > 0) {
       foreachkey (Slave* slave, offerable) {
-        available.erase(slave);
+        available->erase(slave);
       }
 
-      master->makeOffers(framework, offerable);
+      master->makeOffers(framework, offerable, revocable);
+      dirty.insert(framework->id);
     }
   }
 }
 
+
+// The slack of a resource is what is in use less the estimated peak
+// (plus the margin), as long as the slave is not oversubscribed yet.
+// Once it is, i.e., once tasks run on revocable offers, the slack is
+// what remains of the slave after the estimated peak and the
+// outstanding offers. Disk is not oversubscribed since its usage is
+// not observed. Nothing is offered until every executor on the slave
+// has reported its usage.
+Resources SimpleAllocator::slack(Slave* slave)
+{
+  size_t executors = slave->executorCount();
+  if (executors == 0 || slave->executorsEstimated < executors) {
+    return Resources();
+  }
+
+  const ObservedUsage::Dimension dimensions[] =
+    { ObservedUsage::CPUS, ObservedUsage::MEM };
+
+  Resources total = slave->info.resources();
+
+  Resources result;
+  for (size_t i = 0; i < sizeof(dimensions) / sizeof(dimensions[0]); i++) {
+    const char* name = ObservedUsage::name(dimensions[i]);
+
+    Value::Scalar none;
+    double capacity = total.get(name, none).value();
+    double offered = slave->resourcesOffered.get(name, none).value();
+    double inUse = slave->resourcesInUse.get(name, none).value();
+
+    double peak = slave->resourcesObservedPeak.values[dimensions[i]];
+    double estimate = min(inUse, peak * (1 + oversubscriptionMargin));
+    double free = max(capacity - offered - inUse, 0.0);
+
+    double value = capacity - offered - estimate - free;
+    if (value > 0) {
+      Resource resource;
+      resource.set_name(name);
+      resource.set_type(Value::SCALAR);
+      resource.mutable_scalar()->set_value(value);
+      result += resource;
+    }
+  }
+
+  return result;
+}
+
 } // namespace master {
 } // namespace internal {
 } // namespace mesos {
@@ -19,11 +19,16 @@
 #ifndef __SIMPLE_ALLOCATOR_HPP__
 #define __SIMPLE_ALLOCATOR_HPP__
 
+#include <set>
+#include <utility>
 #include <vector>
 
 #include "common/hashmap.hpp"
+#include "common/hashset.hpp"
 #include "common/multihashmap.hpp"
 
+#include "configurator/configurator.hpp"
+
 #include "master/allocator.hpp"
 
 
@@ -31,13 +36,43 @@ namespace mesos {
 namespace internal {
 namespace master {
 
+// Offers the free resources of slaves to frameworks in the order of
+// their dominant shares. With oversubscription enabled it also offers,
+// as revocable, resources that are allocated but expected to go unused
+// according to the 95th percentile of the usage observed on a slave.
+//
+// The dominant share of a framework is a blend of the share of the
+// resources allocated to it and the share of the resources it was
+// observed to use, weighted by usageWeight (0 by default, i.e., only
+// allocations count).
+//
+// Frameworks are kept sorted by their dominant shares, and only the
+// frameworks whose allocations (or observed usage) changed since the
+// last ordering are re-sorted, so getting an ordering does not sort
+// all of the frameworks every time.
+//
+// Events do not allocate right away: they mark the slaves (or all of
+// them) to allocate, and the allocation runs at most once every
+// allocationInterval seconds, batching the events in between. Even an
+// allocation for all slaves only looks at the slaves that may have
+// something to offer (see freeSlaves).
 class SimpleAllocator : public Allocator
 {
 public:
-  SimpleAllocator(): initialized(false) {}
+  SimpleAllocator()
+    : initialized(false),
+      oversubscribe(false),
+      oversubscriptionMargin(OVERSUBSCRIPTION_MARGIN),
+      usageWeight(0),
+      allocationInterval(0) {} // Allocate on every event (for tests
+                               // that pause the clock).
+
+  SimpleAllocator(const Configuration& conf);
 
   virtual ~SimpleAllocator() {}
 
+  static void registerOptions(Configurator* configurator);
+
   virtual void initialize(Master* _master);
 
   virtual void frameworkAdded(Framework* framework);
@@ -62,25 +97,121 @@ public:
     const SlaveID& slaveId,
     const Resources& resources);
 
+  virtual void resourcesAllocated(
+    const FrameworkID& frameworkId,
+    const SlaveID& slaveId,
+    const Resources& resources);
+
   virtual void offersRevived(Framework* framework);
 
   virtual void timerTick();
 
+  virtual void allocate();
+
+  virtual void getStats(JSON::Object* object);
+
+  virtual void gotUsage(const UsageMessage& usage);
+
+  virtual void executorRemoved(
+      const FrameworkID& frameworkId,
+      const SlaveID& slaveId,
+      const ExecutorID& executorId);
+
 private:
   // Get an ordering to consider frameworks in for launching tasks.
   std::vector<Framework*> getAllocationOrdering();
 
+  // Returns the dominant share of a framework (see the class comment).
+  double dominantShare(Framework* framework);
+
+  // Marks every framework to be re-sorted, e.g., once the total
+  // resources change.
+  void invalidateShares();
+
+  // Marks all slaves (or one slave) to allocate, and schedules an
+  // allocation (right after the current event if the last one was
+  // long enough ago), unless one is already scheduled.
+  void requestAllocation();
+  void requestAllocation(const SlaveID& slaveId);
+  void scheduleAllocation();
+
   // Look at the full state of the cluster and send out offers.
   void makeNewOffers();
 
-  // Make resource offers for just one slave.
-  void makeNewOffers(Slave* slave);
-
   // Make resource offers for a subset of the slaves.
   void makeNewOffers(const std::vector<Slave*>& slaves);
 
+  // Offer the available resources to the frameworks in order, each
+  // slave to the first framework that has not refused or filtered it.
+  void makeNewOffers(const std::vector<Framework*>& ordering,
+                     hashmap<Slave*, Resources>* available,
+                     bool revocable);
+
+  // Returns the resources of a slave that are allocated but, going by
+  // the estimated peak usage of its executors, not going to be used.
+  Resources slack(Slave* slave);
+
+  // Brings the cached observed share of a framework up to date with
+  // its observed usage (or of all frameworks, when the total changes).
+  void updateObservedShare(const FrameworkID& frameworkId);
+  void updateObservedShares();
+
   bool initialized;
 
+  bool oversubscribe;
+  double oversubscriptionMargin;
+
+  double usageWeight;
+
+  double allocationInterval;
+  bool allocationPending; // Whether an allocation is scheduled.
+  double pendingSince; // Time of the first event it batches.
+  double lastAllocation;
+
+  // Slaves to allocate in the next allocation, unless it is for all.
+  bool allocateAll;
+  hashset<SlaveID> slavesToAllocate;
+
+  // Slaves that may have resources to offer: those that got resources
+  // back (or, when oversubscribing, reported usage) since they were
+  // last offered everything they had. An allocation "for all" slaves
+  // only looks at these.
+  hashset<SlaveID> freeSlaves;
+
+  // Statistics (initialized in SimpleAllocator::initialize).
+  struct {
+    uint64_t events; // Events that asked for an allocation.
+    uint64_t allocations;
+    double time; // Seconds spent allocating.
+    double latency; // Seconds from events to their allocations.
+    double maxLatency;
+  } stats;
+
+  typedef std::pair<SlaveID, ExecutorID> SlaveExecutor;
+
+  // The latest observed usage (in cpus and megabytes) of each executor
+  // of each framework, and their sums by framework.
+  hashmap<FrameworkID, hashmap<SlaveExecutor, ObservedUsage> > executorsObserved;
+  hashmap<FrameworkID, ObservedUsage> frameworksObserved;
+
+  // The dominant share of each framework in frameworksObserved.
+  hashmap<FrameworkID, double> observedShares;
+
+  // Orders frameworks by dominant share, breaking ties by id.
+  struct DominantShareComparator
+  {
+    bool operator () (const std::pair<double, Framework*>& framework1,
+                      const std::pair<double, Framework*>& framework2) const;
+  };
+
+  // The frameworks added to the allocator, sorted by their dominant
+  // shares as of the last time they were re-sorted (which is what
+  // shares holds), and those that need to be re-sorted.
+  hashmap<FrameworkID, Framework*> frameworks;
+  hashmap<FrameworkID, double> shares;
+  std::set<std::pair<double, Framework*>, DominantShareComparator> sorted;
+  hashset<FrameworkID> dirty;
+
   Master* master;
 
   Resources totalResources;
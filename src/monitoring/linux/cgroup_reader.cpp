@@ -0,0 +1,232 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "common/foreach.hpp"
+#include "common/hashmap.hpp"
+#include "common/strings.hpp"
+#include "common/try.hpp"
+
+#include "monitoring/linux/cgroup_reader.hpp"
+#include "monitoring/linux/proc_utils.hpp"
+
+using std::ifstream;
+using std::string;
+using std::vector;
+
+namespace mesos {
+namespace internal {
+namespace monitoring {
+
+// Undoes the octal escaping (e.g., "\040" for a space) the kernel
+// applies to paths in mountinfo.
+static string unescape(const string& path)
+{
+  string result;
+  for (size_t i = 0; i < path.size(); i++) {
+    if (path[i] == '\\' && i + 3 < path.size() &&
+        path[i + 1] >= '0' && path[i + 1] <= '7') {
+      result += (char) strtol(path.substr(i + 1, 3).c_str(), NULL, 8);
+      i += 3;
+    } else {
+      result += path[i];
+    }
+  }
+  return result;
+}
+
+
+Try<string> getCgroupMount(const string& subsystem, const string& mountinfo)
+{
+  ifstream file(mountinfo.c_str());
+  if (!file.is_open()) {
+    return Try<string>::error("Failed to open " + mountinfo);
+  }
+
+  // Each line looks like:
+  //   36 20 0:31 / /cgroup rw,relatime - cgroup cgroup rw,cpuacct,memory
+  // where the optional fields before the "-" vary in number.
+  string line;
+  while (getline(file, line)) {
+    vector<string> tokens = strings::split(line, " ");
+
+    size_t separator = 0;
+    while (separator < tokens.size() && tokens[separator] != "-") {
+      separator++;
+    }
+
+    if (separator < 5 || separator + 3 >= tokens.size()) {
+      continue; // Malformed line.
+    }
+
+    if (tokens[separator + 1] != "cgroup") {
+      continue;
+    }
+
+    vector<string> options = strings::split(tokens[separator + 3], ",");
+    foreach (const string& option, options) {
+      if (option == subsystem) {
+        return unescape(tokens[4]);
+      }
+    }
+  }
+
+  return Try<string>::error(
+      "No cgroup hierarchy with the " + subsystem + " subsystem is mounted");
+}
+
+
+CgroupReader::CgroupReader(const string& _container, const string& _mountinfo)
+  : container(_container), mountinfo(_mountinfo) {}
+
+
+CgroupReader::~CgroupReader()
+{
+  foreachvalue (int fd, files) {
+    ::close(fd);
+  }
+}
+
+
+Try<unsigned long long> CgroupReader::read(const string& control)
+{
+  Try<int> fd = open(control);
+  if (fd.isError()) {
+    return Try<unsigned long long>::error(fd.error());
+  }
+
+  char buffer[64];
+  ssize_t length = preadProcFile(fd.get(), buffer, sizeof(buffer) - 1);
+  if (length <= 0) {
+    // The container's cgroup might have been removed and recreated,
+    // so open the control again next time.
+    ::close(fd.get());
+    files.erase(control);
+    return Try<unsigned long long>::error(
+        "Failed to read " + control + " of container " + container);
+  }
+
+  buffer[length] = '\0';
+
+  char* end;
+  errno = 0;
+  unsigned long long value = strtoull(buffer, &end, 10);
+  if (errno != 0 || end == buffer) {
+    return Try<unsigned long long>::error(
+        "Failed to parse " + control + " of container " + container);
+  }
+
+  return value;
+}
+
+
+Try<hashmap<string, unsigned long long> > CgroupReader::readFields(
+    const string& control)
+{
+  Try<int> fd = open(control);
+  if (fd.isError()) {
+    return Try<hashmap<string, unsigned long long> >::error(fd.error());
+  }
+
+  char buffer[8192];
+  ssize_t length = preadProcFile(fd.get(), buffer, sizeof(buffer) - 1);
+  if (length <= 0) {
+    ::close(fd.get());
+    files.erase(control);
+    return Try<hashmap<string, unsigned long long> >::error(
+        "Failed to read " + control + " of container " + container);
+  }
+
+  buffer[length] = '\0';
+
+  hashmap<string, unsigned long long> fields;
+
+  char* line = buffer;
+  while (*line != '\0') {
+    char* separator = strchr(line, ' ');
+    if (separator == NULL) {
+      break;
+    }
+
+    char* end;
+    unsigned long long value = strtoull(separator + 1, &end, 10);
+    if (end == separator + 1) {
+      return Try<hashmap<string, unsigned long long> >::error(
+          "Failed to parse " + control + " of container " + container);
+    }
+
+    fields[string(line, separator - line)] = value;
+
+    line = end;
+    while (*line == '\n') {
+      line++;
+    }
+  }
+
+  return fields;
+}
+
+
+Try<int> CgroupReader::open(const string& control)
+{
+  hashmap<string, int>::iterator iterator = files.find(control);
+  if (iterator != files.end()) {
+    return iterator->second;
+  }
+
+  string subsystem = control.substr(0, control.find('.'));
+
+  Try<string> mount = getCgroupMount(subsystem, mountinfo);
+  if (mount.isError()) {
+    return Try<int>::error(mount.error());
+  }
+
+  // Depending on its version, lxc puts the cgroup of a container
+  // either right below the root of the hierarchy or below "lxc".
+  string paths[] = {
+    mount.get() + "/" + container + "/" + control,
+    mount.get() + "/lxc/" + container + "/" + control
+  };
+
+  // The descriptor is cached, so keep it from leaking into the
+  // executors that get launched.
+  foreach (const string& path, paths) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd >= 0) {
+      files[control] = fd;
+      return fd;
+    }
+  }
+
+  return Try<int>::error(
+      "Failed to open " + control + " of container " + container +
+      " under " + mount.get());
+}
+
+} // namespace monitoring {
+} // namespace internal {
+} // namespace mesos {
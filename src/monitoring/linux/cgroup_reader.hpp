@@ -0,0 +1,79 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __CGROUP_READER_HPP__
+#define __CGROUP_READER_HPP__
+
+#include <string>
+
+#include "common/hashmap.hpp"
+#include "common/try.hpp"
+
+namespace mesos {
+namespace internal {
+namespace monitoring {
+
+// Returns the mount point of the cgroup hierarchy that has the given
+// subsystem (e.g., "cpuacct" or "memory") attached, as listed in the
+// given mountinfo file.
+Try<std::string> getCgroupMount(
+    const std::string& subsystem,
+    const std::string& mountinfo = "/proc/self/mountinfo");
+
+
+// Reads the control files (e.g., cpuacct.usage) of a container's
+// cgroup straight from cgroupfs, which is what lxc-cgroup does after
+// forking a shell. A control file is opened the first time it is read
+// and re-read with pread() after that.
+//
+// Not thread safe.
+class CgroupReader
+{
+public:
+  CgroupReader(const std::string& container,
+               const std::string& mountinfo = "/proc/self/mountinfo");
+
+  ~CgroupReader();
+
+  // Reads an integer control, e.g., read("memory.usage_in_bytes"). The
+  // subsystem is taken from the part of the name before the first dot.
+  Try<unsigned long long> read(const std::string& control);
+
+  // Reads a control made of "<key> <value>" lines, e.g., memory.stat.
+  Try<hashmap<std::string, unsigned long long> > readFields(
+      const std::string& control);
+
+private:
+  // No copying, no assigning.
+  CgroupReader(const CgroupReader&);
+  CgroupReader& operator = (const CgroupReader&);
+
+  // Returns an open descriptor for the given control file.
+  Try<int> open(const std::string& control);
+
+  const std::string container;
+  const std::string mountinfo;
+
+  hashmap<std::string, int> files; // Control name -> descriptor.
+};
+
+} // namespace monitoring {
+} // namespace internal {
+} // namespace mesos {
+
+#endif // __CGROUP_READER_HPP__
@@ -22,9 +22,11 @@
 
 #include <process/process.hpp>
 
+#include "monitoring/linux/cgroup_reader.hpp"
 #include "monitoring/linux/proc_utils.hpp"
 #include "monitoring/linux/lxc_resource_collector.hpp"
 
+#include "common/hashmap.hpp"
 #include "common/utils.hpp"
 #include "common/resources.hpp"
 #include "common/seconds.hpp"
@@ -36,19 +38,31 @@ namespace mesos {
 namespace internal {
 namespace monitoring {
 
-LxcResourceCollector::LxcResourceCollector(const std::string& _containerName)
-  : containerName(_containerName), previousTimestamp(-1.0), previousCpuTicks(0.0)
+// Looks up a field read from a control, returning false if missing.
+static bool lookup(const hashmap<std::string, unsigned long long>& fields,
+                   const std::string& key,
+                   double* value)
 {
+  hashmap<std::string, unsigned long long>::const_iterator iterator =
+    fields.find(key);
+  if (iterator == fields.end()) {
+    return false;
+  }
+  *value = iterator->second;
+  return true;
 }
 
-LxcResourceCollector::~LxcResourceCollector() {}
-
-Try<double> LxcResourceCollector::getMemoryUsage()
+LxcResourceCollector::LxcResourceCollector(const std::string& _containerName,
+                                           const std::string& mountinfo)
+  : containerName(_containerName), previousTimestamp(-1.0),
+    previousCpuTime(0.0), previousUserTime(0.0), previousSystemTime(0.0), previousMajorFaults(0.0),
+    cgroups(_containerName, mountinfo)
 {
-  return getControlGroupDoubleValue("memory.memsw.usage_in_bytes");
 }
 
-Try<Rate> LxcResourceCollector::getCpuUsage()
+LxcResourceCollector::~LxcResourceCollector() {}
+
+bool LxcResourceCollector::collect(UsageRecord* usage, std::string* error)
 {
   if (previousTimestamp == -1.0) {
     // TODO(sam): Make this handle the Try of the getStartTime.
@@ -57,55 +71,74 @@ Try<Rate> LxcResourceCollector::getCpuUsage()
 
   double seconds = Clock::now();
 
-  Try<double> cpuTicks = getControlGroupDoubleValue("cpuacct.usage");
-
-  if (cpuTicks.isError()) {
-    return Try<Rate>::error("unable to read cpuacct.usage from lxc");
+  // The totals the container is charged for, cpu time in nanoseconds
+  // and memory (including swap) in bytes.
+  Try<unsigned long long> cpuUsage = cgroups.read("cpuacct.usage");
+  if (cpuUsage.isError()) {
+    *error = "unable to read cpuacct.usage from lxc: " + cpuUsage.error();
+    return false;
   }
 
-  double ticks = nanoseconds(cpuTicks.get()).secs();
-  double elapsedTicks = ticks - previousCpuTicks;
-  previousCpuTicks = ticks;
+  Try<unsigned long long> memoryUsage =
+    cgroups.read("memory.memsw.usage_in_bytes");
+  if (memoryUsage.isError()) {
+    *error = "unable to read memory.memsw.usage_in_bytes from lxc: " +
+      memoryUsage.error();
+    return false;
+  }
 
-  double elapsedTime = seconds - previousTimestamp;
+  usage->fields = USAGE_CPU_TOTAL | USAGE_MEM_TOTAL;
+  usage->timestamp = seconds;
+  usage->duration = seconds - previousTimestamp;
   previousTimestamp = seconds;
 
-  return Rate(elapsedTime, elapsedTicks);
-}
+  double cpuTime = nanoseconds(cpuUsage.get()).secs();
+  usage->cpuTotal = cpuTime - previousCpuTime;
+  previousCpuTime = cpuTime;
+
+  usage->memTotal = memoryUsage.get();
+
+  // The breakdowns are in USER_HZ and bytes, respectively, and only
+  // reported on top of the totals if they can be read.
+  Try<hashmap<std::string, unsigned long long> > cpuStat =
+    cgroups.readFields("cpuacct.stat");
+  Try<hashmap<std::string, unsigned long long> > memoryStat =
+    cgroups.readFields("memory.stat");
+
+  const hashmap<std::string, unsigned long long> none;
+  const hashmap<std::string, unsigned long long>& cpu =
+    cpuStat.isSome() ? cpuStat.get() : none;
+  const hashmap<std::string, unsigned long long>& memory =
+    memoryStat.isSome() ? memoryStat.get() : none;
+
+  double user, system;
+  if (lookup(cpu, "user", &user) && lookup(cpu, "system", &system)) {
+    user = ticksToSeconds(user).value;
+    system = ticksToSeconds(system).value;
+    usage->fields |= USAGE_CPU;
+    usage->cpuUser = user - previousUserTime;
+    usage->cpuSystem = system - previousSystemTime;
+    previousUserTime = user;
+    previousSystemTime = system;
+  }
 
-bool LxcResourceCollector::getControlGroupValue(
-    std::iostream* ios, const std::string& property) const
-{
-  Try<int> status =
-    utils::os::shell(ios, "lxc-cgroup -n %s %s",
-                     containerName.c_str(), property.c_str());
-
-  if (status.isError()) {
-    LOG(INFO) << "Failed to get " << property
-               << " for container " << containerName
-               << ": " << status.error();
-    return false;
-  } else if (status.get() != 0) {
-    LOG(INFO) << "Failed to get " << property
-               << " for container " << containerName
-               << ": lxc-cgroup returned " << status.get();
-    return false;
+  if (lookup(memory, "rss", &usage->rss)) {
+    usage->fields |= USAGE_RSS;
   }
 
-  return true;
-}
+  if (lookup(memory, "cache", &usage->pageCache)) {
+    usage->fields |= USAGE_PAGE_CACHE;
+  }
 
-Try<double> LxcResourceCollector::getControlGroupDoubleValue(const std::string& property) const
-{
-  std::stringstream ss;
-
-  if (getControlGroupValue(&ss, property)) {
-    double d;
-    ss >> d;
-    return d;
-  } else {
-    return Try<double>::error("unable to read control group double value");
+  // Only reported by newer kernels.
+  double majorFaults;
+  if (lookup(memory, "pgmajfault", &majorFaults)) {
+    usage->fields |= USAGE_MAJOR_FAULTS;
+    usage->majorFaults = majorFaults - previousMajorFaults;
+    previousMajorFaults = majorFaults;
   }
+
+  return true;
 }
 
 Try<seconds> LxcResourceCollector::getContainerStartTime() const
@@ -22,6 +22,7 @@
 #include <string>
 
 #include "common/seconds.hpp"
+#include "monitoring/linux/cgroup_reader.hpp"
 #include "monitoring/resource_collector.hpp"
 
 namespace mesos {
@@ -31,20 +32,22 @@ namespace monitoring {
 class LxcResourceCollector : public ResourceCollector
 {
 public:
-  LxcResourceCollector(const std::string& _containerName);
+  LxcResourceCollector(const std::string& _containerName,
+                       const std::string& mountinfo = "/proc/self/mountinfo");
   virtual ~LxcResourceCollector();
 
-  virtual Try<double> getMemoryUsage();
-  virtual Try<Rate> getCpuUsage();
+  virtual bool collect(UsageRecord* usage, std::string* error);
 
 protected:
   const std::string containerName;
   double previousTimestamp;//FIXME(sam): having the 'uninitialized' value of -1.0 is a little hacky
-  double previousCpuTicks;
+  double previousCpuTime;
+  double previousUserTime;
+  double previousSystemTime;
+  double previousMajorFaults;
 
-  Try<double> getControlGroupDoubleValue(const std::string& property) const;
-
-  bool getControlGroupValue(std::iostream* ios, const std::string& property) const;
+  // Reads the container's control groups straight from cgroupfs.
+  CgroupReader cgroups;
 
   // gets the approximate start time for the container
   // used initial call of collectUsage when no previous data is available
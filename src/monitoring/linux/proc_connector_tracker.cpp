@@ -0,0 +1,413 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <linux/cn_proc.h>
+#include <linux/connector.h>
+#include <linux/netlink.h>
+
+#include <sys/socket.h>
+#include <sys/types.h>
+
+#include <list>
+#include <vector>
+
+#include <tr1/memory>
+
+#include <glog/logging.h>
+
+#include "common/foreach.hpp"
+#include "common/hashmap.hpp"
+#include "common/hashset.hpp"
+#include "common/lock.hpp"
+#include "common/try.hpp"
+
+#include "monitoring/linux/proc_connector_tracker.hpp"
+#include "monitoring/linux/proc_snapshot.hpp"
+
+#include "monitoring/process_stats.hpp"
+
+using std::list;
+using std::tr1::shared_ptr;
+
+namespace mesos {
+namespace internal {
+namespace monitoring {
+
+// The most forks to keep for catching trees up with after seeding them
+// from a snapshot, beyond which the next tree gets a new snapshot.
+const size_t MAX_SEED_FORKS = 4096;
+
+
+// Code for initializing the shared tracker.
+static pthread_once_t isTrackerInitialized = PTHREAD_ONCE_INIT;
+static ProcConnectorTracker* sharedTracker = NULL;
+
+
+static void initSharedTracker()
+{
+  ProcConnectorTracker* tracker = new ProcConnectorTracker();
+
+  Try<bool> connected = tracker->connect();
+  if (connected.isError()) {
+    LOG(INFO) << "Not tracking process trees through the proc connector, "
+              << "falling back to scanning /proc: " << connected.error();
+    delete tracker;
+    return;
+  }
+
+  sharedTracker = tracker;
+}
+
+
+ProcConnectorTracker* ProcConnectorTracker::instance()
+{
+  pthread_once(&isTrackerInitialized, initSharedTracker);
+  return sharedTracker;
+}
+
+
+ProcConnectorTracker::ProcConnectorTracker()
+  : fd(-1)
+{
+  pthread_mutex_init(&mutex, NULL);
+}
+
+
+ProcConnectorTracker::~ProcConnectorTracker()
+{
+  if (fd >= 0) {
+    ::close(fd);
+  }
+  pthread_mutex_destroy(&mutex);
+}
+
+
+Try<bool> ProcConnectorTracker::connect()
+{
+  int s = socket(PF_NETLINK, SOCK_DGRAM, NETLINK_CONNECTOR);
+  if (s < 0) {
+    return Try<bool>::error(
+        "Failed to create netlink socket: " + std::string(strerror(errno)));
+  }
+
+  // Events are drained by update, which must never block.
+  fcntl(s, F_SETFL, fcntl(s, F_GETFL) | O_NONBLOCK);
+  fcntl(s, F_SETFD, FD_CLOEXEC);
+
+  struct sockaddr_nl address;
+  memset(&address, 0, sizeof(address));
+  address.nl_family = AF_NETLINK;
+  address.nl_groups = CN_IDX_PROC;
+  address.nl_pid = 0; // Let the kernel pick a unique port id.
+
+  if (bind(s, (struct sockaddr*) &address, sizeof(address)) < 0) {
+    std::string error = strerror(errno);
+    ::close(s);
+    return Try<bool>::error("Failed to bind netlink socket: " + error);
+  }
+
+  // Ask the kernel to start publishing process events.
+  char buffer[NLMSG_SPACE(sizeof(struct cn_msg) + sizeof(int))];
+  memset(buffer, 0, sizeof(buffer));
+
+  struct nlmsghdr* header = (struct nlmsghdr*) buffer;
+  header->nlmsg_len = NLMSG_LENGTH(sizeof(struct cn_msg) + sizeof(int));
+  header->nlmsg_type = NLMSG_DONE;
+  header->nlmsg_pid = getpid();
+
+  struct cn_msg* message = (struct cn_msg*) NLMSG_DATA(header);
+  message->id.idx = CN_IDX_PROC;
+  message->id.val = CN_VAL_PROC;
+  message->len = sizeof(int);
+
+  int op = PROC_CN_MCAST_LISTEN;
+  memcpy(message->data, &op, sizeof(op));
+
+  if (send(s, header, header->nlmsg_len, 0) < 0) {
+    std::string error = strerror(errno);
+    ::close(s);
+    return Try<bool>::error("Failed to subscribe to process events: " + error);
+  }
+
+  fd = s;
+  return true;
+}
+
+
+Try<bool> ProcConnectorTracker::track(
+    pid_t root,
+    ProcSnapshotter* snapshotter)
+{
+  Lock lock(&mutex);
+
+  // Forks that happen while scanning stay queued on the socket and get
+  // applied by a later update, by when their parents are known.
+  bool fresh = false;
+  if (seed.get() == NULL) {
+    Try<bool> reseeded = reseed(snapshotter);
+    if (reseeded.isError()) {
+      return reseeded;
+    }
+    fresh = true;
+  }
+
+  Try<list<ProcessStats> > processTree = seed->getProcessTree(root);
+
+  // A root started after the shared snapshot was taken is not in it
+  // (its fork got logged before it could be tracked), so scan again.
+  if (processTree.isError() && !fresh) {
+    Try<bool> reseeded = reseed(snapshotter);
+    if (reseeded.isError()) {
+      return reseeded;
+    }
+    processTree = seed->getProcessTree(root);
+  }
+
+  if (processTree.isError()) {
+    return Try<bool>::error(processTree.error());
+  }
+
+  // Start over in case the root was tracked already.
+  forget(root);
+
+  // A process that is in another tree by now got its pid from a fork
+  // since the snapshot.
+  foreach (const ProcessStats& process, processTree.get()) {
+    if (!roots.contains(process.pid)) {
+      add(root, process.pid);
+    }
+  }
+
+  // Catch up with the forks applied since the snapshot was taken (which
+  // could not be applied to this tree back then).
+  foreach (const proc_event& event, forks) {
+    pid_t parent = event.event_data.fork.parent_tgid;
+    pid_t child = event.event_data.fork.child_tgid;
+
+    hashmap<pid_t, pid_t>::iterator iterator = roots.find(child);
+    if (iterator != roots.end() && iterator->second == root) {
+      erase(child); // The pid got reused.
+    }
+
+    iterator = roots.find(parent);
+    if (iterator != roots.end() && iterator->second == root) {
+      add(root, child);
+    }
+  }
+
+  return true;
+}
+
+
+void ProcConnectorTracker::untrack(pid_t root)
+{
+  Lock lock(&mutex);
+  forget(root);
+}
+
+
+bool ProcConnectorTracker::isTracking(pid_t root)
+{
+  Lock lock(&mutex);
+  return trees.find(root) != trees.end();
+}
+
+
+void ProcConnectorTracker::update()
+{
+  Lock lock(&mutex);
+
+  if (fd < 0) {
+    return;
+  }
+
+  char buffer[8192];
+
+  while (true) {
+    ssize_t length = recv(fd, buffer, sizeof(buffer), 0);
+
+    if (length < 0) {
+      if (errno == EINTR) {
+        continue;
+      } else if (errno == ENOBUFS) {
+        // Some events were dropped, so none of the trees can be trusted
+        // any more.
+        LOG(WARNING) << "Lost process events, rescanning "
+                     << trees.size() << " process trees";
+        trees.clear();
+        roots.clear();
+
+        // Nor can the forks since the seed, so take a new one.
+        seed.reset();
+        forks.clear();
+        continue;
+      }
+
+      if (errno != EAGAIN && errno != EWOULDBLOCK) {
+        PLOG(WARNING) << "Failed to receive process events";
+      }
+      return;
+    }
+
+    struct nlmsghdr* header = (struct nlmsghdr*) buffer;
+    for (int remaining = length;
+         NLMSG_OK(header, remaining);
+         header = NLMSG_NEXT(header, remaining)) {
+      if (header->nlmsg_type == NLMSG_NOOP ||
+          header->nlmsg_type == NLMSG_ERROR) {
+        continue;
+      }
+
+      struct cn_msg* message = (struct cn_msg*) NLMSG_DATA(header);
+      if (message->id.idx != CN_IDX_PROC ||
+          message->id.val != CN_VAL_PROC ||
+          message->len < sizeof(proc_event)) {
+        continue;
+      }
+
+      proc_event event;
+      memcpy(&event, message->data, sizeof(event));
+      apply(event);
+    }
+  }
+}
+
+
+list<pid_t> ProcConnectorTracker::getMembers(pid_t root)
+{
+  Lock lock(&mutex);
+
+  list<pid_t> members;
+
+  hashmap<pid_t, hashset<pid_t> >::iterator iterator = trees.find(root);
+  if (iterator != trees.end()) {
+    foreach (pid_t pid, iterator->second) {
+      if (pid == root) {
+        members.push_front(pid);
+      } else {
+        members.push_back(pid);
+      }
+    }
+  }
+
+  return members;
+}
+
+
+void ProcConnectorTracker::remove(pid_t pid)
+{
+  Lock lock(&mutex);
+  erase(pid);
+}
+
+
+void ProcConnectorTracker::process(const proc_event& event)
+{
+  Lock lock(&mutex);
+  apply(event);
+}
+
+
+void ProcConnectorTracker::apply(const proc_event& event)
+{
+  if (event.what != proc_event::PROC_EVENT_FORK) {
+    // Neither exec nor exit change the membership of a tree: the pid
+    // stays the same across an exec, and a process that exited stays
+    // a member until it has been reaped (see remove).
+    return;
+  }
+
+  pid_t parent = event.event_data.fork.parent_tgid;
+  pid_t child = event.event_data.fork.child_tgid;
+
+  // A new thread of an existing process, not a new process.
+  if (event.event_data.fork.child_pid != child) {
+    return;
+  }
+
+  // Keep the fork for the trees still to be seeded from the snapshot.
+  if (seed.get() != NULL) {
+    if (forks.size() < MAX_SEED_FORKS) {
+      forks.push_back(event);
+    } else {
+      seed.reset();
+      forks.clear();
+    }
+  }
+
+  // The pid is being reused, so whatever it belonged to is gone.
+  erase(child);
+
+  hashmap<pid_t, pid_t>::iterator iterator = roots.find(parent);
+  if (iterator != roots.end()) {
+    add(iterator->second, child);
+  }
+}
+
+
+void ProcConnectorTracker::add(pid_t root, pid_t pid)
+{
+  trees[root].insert(pid);
+  roots[pid] = root;
+}
+
+
+void ProcConnectorTracker::erase(pid_t pid)
+{
+  hashmap<pid_t, pid_t>::iterator iterator = roots.find(pid);
+  if (iterator != roots.end()) {
+    // The root stays tracked even once it is gone itself, until the
+    // collector stops tracking it.
+    trees[iterator->second].erase(pid);
+    roots.erase(iterator);
+  }
+}
+
+
+void ProcConnectorTracker::forget(pid_t root)
+{
+  hashmap<pid_t, hashset<pid_t> >::iterator iterator = trees.find(root);
+  if (iterator != trees.end()) {
+    foreach (pid_t pid, iterator->second) {
+      roots.erase(pid);
+    }
+    trees.erase(iterator);
+  }
+}
+
+
+Try<bool> ProcConnectorTracker::reseed(ProcSnapshotter* snapshotter)
+{
+  Try<shared_ptr<const ProcSnapshot> > snapshot = snapshotter->snapshot(0, 0);
+  if (snapshot.isError()) {
+    return Try<bool>::error(snapshot.error());
+  }
+  seed = snapshot.get();
+  forks.clear();
+  return true;
+}
+
+} // namespace monitoring {
+} // namespace internal {
+} // namespace mesos {
@@ -0,0 +1,134 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __PROC_CONNECTOR_TRACKER_HPP__
+#define __PROC_CONNECTOR_TRACKER_HPP__
+
+#include <pthread.h>
+
+#include <linux/cn_proc.h>
+
+#include <sys/types.h>
+
+#include <list>
+#include <vector>
+
+#include <tr1/memory>
+
+#include "common/hashmap.hpp"
+#include "common/hashset.hpp"
+#include "common/try.hpp"
+
+#include "monitoring/linux/proc_snapshot.hpp"
+
+#include "monitoring/process_stats.hpp"
+
+namespace mesos {
+namespace internal {
+namespace monitoring {
+
+// Keeps the process trees of executors up to date from the fork events
+// the kernel publishes through the netlink proc connector, so that a
+// collector can read the stats of just the members of its tree instead
+// of scanning all of /proc to find them.
+//
+// A tree is seeded from a scan of /proc once and then grows with every
+// fork of one of its members. Processes are only dropped from a tree
+// once their stats can no longer be read (see remove), rather than on
+// exit, so that a zombie still counts until its parent has reaped it
+// and picked up its cpu time. A pid that gets reused shows up in a
+// fork event first and is moved to the tree of its new parent, if any.
+//
+// Subscribing to the proc connector requires CAP_NET_ADMIN, so the
+// shared tracker is only available when the slave runs as root.
+class ProcConnectorTracker
+{
+public:
+  // Returns the tracker shared by all collectors in this process, or
+  // NULL if the proc connector is not available.
+  static ProcConnectorTracker* instance();
+
+  // Creates a tracker that does not receive events until connected.
+  ProcConnectorTracker();
+
+  virtual ~ProcConnectorTracker();
+
+  // Subscribes to process events.
+  Try<bool> connect();
+
+  // Starts tracking the tree rooted at 'root', returning an error if
+  // there is no such process. The tree is seeded from a snapshot taken
+  // while no events got applied, and then caught up with the forks
+  // applied since, so that none of them go missing. All trees share
+  // that snapshot (e.g., when they all need seeding again after events
+  // were lost), until events are lost again or too many forks have
+  // been applied since it was taken, or a root is not in it.
+  Try<bool> track(pid_t root, ProcSnapshotter* snapshotter);
+
+  // Stops tracking the tree rooted at 'root'.
+  void untrack(pid_t root);
+
+  bool isTracking(pid_t root);
+
+  // Applies the events that arrived since the previous update. If the
+  // kernel had to drop events because the socket buffer overflowed,
+  // all trees are forgotten so that collectors seed them again.
+  void update();
+
+  // Returns the members of the tree rooted at 'root', root first.
+  std::list<pid_t> getMembers(pid_t root);
+
+  // Drops a process whose stats could not be read from its tree.
+  void remove(pid_t pid);
+
+  // Applies a single event. Used by update, and by tests to feed
+  // synthetic events.
+  void process(const proc_event& event);
+
+private:
+  // No copying, no assigning.
+  ProcConnectorTracker(const ProcConnectorTracker&);
+  ProcConnectorTracker& operator = (const ProcConnectorTracker&);
+
+  // These expect the lock to be held.
+  void apply(const proc_event& event);
+  void add(pid_t root, pid_t pid);
+  void erase(pid_t pid);
+  void forget(pid_t root);
+
+  // Takes a new snapshot to seed trees from.
+  Try<bool> reseed(ProcSnapshotter* snapshotter);
+
+  int fd; // The netlink socket, or -1.
+
+  pthread_mutex_t mutex;
+
+  hashmap<pid_t, hashset<pid_t> > trees; // Root -> members.
+  hashmap<pid_t, pid_t> roots;           // Member -> root.
+
+  // The snapshot trees are seeded from (if any), and the forks applied
+  // since it was taken.
+  std::tr1::shared_ptr<const ProcSnapshot> seed;
+  std::vector<proc_event> forks;
+};
+
+} // namespace monitoring {
+} // namespace internal {
+} // namespace mesos {
+
+#endif // __PROC_CONNECTOR_TRACKER_HPP__
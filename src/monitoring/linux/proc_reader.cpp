@@ -0,0 +1,241 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include <sys/resource.h>
+#include <sys/types.h>
+
+#include <list>
+
+#include "common/foreach.hpp"
+#include "common/hashmap.hpp"
+
+#include "monitoring/linux/proc_reader.hpp"
+#include "monitoring/linux/proc_utils.hpp"
+
+using std::list;
+
+namespace mesos {
+namespace internal {
+namespace monitoring {
+
+// Opens /proc/<pid>/<file> for reading. The descriptor is kept open
+// across samples, so it must not leak into the executors we launch.
+static int openProcFile(pid_t pid, const char* file)
+{
+  char path[64];
+  snprintf(path, sizeof(path), "/proc/%d/%s", pid, file);
+  return ::open(path, O_RDONLY | O_CLOEXEC);
+}
+
+
+ProcReader::ProcReader(size_t _maxProcesses)
+  : maxProcesses(_maxProcesses) {}
+
+
+ProcReader::~ProcReader()
+{
+  foreachvalue (const Entry& entry, entries) {
+    close(entry);
+  }
+}
+
+
+bool ProcReader::readStat(pid_t pid, ProcStat* stat)
+{
+  char buffer[1024];
+  ssize_t length;
+
+  hashmap<pid_t, Entry>::iterator iterator = entries.find(pid);
+  if (iterator != entries.end() && iterator->second.stat >= 0) {
+    Entry& entry = iterator->second;
+    length = preadProcFile(entry.stat, buffer, sizeof(buffer));
+    if (length > 0 &&
+        parseProcStat(buffer, length, stat) &&
+        stat->starttime == entry.starttime) {
+      entry.used = true;
+      return true;
+    }
+
+    // The process has exited, and the pid might have been reused.
+    close(entry);
+    entries.erase(iterator);
+    iterator = entries.end();
+  }
+
+  int fd = openProcFile(pid, "stat");
+  if (fd < 0) {
+    return false;
+  }
+
+  length = preadProcFile(fd, buffer, sizeof(buffer));
+  if (length <= 0 || !parseProcStat(buffer, length, stat)) {
+    ::close(fd);
+    return false;
+  }
+
+  if (iterator != entries.end()) {
+    // The other files were read first, their descriptors fail on their
+    // own should they belong to a previous process with this pid.
+    iterator->second.starttime = stat->starttime;
+    iterator->second.stat = fd;
+    iterator->second.used = true;
+  } else if (entries.size() < maxProcesses) {
+    entries[pid] = Entry(stat->starttime, fd);
+  } else {
+    ::close(fd);
+  }
+
+  return true;
+}
+
+
+bool ProcReader::readStatm(pid_t pid, ProcStatm* statm)
+{
+  char buffer[256];
+  ssize_t length = readFile(pid, &Entry::statm, "statm", buffer, sizeof(buffer));
+  return length > 0 && parseProcStatm(buffer, length, statm);
+}
+
+
+bool ProcReader::readIo(pid_t pid, ProcIo* io)
+{
+  char buffer[512];
+  ssize_t length = readFile(pid, &Entry::io, "io", buffer, sizeof(buffer));
+  return length > 0 && parseProcIo(buffer, length, io);
+}
+
+
+bool ProcReader::readStatus(pid_t pid, ProcStatus* status)
+{
+  char buffer[4096];
+  ssize_t length =
+    readFile(pid, &Entry::status, "status", buffer, sizeof(buffer));
+  return length > 0 && parseProcStatus(buffer, length, status);
+}
+
+
+ssize_t ProcReader::readFile(
+    pid_t pid,
+    int Entry::*fd,
+    const char* file,
+    char* buffer,
+    size_t size)
+{
+  hashmap<pid_t, Entry>::iterator iterator = entries.find(pid);
+  if (iterator == entries.end()) {
+    if (entries.size() >= maxProcesses) {
+      // Not cached, so fall back to reading the file once.
+      int once = openProcFile(pid, file);
+      if (once < 0) {
+        return -1;
+      }
+      ssize_t length = preadProcFile(once, buffer, size);
+      ::close(once);
+      return length;
+    }
+
+    // Cache the process without reading its stat, e.g., because its
+    // stats came from a snapshot.
+    int opened = openProcFile(pid, file);
+    if (opened < 0) {
+      return -1;
+    }
+    iterator = entries.insert(std::make_pair(pid, Entry())).first;
+    iterator->second.*fd = opened;
+  }
+
+  Entry& entry = iterator->second;
+  entry.used = true;
+  if (entry.*fd < 0) {
+    entry.*fd = openProcFile(pid, file);
+    if (entry.*fd < 0) {
+      return -1;
+    }
+  }
+
+  ssize_t length = preadProcFile(entry.*fd, buffer, size);
+  if (length <= 0) {
+    // Reopen on the next read in case the failure was transient; the
+    // next readStat() will find out whether the process is gone.
+    ::close(entry.*fd);
+    entry.*fd = -1;
+  }
+
+  return length;
+}
+
+
+void ProcReader::sweep()
+{
+  list<pid_t> unused;
+
+  foreachpair (pid_t pid, Entry& entry, entries) {
+    if (entry.used) {
+      entry.used = false;
+    } else {
+      unused.push_back(pid);
+    }
+  }
+
+  foreach (pid_t pid, unused) {
+    close(entries[pid]);
+    entries.erase(pid);
+  }
+}
+
+
+size_t ProcReader::size() const
+{
+  return entries.size();
+}
+
+
+size_t ProcReader::defaultMaxProcesses()
+{
+  struct rlimit limit;
+  if (getrlimit(RLIMIT_NOFILE, &limit) != 0 ||
+      limit.rlim_cur == RLIM_INFINITY) {
+    return 1024;
+  }
+  return limit.rlim_cur / 8;
+}
+
+
+void ProcReader::close(const Entry& entry)
+{
+  if (entry.stat >= 0) {
+    ::close(entry.stat);
+  }
+  if (entry.statm >= 0) {
+    ::close(entry.statm);
+  }
+  if (entry.io >= 0) {
+    ::close(entry.io);
+  }
+  if (entry.status >= 0) {
+    ::close(entry.status);
+  }
+}
+
+} // namespace monitoring {
+} // namespace internal {
+} // namespace mesos {
@@ -0,0 +1,108 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __PROC_READER_HPP__
+#define __PROC_READER_HPP__
+
+#include <sys/types.h>
+
+#include "common/hashmap.hpp"
+
+#include "monitoring/linux/proc_utils.hpp"
+
+namespace mesos {
+namespace internal {
+namespace monitoring {
+
+// Reads /proc/<pid>/{stat,statm,io,status} through file descriptors that are
+// kept open across calls and re-read with pread(), which saves an
+// open()/close() pair per process per collection interval.
+//
+// A cached descriptor keeps referring to the process it was opened
+// for, so reads through it fail once that process exits. The entry
+// for a pid is only trusted while the starttime read from its stat
+// file matches the one seen when it was opened, at which point a
+// reused pid is detected and all of the entry's descriptors reopened.
+//
+// Not thread safe.
+class ProcReader
+{
+public:
+  // Caches descriptors for at most 'maxProcesses' processes, reading
+  // any others with open()/read()/close(). Each process uses up to
+  // four descriptors. The default is an eighth of RLIMIT_NOFILE.
+  explicit ProcReader(size_t maxProcesses = defaultMaxProcesses());
+
+  ~ProcReader();
+
+  // Reads /proc/<pid>/stat. Returns false if the process is gone.
+  bool readStat(pid_t pid, ProcStat* stat);
+
+  // Reads /proc/<pid>/statm, /proc/<pid>/io and /proc/<pid>/status.
+  // These need not follow a readStat(): a descriptor of an exited
+  // process fails and gets reopened by the next read, so at worst one
+  // read of a reused pid fails. Reading io requires the same
+  // permissions as ptrace.
+  bool readStatm(pid_t pid, ProcStatm* statm);
+  bool readIo(pid_t pid, ProcIo* io);
+  bool readStatus(pid_t pid, ProcStatus* status);
+
+  // Closes the descriptors of every process that has not been read
+  // since the previous sweep, e.g., because it exited.
+  void sweep();
+
+  // Returns the number of processes with cached descriptors.
+  size_t size() const;
+
+  static size_t defaultMaxProcesses();
+
+private:
+  // No copying, no assigning.
+  ProcReader(const ProcReader&);
+  ProcReader& operator = (const ProcReader&);
+
+  struct Entry
+  {
+    Entry(unsigned long long _starttime = 0, int _stat = -1)
+      : starttime(_starttime), stat(_stat), statm(-1), io(-1), status(-1),
+        used(true) {}
+
+    unsigned long long starttime; // Only known once stat was read.
+    int stat;
+    int statm;
+    int io;
+    int status;
+    bool used; // Whether the entry was read since the last sweep.
+  };
+
+  // Reads the given file of a cached process, opening it if needed.
+  ssize_t readFile(pid_t pid, int Entry::*fd, const char* file,
+                   char* buffer, size_t size);
+
+  static void close(const Entry& entry);
+
+  const size_t maxProcesses;
+
+  hashmap<pid_t, Entry> entries;
+};
+
+} // namespace monitoring {
+} // namespace internal {
+} // namespace mesos {
+
+#endif // __PROC_READER_HPP__
@@ -17,58 +17,92 @@
  */
 
 #include <list>
+#include <tr1/memory>
 
 #include <sys/types.h>
 
 #include "common/foreach.hpp"
 #include "common/try.hpp"
+#include "common/utils.hpp"
 
+#include "monitoring/linux/proc_connector_tracker.hpp"
+#include "monitoring/linux/proc_reader.hpp"
 #include "monitoring/linux/proc_resource_collector.hpp"
+#include "monitoring/linux/proc_snapshot.hpp"
 #include "monitoring/linux/proc_utils.hpp"
 
 #include "monitoring/process_stats.hpp"
 
 using std::list;
+using std::tr1::shared_ptr;
 
 namespace mesos {
 namespace internal {
 namespace monitoring {
 
-ProcResourceCollector::ProcResourceCollector(pid_t _rootPid) :
-  ProcessResourceCollector(_rootPid) {}
+ProcResourceCollector::ProcResourceCollector(
+    pid_t _rootPid,
+    ProcSnapshotter* _snapshotter,
+    ProcConnectorTracker* _tracker)
+  : ProcessResourceCollector(_rootPid),
+    snapshotter(_snapshotter),
+    tracker(_tracker),
+    generation(0) {}
 
-ProcResourceCollector::~ProcResourceCollector() {}
+ProcResourceCollector::~ProcResourceCollector()
+{
+  if (tracker != NULL) {
+    tracker->untrack(rootPid);
+  }
+}
 
-// TODO(adegtiar): consider doing a full tree walk.
 Try<list<ProcessStats> > ProcResourceCollector::getProcessTreeStats()
 {
-  list<ProcessStats> processTree;
-  Try<ProcessStats> tryRootStats = getProcessStats(rootPid);
-  if (tryRootStats.isError()) {
-    return Try<list<ProcessStats> >::error(tryRootStats.error());
-  }
-  ProcessStats rootProcess = tryRootStats.get();
-  Try<list<pid_t> > allPidsTry = getAllPids();
-  if (allPidsTry.isError()) {
-    return Try<list<ProcessStats> >::error(allPidsTry.error());
-  }
-  list<pid_t> allPids = allPidsTry.get();
-  // Attempt to add all process in the same tree by checking for:
-  //   1) Direct child via match on ppid.
-  //   2) Same process group as root.
-  //   3) Same session as root.
-  foreach (pid_t pid, allPids) {
-    Try<ProcessStats> tryNextProcess = getProcessStats(pid);
-    if (tryNextProcess.isSome()) {
-      ProcessStats nextProcess = tryNextProcess.get();
-      if (nextProcess.ppid == rootProcess.ppid ||
-          nextProcess.pgrp == rootProcess.pgrp ||
-          nextProcess.sid == rootProcess.sid) {
-        processTree.push_back(nextProcess);
+  if (tracker != NULL) {
+    tracker->update();
+
+    if (!tracker->isTracking(rootPid)) {
+      Try<bool> tracked = tracker->track(rootPid, snapshotter);
+      if (tracked.isError()) {
+        return Try<list<ProcessStats> >::error(tracked.error());
+      }
+    }
+
+    Try<seconds> bootTime = getBootTime();
+    if (bootTime.isError()) {
+      return Try<list<ProcessStats> >::error(bootTime.error());
+    }
+
+    // The root is dropped from its tree if its pid got reused.
+    list<pid_t> members = tracker->getMembers(rootPid);
+    if (members.empty() || members.front() != rootPid) {
+      return Try<list<ProcessStats> >::error(
+          "Process " + utils::stringify(rootPid) + " not found");
+    }
+
+    list<ProcessStats> processes;
+    ProcStat stat;
+    foreach (pid_t pid, members) {
+      if (reader.readStat(pid, &stat)) {
+        processes.push_back(toProcessStats(stat, bootTime.get()));
+      } else if (pid == rootPid) {
+        return Try<list<ProcessStats> >::error(
+            "Process " + utils::stringify(rootPid) + " not found");
+      } else {
+        tracker->remove(pid); // The process has been reaped.
       }
-    } // else process must have died in between calls.
+    }
+
+    return processes;
   }
-  return processTree;
+
+  Try<shared_ptr<const ProcSnapshot> > snapshot =
+    snapshotter->snapshot(generation);
+  if (snapshot.isError()) {
+    return Try<list<ProcessStats> >::error(snapshot.error());
+  }
+  generation = snapshot.get()->generation;
+  return snapshot.get()->getProcessTree(rootPid);
 }
 
 Try<seconds> ProcResourceCollector::getStartTime()
@@ -76,6 +110,62 @@ Try<seconds> ProcResourceCollector::getStartTime()
   return monitoring::getStartTime(rootPid);
 }
 
+void ProcResourceCollector::collectProcessTreeUsage(
+    const list<ProcessStats>& processes, UsageRecord* usage)
+{
+  double ioReadBytes = 0, ioWriteBytes = 0, contextSwitches = 0;
+
+  // Whether any process could be read at all. A process that can't be
+  // (e.g., the io of a process we lack ptrace permissions for) keeps
+  // its previous value rather than hiding the rest of the tree.
+  bool haveIo = false, haveContextSwitches = false;
+
+  // The stats came from the snapshot (or were just read through the
+  // reader), so only io and status are read here. Those fail for a
+  // process that exited since, which then keeps its previous values.
+  ProcIo io;
+  ProcStatus status;
+  foreach (const ProcessStats& process, processes) {
+    if (reader.readIo(process.pid, &io)) {
+      ioReadBytes += counterDelta(process, IO_READ_BYTES, io.readBytes);
+      ioWriteBytes += counterDelta(process, IO_WRITE_BYTES, io.writeBytes);
+      haveIo = true;
+    } else {
+      keepCounter(process, IO_READ_BYTES);
+      keepCounter(process, IO_WRITE_BYTES);
+    }
+
+    if (reader.readStatus(process.pid, &status)) {
+      contextSwitches += counterDelta(
+          process,
+          CONTEXT_SWITCHES,
+          status.voluntaryCtxtSwitches + status.nonvoluntaryCtxtSwitches);
+      haveContextSwitches = true;
+    } else {
+      keepCounter(process, CONTEXT_SWITCHES);
+    }
+  }
+
+  reader.sweep();
+
+  // The first sample is only a baseline, the processes have been
+  // doing io and switching since well before it.
+  if (isFirstSample()) {
+    return;
+  }
+
+  if (haveIo) {
+    usage->fields |= USAGE_IO;
+    usage->ioReadBytes = ioReadBytes;
+    usage->ioWriteBytes = ioWriteBytes;
+  }
+
+  if (haveContextSwitches) {
+    usage->fields |= USAGE_CONTEXT_SWITCHES;
+    usage->contextSwitches = contextSwitches;
+  }
+}
+
 } // namespace monitoring {
 } // namespace internal {
 } // namespace mesos {
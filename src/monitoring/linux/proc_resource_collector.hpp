@@ -19,12 +19,18 @@
 #ifndef __PROC_RESOURCE_COLLECTOR_HPP__
 #define __PROC_RESOURCE_COLLECTOR_HPP__
 
+#include <stdint.h>
+
 #include <list>
 
 #include <sys/types.h>
 
 #include "common/try.hpp"
 
+#include "monitoring/linux/proc_connector_tracker.hpp"
+#include "monitoring/linux/proc_reader.hpp"
+#include "monitoring/linux/proc_snapshot.hpp"
+
 #include "monitoring/process_resource_collector.hpp"
 #include "monitoring/process_stats.hpp"
 
@@ -34,11 +40,20 @@ namespace monitoring {
 
 // An implementation of the ProcessResourceCollector class that
 // retrieves resource usage information for a process and all its
-// (sub)children from proc.
+// (sub)children from proc. The process tree is extracted from a
+// snapshot of /proc that is shared with the other collectors on the
+// slave (see ProcSnapshotter). When the proc connector is available
+// the tree is only extracted from a snapshot once and then kept up to
+// date from fork events (see ProcConnectorTracker), so that sampling
+// reads just the files of the processes in the tree.
 class ProcResourceCollector : public ProcessResourceCollector
 {
 public:
-  ProcResourceCollector(pid_t rootPid);
+  ProcResourceCollector(pid_t rootPid,
+                        ProcSnapshotter* snapshotter =
+                          ProcSnapshotter::instance(),
+                        ProcConnectorTracker* tracker =
+                          ProcConnectorTracker::instance());
 
   virtual ~ProcResourceCollector();
 
@@ -46,6 +61,30 @@ protected:
   virtual Try<std::list<ProcessStats> > getProcessTreeStats();
 
   virtual Try<seconds> getStartTime();
+
+  // Adds io and context switches, which are not part of the snapshot.
+  virtual void collectProcessTreeUsage(
+      const std::list<ProcessStats>& processes, UsageRecord* usage);
+
+  // The extra counters kept per process (see counterDelta), subclasses
+  // continue from COUNTERS.
+  enum {
+    IO_READ_BYTES,
+    IO_WRITE_BYTES,
+    CONTEXT_SWITCHES,
+    COUNTERS
+  };
+
+private:
+  ProcSnapshotter* snapshotter;
+
+  ProcConnectorTracker* tracker; // Possibly NULL.
+
+  // Generation of the last snapshot this collector used.
+  uint64_t generation;
+
+  // Keeps the io and status files of the process tree open.
+  ProcReader reader;
 };
 
 } // namespace monitoring {
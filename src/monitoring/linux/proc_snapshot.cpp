@@ -0,0 +1,229 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <pthread.h>
+#include <stdint.h>
+
+#include <sys/types.h>
+
+#include <list>
+#include <tr1/memory>
+#include <utility>
+
+#include <process/process.hpp>
+
+#include "common/foreach.hpp"
+#include "common/hashmap.hpp"
+#include "common/hashset.hpp"
+#include "common/lock.hpp"
+#include "common/seconds.hpp"
+#include "common/try.hpp"
+#include "common/utils.hpp"
+
+#include "monitoring/linux/proc_reader.hpp"
+#include "monitoring/linux/proc_snapshot.hpp"
+#include "monitoring/linux/proc_utils.hpp"
+
+#include "monitoring/process_stats.hpp"
+
+using process::Clock;
+
+using std::list;
+using std::tr1::shared_ptr;
+
+namespace mesos {
+namespace internal {
+namespace monitoring {
+
+ProcSnapshot::ProcSnapshot(uint64_t _generation)
+  : generation(_generation) {}
+
+
+void ProcSnapshot::add(const ProcessStats& process)
+{
+  processes.insert(std::make_pair(process.pid, process));
+  children[process.ppid].push_back(process.pid);
+  sessions[process.sid].push_back(process.pid);
+}
+
+
+Try<ProcessStats> ProcSnapshot::get(pid_t pid) const
+{
+  hashmap<pid_t, ProcessStats>::const_iterator iterator = processes.find(pid);
+  if (iterator == processes.end()) {
+    return Try<ProcessStats>::error(
+        "Process " + utils::stringify(pid) + " not found in snapshot");
+  }
+  return iterator->second;
+}
+
+
+Try<list<ProcessStats> > ProcSnapshot::getProcessTree(pid_t rootPid) const
+{
+  Try<ProcessStats> root = get(rootPid);
+  if (root.isError()) {
+    return Try<list<ProcessStats> >::error(root.error());
+  }
+
+  list<ProcessStats> processTree;
+  processTree.push_back(root.get());
+
+  // Walk the children and sessions indices breadth first. The visited
+  // set guards against cycles that pid reuse in between reads could
+  // introduce.
+  hashset<pid_t> visited;
+  visited.insert(rootPid);
+
+  list<pid_t> pending;
+  pending.push_back(rootPid);
+
+  while (!pending.empty()) {
+    const ProcessStats& parent = processes.find(pending.front())->second;
+    pending.pop_front();
+
+    list<const list<pid_t>*> related;
+
+    hashmap<pid_t, list<pid_t> >::const_iterator iterator =
+      children.find(parent.pid);
+    if (iterator != children.end()) {
+      related.push_back(&iterator->second);
+    }
+
+    // Session leaders bring the rest of their session along.
+    if (parent.pid == parent.sid) {
+      iterator = sessions.find(parent.sid);
+      if (iterator != sessions.end()) {
+        related.push_back(&iterator->second);
+      }
+    }
+
+    foreach (const list<pid_t>* pids, related) {
+      foreach (pid_t pid, *pids) {
+        if (visited.insert(pid).second) {
+          processTree.push_back(processes.find(pid)->second);
+          pending.push_back(pid);
+        }
+      }
+    }
+  }
+
+  return processTree;
+}
+
+
+size_t ProcSnapshot::size() const
+{
+  return processes.size();
+}
+
+
+// Code for initializing the shared snapshotter.
+static pthread_once_t isSnapshotterInitialized = PTHREAD_ONCE_INIT;
+static ProcSnapshotter* sharedSnapshotter = NULL;
+
+
+static void initSharedSnapshotter()
+{
+  sharedSnapshotter = new ProcSnapshotter();
+}
+
+
+ProcSnapshotter* ProcSnapshotter::instance()
+{
+  pthread_once(&isSnapshotterInitialized, initSharedSnapshotter);
+  return sharedSnapshotter;
+}
+
+
+ProcSnapshotter::ProcSnapshotter(double _maxAge)
+  : maxAge(_maxAge), cachedTime(0), generation(0)
+{
+  pthread_mutex_init(&mutex, NULL);
+}
+
+
+ProcSnapshotter::~ProcSnapshotter()
+{
+  pthread_mutex_destroy(&mutex);
+}
+
+
+Try<shared_ptr<const ProcSnapshot> > ProcSnapshotter::snapshot(
+    uint64_t previous)
+{
+  return snapshot(previous, maxAge);
+}
+
+
+Try<shared_ptr<const ProcSnapshot> > ProcSnapshotter::snapshot(
+    uint64_t previous, double _maxAge)
+{
+  // Holding the lock while scanning makes concurrent collectors wait
+  // for (and then share) a single scan instead of each doing their own.
+  Lock lock(&mutex);
+
+  if (cached.get() != NULL &&
+      cached->generation != previous &&
+      Clock::now() - cachedTime < _maxAge) {
+    return cached;
+  }
+
+  Try<ProcSnapshot*> snapshot = scan(generation + 1);
+  if (snapshot.isError()) {
+    return Try<shared_ptr<const ProcSnapshot> >::error(snapshot.error());
+  }
+
+  generation++;
+  cached = shared_ptr<const ProcSnapshot>(snapshot.get());
+  cachedTime = Clock::now();
+
+  return cached;
+}
+
+
+Try<ProcSnapshot*> ProcSnapshotter::scan(uint64_t generation)
+{
+  Try<list<pid_t> > allPids = getAllPids();
+  if (allPids.isError()) {
+    return Try<ProcSnapshot*>::error(allPids.error());
+  }
+
+  Try<seconds> bootTime = getBootTime();
+  if (bootTime.isError()) {
+    return Try<ProcSnapshot*>::error(bootTime.error());
+  }
+
+  ProcSnapshot* snapshot = new ProcSnapshot(generation);
+
+  ProcStat stat;
+  foreach (pid_t pid, allPids.get()) {
+    if (reader.readStat(pid, &stat)) {
+      snapshot->add(toProcessStats(stat, bootTime.get()));
+    } // else process must have died in between calls.
+  }
+
+  // Close the files of the processes that have exited since the
+  // previous scan.
+  reader.sweep();
+
+  return snapshot;
+}
+
+} // namespace monitoring {
+} // namespace internal {
+} // namespace mesos {
@@ -0,0 +1,136 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __PROC_SNAPSHOT_HPP__
+#define __PROC_SNAPSHOT_HPP__
+
+#include <pthread.h>
+#include <stdint.h>
+
+#include <sys/types.h>
+
+#include <list>
+#include <tr1/memory>
+
+#include "common/hashmap.hpp"
+#include "common/try.hpp"
+
+#include "monitoring/linux/proc_reader.hpp"
+
+#include "monitoring/process_stats.hpp"
+
+namespace mesos {
+namespace internal {
+namespace monitoring {
+
+// How long (in seconds) a snapshot may be handed out to collectors
+// that have not seen it yet before /proc gets scanned again.
+const double PROC_SNAPSHOT_MAX_AGE = 0.25;
+
+
+// A point-in-time view of all the processes running on the system,
+// built from a single pass over /proc. Besides the stats of every
+// process, the snapshot keeps parent -> children and session ->
+// members indices so that the process tree of any executor can be
+// extracted in time proportional to the size of that tree.
+class ProcSnapshot
+{
+public:
+  explicit ProcSnapshot(uint64_t generation);
+
+  // Adds a process to the snapshot and indexes it under its parent
+  // and its session.
+  void add(const ProcessStats& process);
+
+  // Returns the stats of the process with the given PID, or an error
+  // if the process was not running when the snapshot was taken.
+  Try<ProcessStats> get(pid_t pid) const;
+
+  // Returns the stats of the process with the given PID followed by
+  // the stats of all of its descendants. Any session led by a process
+  // in the tree (e.g., the executor's own session, or one created by a
+  // task via setsid) is considered part of the tree as well, so
+  // processes that got reparented to init but stayed in such a
+  // session are still attributed to the executor.
+  Try<std::list<ProcessStats> > getProcessTree(pid_t rootPid) const;
+
+  // Returns the number of processes in the snapshot.
+  size_t size() const;
+
+  // Distinguishes the snapshots handed out by a ProcSnapshotter.
+  const uint64_t generation;
+
+private:
+  hashmap<pid_t, ProcessStats> processes;
+  hashmap<pid_t, std::list<pid_t> > children;
+  hashmap<pid_t, std::list<pid_t> > sessions;
+};
+
+
+// Takes ProcSnapshots on behalf of all the collectors on a slave so
+// that /proc gets scanned once per collection interval rather than
+// once per executor.
+class ProcSnapshotter
+{
+public:
+  // Returns the snapshotter shared by all collectors in this process.
+  static ProcSnapshotter* instance();
+
+  ProcSnapshotter(double maxAge = PROC_SNAPSHOT_MAX_AGE);
+
+  virtual ~ProcSnapshotter();
+
+  // Returns a snapshot the caller has not seen yet, i.e., one whose
+  // generation differs from 'previous'. The cached snapshot is reused
+  // if it qualifies and is younger than 'maxAge', otherwise /proc is
+  // scanned again. A caller that has not seen any snapshot passes 0.
+  Try<std::tr1::shared_ptr<const ProcSnapshot> > snapshot(uint64_t previous);
+
+  // Same as above, but with a custom bound on the age of the cached
+  // snapshot. A 'maxAge' of 0 always scans /proc.
+  Try<std::tr1::shared_ptr<const ProcSnapshot> > snapshot(
+      uint64_t previous, double maxAge);
+
+protected:
+  // Scans /proc and returns a new snapshot with the given generation.
+  virtual Try<ProcSnapshot*> scan(uint64_t generation);
+
+private:
+  // No copying, no assigning.
+  ProcSnapshotter(const ProcSnapshotter&);
+  ProcSnapshotter& operator = (const ProcSnapshotter&);
+
+  const double maxAge;
+
+  pthread_mutex_t mutex;
+
+  std::tr1::shared_ptr<const ProcSnapshot> cached;
+
+  double cachedTime; // When the cached snapshot finished scanning.
+
+  uint64_t generation; // Generation of the most recent snapshot.
+
+  // Keeps the stat files of running processes open across scans.
+  ProcReader reader;
+};
+
+} // namespace monitoring {
+} // namespace internal {
+} // namespace mesos {
+
+#endif // __PROC_SNAPSHOT_HPP__
@@ -17,7 +17,14 @@
  */
 
 #include <asm/param.h>
+#include <errno.h>
+#include <fcntl.h>
 #include <pthread.h>
+#include <stdio.h>
+#include <stddef.h>
+#include <string.h>
+#include <unistd.h>
+
 #include <sys/types.h>
 
 #include <fstream>
@@ -66,6 +73,19 @@ void initCachedBootTime()
 }
 
 
+// Code for initializing cached system constants.
+static pthread_once_t areSystemConstantsInitialized = PTHREAD_ONCE_INIT;
+static long cachedClockTicks = 0;
+static long cachedPageSize = 0;
+
+
+void initCachedSystemConstants()
+{
+  cachedClockTicks = sysconf(_SC_CLK_TCK);
+  cachedPageSize = sysconf(_SC_PAGE_SIZE);
+}
+
+
 // Converts time in jiffies to seconds.
 static inline seconds jiffiesToSeconds(double jiffies)
 {
@@ -73,40 +93,287 @@ static inline seconds jiffiesToSeconds(double jiffies)
 }
 
 
-// Converts time in system ticks (as defined by _SC_CLK_TCK, NOT CPU
-// clock ticks) to milliseconds.
-static inline seconds ticksToSeconds(double ticks)
+seconds ticksToSeconds(double ticks)
 {
-  return seconds(ticks / sysconf(_SC_CLK_TCK));
+  pthread_once(&areSystemConstantsInitialized, initCachedSystemConstants);
+  return seconds(ticks / cachedClockTicks);
 }
 
 
-Try<ProcessStats> getProcessStats(const pid_t& pid)
+// Converts a size in pages to bytes.
+static inline double pagesToBytes(double pages)
+{
+  pthread_once(&areSystemConstantsInitialized, initCachedSystemConstants);
+  return pages * cachedPageSize;
+}
+
+
+// Scans the next space separated (possibly negative) decimal number
+// starting at 'p', advancing 'p' past it.
+static inline bool scanNumber(const char*& p, const char* end, long long* value)
+{
+  while (p < end && *p == ' ') {
+    p++;
+  }
+
+  bool negative = false;
+  if (p < end && *p == '-') {
+    negative = true;
+    p++;
+  }
+
+  if (p == end || *p < '0' || *p > '9') {
+    return false;
+  }
+
+  long long result = 0;
+  while (p < end && *p >= '0' && *p <= '9') {
+    result = result * 10 + (*p - '0');
+    p++;
+  }
+
+  *value = negative ? -result : result;
+  return true;
+}
+
+
+bool parseProcStat(const char* buffer, size_t length, ProcStat* stat)
+{
+  const char* p = buffer;
+  const char* end = buffer + length;
+
+  long long pid;
+  if (!scanNumber(p, end, &pid)) {
+    return false;
+  }
+
+  // The comm field is wrapped in parentheses but may itself contain
+  // spaces and parentheses, so it ends at the last ')' in the buffer.
+  const char* comm = end;
+  while (comm > p && *(comm - 1) != ')') {
+    comm--;
+  }
+
+  if (comm == p) {
+    return false;
+  }
+
+  // Skip the state, which is a single character.
+  p = comm;
+  while (p < end && *p == ' ') {
+    p++;
+  }
+  if (p == end) {
+    return false;
+  }
+  p++;
+
+  // Fields 4 (ppid) through 24 (rss), see proc(5).
+  long long fields[21];
+  for (int i = 0; i < 21; i++) {
+    if (!scanNumber(p, end, &fields[i])) {
+      return false;
+    }
+  }
+
+  stat->pid = pid;
+  stat->ppid = fields[0];
+  stat->pgrp = fields[1];
+  stat->sid = fields[2];
+  stat->minflt = fields[6];
+  stat->majflt = fields[8];
+  stat->utime = fields[10];
+  stat->stime = fields[11];
+  stat->cutime = fields[12];
+  stat->cstime = fields[13];
+  stat->numThreads = fields[16];
+  stat->starttime = fields[18];
+  stat->vsize = fields[19];
+  stat->rss = fields[20];
+
+  return true;
+}
+
+
+bool parseProcStatm(const char* buffer, size_t length, ProcStatm* statm)
+{
+  const char* p = buffer;
+  const char* end = buffer + length;
+
+  long long fields[6];
+  for (int i = 0; i < 6; i++) {
+    if (!scanNumber(p, end, &fields[i])) {
+      return false;
+    }
+  }
+
+  statm->size = fields[0];
+  statm->resident = fields[1];
+  statm->shared = fields[2];
+  statm->text = fields[3];
+  statm->data = fields[5];
+
+  return true;
+}
+
+
+bool parseProcIo(const char* buffer, size_t length, ProcIo* io)
 {
-  string procPath = "/proc/" + utils::stringify(pid) + "/stat";
+  const char* p = buffer;
+  const char* end = buffer + length;
+
+  // Each line is "<name>: <value>", we pick the ones we need by name.
+  int found = 0;
+  while (p < end) {
+    const char* name = p;
+    while (p < end && *p != ':') {
+      p++;
+    }
+
+    size_t size = p - name;
+    p++;
+
+    long long value;
+    if (p >= end || !scanNumber(p, end, &value)) {
+      return false;
+    }
+
+    if (size == 5 && strncmp(name, "rchar", size) == 0) {
+      io->rchar = value;
+      found++;
+    } else if (size == 5 && strncmp(name, "wchar", size) == 0) {
+      io->wchar = value;
+      found++;
+    } else if (size == 10 && strncmp(name, "read_bytes", size) == 0) {
+      io->readBytes = value;
+      found++;
+    } else if (size == 11 && strncmp(name, "write_bytes", size) == 0) {
+      io->writeBytes = value;
+      found++;
+    }
+
+    while (p < end && *p != '\n') {
+      p++;
+    }
+    p++;
+  }
+
+  return found == 4;
+}
+
+
+bool parseProcStatus(const char* buffer, size_t length, ProcStatus* status)
+{
+  static const char voluntary[] = "voluntary_ctxt_switches:";
+  static const char nonvoluntary[] = "nonvoluntary_ctxt_switches:";
+
+  const char* p = buffer;
+  const char* end = buffer + length;
+
+  // Most lines are not numeric (e.g., "State:\tS (sleeping)"), so only
+  // the two counters are matched and parsed.
+  int found = 0;
+  while (p < end) {
+    const char* value = NULL;
+    if (end - p > (ptrdiff_t) sizeof(voluntary) &&
+        strncmp(p, voluntary, sizeof(voluntary) - 1) == 0) {
+      value = p + sizeof(voluntary) - 1;
+    } else if (end - p > (ptrdiff_t) sizeof(nonvoluntary) &&
+               strncmp(p, nonvoluntary, sizeof(nonvoluntary) - 1) == 0) {
+      value = p + sizeof(nonvoluntary) - 1;
+    }
+
+    if (value != NULL) {
+      while (value < end && (*value == ' ' || *value == '\t')) {
+        value++;
+      }
+
+      long long count;
+      if (!scanNumber(value, end, &count)) {
+        return false;
+      }
+
+      if (*p == 'v') {
+        status->voluntaryCtxtSwitches = count;
+      } else {
+        status->nonvoluntaryCtxtSwitches = count;
+      }
+      found++;
+    }
+
+    while (p < end && *p != '\n') {
+      p++;
+    }
+    p++;
+  }
 
-  ifstream pStatFile(procPath.c_str());
-  if (!pStatFile.is_open()) {
-    return Try<ProcessStats>::error("Cannot open " + procPath + " for stats");
+  return found == 2;
+}
+
+
+ssize_t preadProcFile(int fd, char* buffer, size_t size)
+{
+  ssize_t length;
+  do {
+    length = ::pread(fd, buffer, size, 0);
+  } while (length < 0 && errno == EINTR);
+
+  return length;
+}
+
+
+bool readProcStat(const char* path, ProcStat* stat)
+{
+  int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return false;
   }
 
-  // Dummy vars for leading entries in stat that we don't care about.
-  string comm, state, tty_nr, tpgid, flags, minflt, cminflt, majflt, cmajflt;
-  string cutime, cstime, priority, nice, num_threads, itrealvalue, vsize;
+  // The fields we need always fit in the first kilobyte, so a
+  // truncated read is fine.
+  char buffer[1024];
+  ssize_t length = preadProcFile(fd, buffer, sizeof(buffer));
+
+  ::close(fd);
 
-  // These are the fields we want.
-  double rss, utime, stime, starttime;
-  pid_t _pid, ppid, pgrp, sid;
+  if (length <= 0) {
+    return false;
+  }
+
+  return parseProcStat(buffer, length, stat);
+}
 
-  // Parse all fields from stat.
-  pStatFile >> _pid >> comm >> state >> ppid >> pgrp >> sid >> tty_nr >>
-               tpgid >> flags >> minflt >> cminflt >> majflt >> cmajflt >>
-               utime >> stime >> cutime >> cstime >> priority >> nice >>
-               num_threads >> itrealvalue >> starttime >> vsize >> rss;
 
-  // Check for any read/parse errors.
-  if (!pStatFile) {
-    return Try<ProcessStats>::error("Failed to read ProcessStats from proc");
+bool readProcStat(pid_t pid, ProcStat* stat)
+{
+  char path[32];
+  snprintf(path, sizeof(path), "/proc/%d/stat", pid);
+  return readProcStat(path, stat);
+}
+
+
+ProcessStats toProcessStats(const ProcStat& stat, const seconds& bootTime)
+{
+  // TODO(adegtiar): consider doing something more sophisticated for memUsage.
+  return ProcessStats(stat.pid, stat.ppid, stat.pgrp, stat.sid,
+      ticksToSeconds(stat.utime + stat.stime),
+      seconds(bootTime.value + jiffiesToSeconds(stat.starttime).value),
+      pagesToBytes(stat.rss),
+      ticksToSeconds(stat.utime),
+      ticksToSeconds(stat.stime),
+      stat.majflt,
+      stat.numThreads,
+      ticksToSeconds(stat.cutime),
+      ticksToSeconds(stat.cstime));
+}
+
+
+Try<ProcessStats> getProcessStats(const pid_t& pid)
+{
+  ProcStat stat;
+  if (!readProcStat(pid, &stat)) {
+    return Try<ProcessStats>::error(
+        "Failed to read ProcessStats from /proc/" + utils::stringify(pid));
   }
 
   Try<seconds> bootTime = getBootTime();
@@ -114,11 +381,7 @@ Try<ProcessStats> getProcessStats(const pid_t& pid)
     return Try<ProcessStats>::error(bootTime.error());
   }
 
-  // TODO(adegtiar): consider doing something more sophisticated for memUsage.
-  return ProcessStats(_pid, ppid, pgrp, sid,
-      seconds(ticksToSeconds(utime + stime)),
-      seconds(bootTime.get().value + jiffiesToSeconds(starttime).value),
-      rss * sysconf(_SC_PAGE_SIZE));
+  return toProcessStats(stat, bootTime.get());
 }
 
 
@@ -31,6 +31,87 @@ namespace mesos {
 namespace internal {
 namespace monitoring {
 
+// The raw fields of /proc/<pid>/stat used for monitoring. Times are
+// in clock ticks (_SC_CLK_TCK), starttime is in jiffies since boot and
+// rss is in pages, exactly as reported by the kernel.
+struct ProcStat
+{
+  pid_t pid;
+  pid_t ppid;
+  pid_t pgrp;
+  pid_t sid;
+  unsigned long minflt;
+  unsigned long majflt;
+  unsigned long utime;
+  unsigned long stime;
+  long cutime;
+  long cstime;
+  long numThreads;
+  unsigned long long starttime;
+  unsigned long vsize;
+  long rss;
+};
+
+// The fields of /proc/<pid>/statm, in pages.
+struct ProcStatm
+{
+  unsigned long size;
+  unsigned long resident;
+  unsigned long shared;
+  unsigned long text;
+  unsigned long data;
+};
+
+// The fields of /proc/<pid>/io used for monitoring, in bytes.
+struct ProcIo
+{
+  unsigned long long rchar;
+  unsigned long long wchar;
+  unsigned long long readBytes;
+  unsigned long long writeBytes;
+};
+
+// The context switch counters of /proc/<pid>/status.
+struct ProcStatus
+{
+  unsigned long long voluntaryCtxtSwitches;
+  unsigned long long nonvoluntaryCtxtSwitches;
+};
+
+// Parses the contents of a /proc/<pid>/stat file. Handles a comm
+// field containing spaces and parentheses. Returns false if the
+// contents are malformed. Does not allocate.
+bool parseProcStat(const char* buffer, size_t length, ProcStat* stat);
+
+// Parses the contents of a /proc/<pid>/statm file. Does not allocate.
+bool parseProcStatm(const char* buffer, size_t length, ProcStatm* statm);
+
+// Parses the contents of a /proc/<pid>/io file. Does not allocate.
+bool parseProcIo(const char* buffer, size_t length, ProcIo* io);
+
+// Parses the contents of a /proc/<pid>/status file. Does not allocate.
+bool parseProcStatus(const char* buffer, size_t length, ProcStatus* status);
+
+// Reads the file behind 'fd' from the beginning into 'buffer' with
+// pread(), retrying on EINTR. Returns the number of bytes read, or -1.
+ssize_t preadProcFile(int fd, char* buffer, size_t size);
+
+// Reads and parses the stat file at the given path (e.g.,
+// /proc/<pid>/stat) using a fixed size buffer. Returns false if the
+// file cannot be read or parsed. Does not allocate.
+bool readProcStat(const char* path, ProcStat* stat);
+
+// Reads and parses /proc/<pid>/stat for the given process.
+bool readProcStat(pid_t pid, ProcStat* stat);
+
+// Converts the raw fields read from /proc/<pid>/stat into a
+// ProcessStats, given the (cached) system boot time.
+ProcessStats toProcessStats(const ProcStat& stat, const seconds& bootTime);
+
+// Converts time in system ticks (as defined by _SC_CLK_TCK, NOT CPU
+// clock ticks) to seconds.
+seconds ticksToSeconds(double ticks);
+
 // Reads from proc and returns a list of all processes running on the
 // system.
 Try<std::list<pid_t> > getAllPids();
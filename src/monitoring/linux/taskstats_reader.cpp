@@ -0,0 +1,259 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <linux/genetlink.h>
+#include <linux/netlink.h>
+#include <linux/taskstats.h>
+
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/types.h>
+
+#include <algorithm>
+#include <string>
+
+#include "common/try.hpp"
+
+#include "monitoring/linux/taskstats_reader.hpp"
+
+using std::string;
+
+namespace mesos {
+namespace internal {
+namespace monitoring {
+
+// Large enough for a struct taskstats of any version and its headers.
+static const size_t BUFFER_SIZE = 2048;
+
+
+// Where the attributes of a reply received by request start.
+static char* payload(char* buffer)
+{
+  return buffer + NLMSG_LENGTH(GENL_HDRLEN);
+}
+
+
+// Returns the attribute of the given type among the attributes in
+// 'data', or NULL.
+static struct nlattr* findAttribute(char* data, int length, uint16_t type)
+{
+  while (length >= (int) NLA_HDRLEN) {
+    struct nlattr* attribute = (struct nlattr*) data;
+    if (attribute->nla_len < NLA_HDRLEN || attribute->nla_len > length) {
+      return NULL;
+    }
+
+    if ((attribute->nla_type & NLA_TYPE_MASK) == type) {
+      return attribute;
+    }
+
+    int aligned = NLA_ALIGN(attribute->nla_len);
+    data += aligned;
+    length -= aligned;
+  }
+
+  return NULL;
+}
+
+
+TaskstatsReader::TaskstatsReader()
+  : fd(-1), family(0), sequence(0) {}
+
+
+TaskstatsReader::~TaskstatsReader()
+{
+  if (fd >= 0) {
+    ::close(fd);
+  }
+}
+
+
+Try<bool> TaskstatsReader::connect()
+{
+  int s = socket(AF_NETLINK, SOCK_RAW, NETLINK_GENERIC);
+  if (s < 0) {
+    return Try<bool>::error(
+        "Failed to create netlink socket: " + string(strerror(errno)));
+  }
+
+  fcntl(s, F_SETFD, FD_CLOEXEC);
+
+  // The kernel answers right away, so a reply that takes longer than
+  // this is not coming.
+  struct timeval timeout;
+  timeout.tv_sec = 1;
+  timeout.tv_usec = 0;
+  setsockopt(s, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+  struct sockaddr_nl address;
+  memset(&address, 0, sizeof(address));
+  address.nl_family = AF_NETLINK;
+
+  if (bind(s, (struct sockaddr*) &address, sizeof(address)) < 0) {
+    string error = strerror(errno);
+    ::close(s);
+    return Try<bool>::error("Failed to bind netlink socket: " + error);
+  }
+
+  fd = s;
+
+  char buffer[BUFFER_SIZE];
+  int length = request(GENL_ID_CTRL, CTRL_CMD_GETFAMILY,
+                       CTRL_ATTR_FAMILY_NAME, TASKSTATS_GENL_NAME,
+                       strlen(TASKSTATS_GENL_NAME) + 1,
+                       buffer, sizeof(buffer));
+
+  struct nlattr* id = length < 0
+    ? NULL
+    : findAttribute(payload(buffer), length, CTRL_ATTR_FAMILY_ID);
+
+  if (id == NULL) {
+    ::close(fd);
+    fd = -1;
+    return Try<bool>::error("Taskstats are not supported by the kernel");
+  }
+
+  family = *(uint16_t*) ((char*) id + NLA_HDRLEN);
+  return true;
+}
+
+
+bool TaskstatsReader::read(pid_t tgid, struct taskstats* stats)
+{
+  if (fd < 0) {
+    return false;
+  }
+
+  uint32_t id = tgid;
+
+  char buffer[BUFFER_SIZE];
+  int length = request(family, TASKSTATS_CMD_GET, TASKSTATS_CMD_ATTR_TGID,
+                       &id, sizeof(id), buffer, sizeof(buffer));
+  if (length < 0) {
+    return false;
+  }
+
+  // The stats are nested in an aggregate along with the tgid.
+  struct nlattr* aggregate =
+    findAttribute(payload(buffer), length, TASKSTATS_TYPE_AGGR_TGID);
+  if (aggregate == NULL) {
+    return false;
+  }
+
+  struct nlattr* attribute =
+    findAttribute((char*) aggregate + NLA_HDRLEN,
+                  aggregate->nla_len - NLA_HDRLEN,
+                  TASKSTATS_TYPE_STATS);
+  if (attribute == NULL) {
+    return false;
+  }
+
+  // Older kernels send a shorter struct, newer ones a longer one.
+  memset(stats, 0, sizeof(*stats));
+  memcpy(stats,
+         (char*) attribute + NLA_HDRLEN,
+         std::min((size_t) attribute->nla_len - NLA_HDRLEN, sizeof(*stats)));
+
+  return true;
+}
+
+
+int TaskstatsReader::request(
+    uint16_t type,
+    uint8_t command,
+    uint16_t attributeType,
+    const void* data,
+    size_t size,
+    char* buffer,
+    size_t capacity)
+{
+  memset(buffer, 0, capacity);
+
+  struct nlmsghdr* header = (struct nlmsghdr*) buffer;
+  header->nlmsg_len = NLMSG_LENGTH(GENL_HDRLEN + NLA_HDRLEN + size);
+  header->nlmsg_type = type;
+  header->nlmsg_flags = NLM_F_REQUEST;
+  header->nlmsg_seq = ++sequence;
+  header->nlmsg_pid = 0;
+
+  if (NLMSG_ALIGN(header->nlmsg_len) > capacity) {
+    return -1;
+  }
+
+  struct genlmsghdr* generic = (struct genlmsghdr*) NLMSG_DATA(header);
+  generic->cmd = command;
+  generic->version = TASKSTATS_GENL_VERSION;
+
+  struct nlattr* attribute =
+    (struct nlattr*) ((char*) generic + GENL_HDRLEN);
+  attribute->nla_type = attributeType;
+  attribute->nla_len = NLA_HDRLEN + size;
+  memcpy((char*) attribute + NLA_HDRLEN, data, size);
+
+  struct sockaddr_nl address;
+  memset(&address, 0, sizeof(address));
+  address.nl_family = AF_NETLINK;
+
+  ssize_t sent;
+  do {
+    sent = sendto(fd, buffer, header->nlmsg_len, 0,
+                  (struct sockaddr*) &address, sizeof(address));
+  } while (sent < 0 && errno == EINTR);
+
+  if (sent < 0) {
+    return -1;
+  }
+
+  // Skip any stale replies, e.g., to a request that timed out.
+  while (true) {
+    ssize_t length = recv(fd, buffer, capacity, 0);
+    if (length < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return -1;
+    }
+
+    if (!NLMSG_OK(header, length)) {
+      return -1;
+    }
+
+    if (header->nlmsg_seq != sequence) {
+      continue;
+    }
+
+    // An error reply carries an errno, e.g., ESRCH for a process that
+    // does not exist.
+    if (header->nlmsg_type == NLMSG_ERROR ||
+        header->nlmsg_len < NLMSG_LENGTH(GENL_HDRLEN)) {
+      return -1;
+    }
+
+    return header->nlmsg_len - NLMSG_LENGTH(GENL_HDRLEN);
+  }
+}
+
+} // namespace monitoring {
+} // namespace internal {
+} // namespace mesos {
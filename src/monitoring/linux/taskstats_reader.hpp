@@ -0,0 +1,80 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __TASKSTATS_READER_HPP__
+#define __TASKSTATS_READER_HPP__
+
+#include <stdint.h>
+
+#include <linux/taskstats.h>
+
+#include <sys/types.h>
+
+#include "common/try.hpp"
+
+namespace mesos {
+namespace internal {
+namespace monitoring {
+
+// Queries the per thread group accounting of the kernel (the same
+// interface as Documentation/accounting/getdelays.c) over a generic
+// netlink socket. A reply is a single binary struct taskstats, so this
+// needs no text parsing.
+//
+// The kernel only fills in the run time and the delays of a thread
+// group when delay accounting is enabled (see the 'delayacct' boot
+// option and /proc/sys/kernel/task_delayacct).
+//
+// Not thread safe.
+class TaskstatsReader
+{
+public:
+  // Creates a reader that can not read anything until connected.
+  TaskstatsReader();
+
+  ~TaskstatsReader();
+
+  // Opens the socket and looks up the id of the taskstats family.
+  Try<bool> connect();
+
+  // Reads the accounting of the thread group 'tgid' into 'stats'.
+  // Fields newer than the running kernel are left zero. Returns false
+  // if the process does not exist or the kernel could not be asked.
+  bool read(pid_t tgid, struct taskstats* stats);
+
+private:
+  // No copying, no assigning.
+  TaskstatsReader(const TaskstatsReader&);
+  TaskstatsReader& operator = (const TaskstatsReader&);
+
+  // Sends a generic netlink request carrying a single attribute and
+  // receives the reply into 'buffer'. Returns the length of the
+  // attributes of the reply, or -1.
+  int request(uint16_t type, uint8_t command, uint16_t attribute,
+              const void* data, size_t size, char* buffer, size_t capacity);
+
+  int fd; // The netlink socket, or -1.
+  uint16_t family;
+  uint32_t sequence;
+};
+
+} // namespace monitoring {
+} // namespace internal {
+} // namespace mesos {
+
+#endif // __TASKSTATS_READER_HPP__
@@ -0,0 +1,183 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <pthread.h>
+#include <unistd.h>
+
+#include <linux/taskstats.h>
+
+#include <sys/types.h>
+
+#include <list>
+
+#include <glog/logging.h>
+
+#include "common/foreach.hpp"
+#include "common/seconds.hpp"
+#include "common/try.hpp"
+
+#include "monitoring/linux/taskstats_reader.hpp"
+#include "monitoring/linux/taskstats_resource_collector.hpp"
+
+#include "monitoring/process_stats.hpp"
+
+using std::list;
+
+namespace mesos {
+namespace internal {
+namespace monitoring {
+
+// Code for probing the kernel once.
+static pthread_once_t isSupportInitialized = PTHREAD_ONCE_INIT;
+static bool supported = false;
+
+
+static void initSupported()
+{
+  TaskstatsReader reader;
+
+  Try<bool> connected = reader.connect();
+  if (connected.isError()) {
+    LOG(INFO) << "Not using taskstats: " << connected.error();
+    return;
+  }
+
+  struct taskstats stats;
+  if (!reader.read(getpid(), &stats)) {
+    LOG(INFO) << "Not using taskstats: failed to query the slave";
+    return;
+  }
+
+  supported = true;
+}
+
+
+bool TaskstatsResourceCollector::isSupported()
+{
+  pthread_once(&isSupportInitialized, initSupported);
+  return supported;
+}
+
+
+TaskstatsResourceCollector::TaskstatsResourceCollector(
+    pid_t _rootPid,
+    ProcSnapshotter* _snapshotter,
+    ProcConnectorTracker* _tracker)
+  : ProcResourceCollector(_rootPid, _snapshotter, _tracker)
+{
+  Try<bool> result = taskstats.connect();
+  if (result.isError()) {
+    LOG(WARNING) << "Falling back to /proc for the cpu time of process "
+                 << rootPid << ": " << result.error();
+  }
+  connected = result.isSome();
+}
+
+
+TaskstatsResourceCollector::~TaskstatsResourceCollector() {}
+
+
+Try<list<ProcessStats> > TaskstatsResourceCollector::getProcessTreeStats()
+{
+  Try<list<ProcessStats> > processes =
+    ProcResourceCollector::getProcessTreeStats();
+  if (processes.isError() || !connected) {
+    return processes;
+  }
+
+  delays.clear();
+
+  list<ProcessStats> result;
+
+  struct taskstats stats;
+  foreach (const ProcessStats& process, processes.get()) {
+    if (!taskstats.read(process.pid, &stats)) {
+      result.push_back(process); // The process exited in the meantime.
+      continue;
+    }
+
+    Delays& delay = delays[process.pid];
+    delay.cpu = stats.cpu_delay_total;
+    delay.blkio = stats.blkio_delay_total;
+    delay.swapin = stats.swapin_delay_total;
+
+    // A thread group query (unlike one for a single thread) leaves
+    // ac_utime and ac_stime at zero on most kernels, but it does add up
+    // the run time of all the threads, including the exited ones, in
+    // nanoseconds. That is split in the proportion of the user and
+    // system ticks from /proc, like the kernel derives those times
+    // itself (see cputime_adjust). Without delay accounting the run
+    // time is zero as well, leaving just the ticks.
+    if (stats.cpu_run_real_total == 0) {
+      result.push_back(process);
+      continue;
+    }
+
+    double runTime = nanoseconds(stats.cpu_run_real_total).secs();
+    double ticks = process.userTime.value + process.systemTime.value;
+
+    double user = runTime;
+    if (ticks > 0) {
+      user = runTime * process.userTime.value / ticks;
+    }
+
+    seconds userTime(user);
+    seconds systemTime(runTime - user);
+
+    result.push_back(
+        ProcessStats(process.pid, process.ppid, process.pgrp, process.sid,
+                     seconds(runTime),
+                     process.startTime, process.memUsage,
+                     userTime, systemTime, process.majorFaults,
+                     process.threads, process.childUserTime,
+                     process.childSystemTime));
+  }
+
+  return result;
+}
+
+
+void TaskstatsResourceCollector::collectProcessTreeUsage(
+    const list<ProcessStats>& processes, UsageRecord* usage)
+{
+  ProcResourceCollector::collectProcessTreeUsage(processes, usage);
+
+  // Like the cpu time, the delays are differenced per process, so
+  // that processes exiting don't make the totals drop.
+  double cpuDelay = 0, blkioDelay = 0, swapinDelay = 0;
+  foreach (const ProcessStats& process, processes) {
+    if (delays.contains(process.pid)) {
+      const Delays& delay = delays[process.pid];
+      cpuDelay += counterDelta(process, CPU_DELAY, delay.cpu);
+      blkioDelay += counterDelta(process, BLKIO_DELAY, delay.blkio);
+      swapinDelay += counterDelta(process, SWAPIN_DELAY, delay.swapin);
+    }
+  }
+
+  // The first sample is only a baseline for the delays.
+  if (!delays.empty() && !isFirstSample()) {
+    usage->fields |= USAGE_DELAYS;
+    usage->cpuDelay = cpuDelay / 1000000000.0;
+    usage->blkioDelay = blkioDelay / 1000000000.0;
+    usage->swapinDelay = swapinDelay / 1000000000.0;
+  }
+}
+
+} // namespace monitoring {
+} // namespace internal {
+} // namespace mesos {
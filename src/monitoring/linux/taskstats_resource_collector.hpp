@@ -0,0 +1,96 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __TASKSTATS_RESOURCE_COLLECTOR_HPP__
+#define __TASKSTATS_RESOURCE_COLLECTOR_HPP__
+
+#include <list>
+
+#include <sys/types.h>
+
+#include "common/hashmap.hpp"
+#include "common/try.hpp"
+
+#include "monitoring/linux/proc_connector_tracker.hpp"
+#include "monitoring/linux/proc_resource_collector.hpp"
+#include "monitoring/linux/proc_snapshot.hpp"
+#include "monitoring/linux/taskstats_reader.hpp"
+
+#include "monitoring/process_stats.hpp"
+
+namespace mesos {
+namespace internal {
+namespace monitoring {
+
+// A ProcResourceCollector that also queries the taskstats of every
+// process in the tree (see TaskstatsReader). The cpu time of a process
+// is taken from the run time in its taskstats, which counts in
+// nanoseconds rather than in clock ticks, and the time the tree spent waiting for a cpu, for
+// block io and for swapping in pages is reported as USAGE_DELAYS. The
+// tree itself, memory and everything else still come from /proc, as
+// does the cpu time of any process whose taskstats can not be read.
+class TaskstatsResourceCollector : public ProcResourceCollector
+{
+public:
+  // Returns whether the kernel answers taskstats queries.
+  static bool isSupported();
+
+  TaskstatsResourceCollector(pid_t rootPid,
+                             ProcSnapshotter* snapshotter =
+                               ProcSnapshotter::instance(),
+                             ProcConnectorTracker* tracker =
+                               ProcConnectorTracker::instance());
+
+  virtual ~TaskstatsResourceCollector();
+
+protected:
+  virtual Try<std::list<ProcessStats> > getProcessTreeStats();
+
+  virtual void collectProcessTreeUsage(
+      const std::list<ProcessStats>& processes, UsageRecord* usage);
+
+private:
+  // The extra counters kept per process (see counterDelta).
+  enum {
+    CPU_DELAY = ProcResourceCollector::COUNTERS,
+    BLKIO_DELAY,
+    SWAPIN_DELAY
+  };
+
+  // Delays of a process in nanoseconds.
+  struct Delays
+  {
+    double cpu;
+    double blkio;
+    double swapin;
+  };
+
+  TaskstatsReader taskstats;
+
+  bool connected;
+
+  // The delays of the processes whose taskstats could be read at the
+  // latest sample.
+  hashmap<pid_t, Delays> delays;
+};
+
+} // namespace monitoring {
+} // namespace internal {
+} // namespace mesos {
+
+#endif // __TASKSTATS_RESOURCE_COLLECTOR_HPP__
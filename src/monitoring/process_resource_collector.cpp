@@ -16,10 +16,14 @@
  * limitations under the license.
  */
 
+#include <algorithm>
 #include <list>
+#include <string>
 
 #include <sys/types.h>
 
+#include <glog/logging.h>
+
 #include <process/process.hpp>
 
 #include "common/foreach.hpp"
@@ -28,114 +32,207 @@
 
 #ifdef __linux__
 #include "monitoring/linux/proc_resource_collector.hpp"
+#include "monitoring/linux/taskstats_resource_collector.hpp"
 #endif
 
 #include "monitoring/process_resource_collector.hpp"
 
 using process::Clock;
 using std::list;
+using std::string;
 
 namespace mesos {
 namespace internal {
 namespace monitoring {
 
+// Start times are derived from the boot time, which /proc/stat only
+// has in whole seconds, so a process that started just after a sample
+// may appear to have started up to a second before it.
+const double START_TIME_SLACK = 1.0;
+
+
 ProcessResourceCollector* ProcessResourceCollector::create(pid_t rootPid)
 {
 #ifdef __linux__
+  // Prefer the finer grained taskstats, falling back to just /proc.
+  if (TaskstatsResourceCollector::isSupported()) {
+    return new TaskstatsResourceCollector(rootPid);
+  }
   return new ProcResourceCollector(rootPid);
 #else
   return NULL;
 #endif
 }
 
-inline Try<seconds> initialTryValue()
-{
-  return Try<seconds>::error("initial value");
-}
-
 ProcessResourceCollector::ProcessResourceCollector(pid_t _rootPid) :
   rootPid(_rootPid),
   isInitialized(false),
-  currentMemUsage(Try<double>::error("initial value")),
-  currentCpuUsage(initialTryValue()),
-  currentTimestamp(initialTryValue()),
-  prevCpuUsage(initialTryValue()),
-  prevTimestamp(initialTryValue()) {}
-
-Try<double> ProcessResourceCollector::getMemoryUsage()
+  sampled(false),
+  prevTimestamp(0) {}
+
+// Cpu time and faults are only ever accounted per process, as the
+// difference between two samples of the same (pid, start time), so a
+// process that exits in between samples makes the total drop by
+// nothing rather than by all of its accumulated time. The time such a
+// process used after the previous sample shows up in the cutime and
+// cstime of the process that reaps it, from which the time that had
+// already been accounted to the exited process (and its descendants)
+// is subtracted.
+bool ProcessResourceCollector::collect(UsageRecord* usage, string* error)
 {
-  return currentMemUsage;
-}
+  if (!isInitialized) {
+    // The first sample reports the usage since the process started.
+    Try<seconds> startTime = getStartTime();
+    if (startTime.isError()) {
+      *error = startTime.error();
+      return false;
+    }
+    prevTimestamp = startTime.get().value;
+    isInitialized = true;
+  }
 
-Try<Rate> ProcessResourceCollector::getCpuUsage()
-{
-  if (currentCpuUsage.isSome() && currentTimestamp.isSome() &&
-      prevCpuUsage.isSome() && prevTimestamp.isSome()) {
-    return Rate(currentTimestamp.get().value - prevTimestamp.get().value,
-        currentCpuUsage.get().value - prevCpuUsage.get().value);
-  } else if (prevTimestamp.isError()) {
-    // This only happens when process start time lookup fails. Might as
-    // well report this first.
-    return Try<Rate>::error(prevTimestamp.error());
-  } else {
-    return Try<Rate>::error(currentCpuUsage.error());
+  // Read the process stats.
+  Try<list<ProcessStats> > processTree = getProcessTreeStats();
+  if (processTree.isError()) {
+    *error = processTree.error();
+    return false;
   }
-}
 
-// TODO(adegtiar): store all previous process stats and calculate the
-// per-process difference to avoid negative spikes in cpu usage when a
-// process dies.
-void ProcessResourceCollector::collectUsage()
-{
-  updatePreviousUsage();
+  usage->rss = 0;
+  usage->threads = 0;
+
+  current.reset(processTree.get().size());
+  foreach (const ProcessStats& process, processTree.get()) {
+    ProcessEntry* entry = current.insert(process.pid, process.startTime.value);
+    entry->ppid = process.ppid;
+    entry->userTime = process.userTime.value;
+    entry->systemTime = process.systemTime.value;
+    entry->childUserTime = process.childUserTime.value;
+    entry->childSystemTime = process.childSystemTime.value;
+    entry->majorFaults = process.majorFaults;
+
+    ProcessEntry* last = previous.find(process.pid, process.startTime.value);
+    if (last != NULL) {
+      last->seen = true;
+    }
+
+    usage->rss += process.memUsage;
+    usage->threads += process.threads;
+  }
 
-  // Read the process stats.
-  Try<list<ProcessStats> > tryProcessTree = getProcessTreeStats();
-  if (tryProcessTree.isError()) {
-    currentMemUsage = Try<double>::error(tryProcessTree.error());
-    currentCpuUsage = Try<seconds>::error(tryProcessTree.error());
-    currentTimestamp = Try<seconds>::error(tryProcessTree.error());
-    return;
+  // Charge the time accounted to each process that has exited to its
+  // closest ancestor that is still running, which is the one that will
+  // have reaped it (unless it got reparented out of the tree).
+  foreach (ProcessEntry& exited, previous.slots()) {
+    if (!exited.occupied || exited.seen) {
+      continue;
+    }
+
+    ProcessEntry* ancestor = previous.find(exited.ppid);
+    for (size_t depth = 0;
+         ancestor != NULL && !ancestor->seen && depth < previous.size();
+         depth++) {
+      ancestor = previous.find(ancestor->ppid);
+    }
+
+    if (ancestor != NULL && ancestor->seen) {
+      ProcessEntry* reaper = current.find(ancestor->pid, ancestor->startTime);
+      reaper->reapedUserTime += exited.userTime + exited.childUserTime;
+      reaper->reapedSystemTime += exited.systemTime + exited.childSystemTime;
+    }
+  }
+
+  double userTime = 0, systemTime = 0, majorFaults = 0;
+
+  foreach (const ProcessEntry& entry, current.slots()) {
+    if (!entry.occupied) {
+      continue;
+    }
+
+    const ProcessEntry* last = previous.find(entry.pid, entry.startTime);
+    if (last != NULL) {
+      userTime += std::max(0.0, entry.userTime - last->userTime);
+      systemTime += std::max(0.0, entry.systemTime - last->systemTime);
+      majorFaults += std::max(0.0, entry.majorFaults - last->majorFaults);
+
+      userTime += std::max(0.0,
+          entry.childUserTime - last->childUserTime - entry.reapedUserTime);
+      systemTime += std::max(0.0,
+          entry.childSystemTime - last->childSystemTime -
+          entry.reapedSystemTime);
+    } else if (startedSincePrevious(entry.startTime)) {
+      // Everything a process that started since the previous sample
+      // (including its reaped children) did falls into this sample.
+      userTime += entry.userTime + entry.childUserTime;
+      systemTime += entry.systemTime + entry.childSystemTime;
+      majorFaults += entry.majorFaults;
+    } // else the process joined the tree late, e.g., by changing its
+      // session, so this sample only serves as its baseline.
   }
-  list<ProcessStats> processTree = tryProcessTree.get();
 
-  // Success, so roll over previous usage.
-  prevTimestamp = currentTimestamp;
-  prevCpuUsage = currentCpuUsage;
+  double now = Clock::now();
+
+  usage->fields = USAGE_CPU | USAGE_RSS | USAGE_MAJOR_FAULTS | USAGE_THREADS;
+  usage->timestamp = now;
+  usage->duration = now - prevTimestamp;
+  usage->cpuUser = userTime;
+  usage->cpuSystem = systemTime;
+  usage->majorFaults = majorFaults;
 
-  // Sum up the current resource usage stats.
-  double cpuUsageTicks, memUsage;
-  aggregateResourceUsage(processTree, memUsage, cpuUsageTicks);
+  // Before swapping, for counterDelta.
+  collectProcessTreeUsage(processTree.get(), usage);
 
-  // Update current usage.
-  currentMemUsage = memUsage;
-  currentCpuUsage = seconds(cpuUsageTicks);
-  currentTimestamp = seconds(Clock::now());
+  previous.swap(current);
+
+  prevTimestamp = now;
+  sampled = true;
+
+  return true;
 }
 
-void ProcessResourceCollector::updatePreviousUsage()
+
+double ProcessResourceCollector::counterDelta(
+    const ProcessStats& process, int counter, double value)
 {
-  if (!isInitialized) {
-    prevCpuUsage = seconds(0);
-    prevTimestamp = getStartTime();
-    isInitialized = true;
-  } else if (currentMemUsage.isSome() && currentCpuUsage.isSome()) {
-    // Roll over prev usage from current usage.
-    prevCpuUsage = currentCpuUsage;
-    prevTimestamp = currentTimestamp;
-  } // else keep previous usage.
+  ProcessEntry* entry = current.find(process.pid, process.startTime.value);
+  CHECK(entry != NULL);
+  CHECK(counter >= 0 && counter < EXTRA_PROCESS_COUNTERS);
+
+  entry->counters[counter] = value;
+  entry->known[counter] = true;
+
+  const ProcessEntry* last =
+    previous.find(process.pid, process.startTime.value);
+  if (last != NULL) {
+    if (last->known[counter]) {
+      return std::max(0.0, value - last->counters[counter]);
+    }
+  } else if (startedSincePrevious(entry->startTime)) {
+    return value; // Started since the previous sample.
+  }
+
+  return 0; // Joined the tree late, this sample is its baseline.
+}
+
+
+bool ProcessResourceCollector::startedSincePrevious(double startTime) const
+{
+  return startTime >= prevTimestamp - START_TIME_SLACK;
 }
 
-void ProcessResourceCollector::aggregateResourceUsage(
-    const list<ProcessStats>& processes,
-    double& memTotal,
-    double& cpuTotal)
+
+void ProcessResourceCollector::keepCounter(
+    const ProcessStats& process, int counter)
 {
-  memTotal = 0;
-  cpuTotal = 0;
-  foreach (const ProcessStats& pinfo, processes) {
-    memTotal += pinfo.memUsage;
-    cpuTotal += pinfo.cpuTime.value;
+  ProcessEntry* entry = current.find(process.pid, process.startTime.value);
+  CHECK(entry != NULL);
+  CHECK(counter >= 0 && counter < EXTRA_PROCESS_COUNTERS);
+
+  const ProcessEntry* last =
+    previous.find(process.pid, process.startTime.value);
+  if (last != NULL) {
+    entry->counters[counter] = last->counters[counter];
+    entry->known[counter] = last->known[counter];
   }
 }
 
@@ -20,6 +20,7 @@
 #define __PROCESS_RESOURCE_COLLECTOR_HPP__
 
 #include <list>
+#include <string>
 
 #include <sys/types.h>
 
@@ -27,6 +28,7 @@
 #include "common/try.hpp"
 
 #include "monitoring/process_stats.hpp"
+#include "monitoring/process_table.hpp"
 #include "monitoring/resource_collector.hpp"
 
 namespace mesos {
@@ -47,11 +49,7 @@ public:
 
   virtual ~ProcessResourceCollector() {}
 
-  virtual void collectUsage();
-
-  virtual Try<double> getMemoryUsage();
-
-  virtual Try<Rate> getCpuUsage();
+  virtual bool collect(UsageRecord* usage, std::string* error);
 
 protected:
   const pid_t rootPid;
@@ -63,27 +61,42 @@ protected:
  // Retrieve the start time of the monitored process.
  virtual Try<seconds> getStartTime() = 0;
 
-private:
-  Try<double> currentMemUsage;
+ // Called by collect with the process tree it just read, after filling
+ // in everything ProcessStats provides. Override this to add the
+ // measurements that need more than ProcessStats.
+ virtual void collectProcessTreeUsage(
+     const std::list<ProcessStats>& processes, UsageRecord* usage) {}
 
-  Try<seconds> prevCpuUsage;
+ // Records the value of one of the extra counters of a process in the
+ // tree (an index below EXTRA_PROCESS_COUNTERS) and returns how much
+ // it grew since the previous sample of that same process, so that
+ // processes exiting or joining the tree don't skew the difference.
+ // Only to be called from collectProcessTreeUsage.
+ double counterDelta(const ProcessStats& process, int counter, double value);
 
-  Try<seconds> currentCpuUsage;
+ // Carries the previous value of a counter over for a process whose
+ // counter could not be read this time, so that the next sample is
+ // differenced against it instead of starting from scratch.
+ void keepCounter(const ProcessStats& process, int counter);
 
-  Try<seconds> prevTimestamp;
+ // Whether this is the first sample, which extra counters have no
+ // previous sample to be differenced against.
+ bool isFirstSample() const { return !sampled; }
 
-  Try<seconds> currentTimestamp;
+private:
+  // Whether a process that was not in the previous sample started
+  // since then (rather than joining the tree late).
+  bool startedSincePrevious(double startTime) const;
 
   bool isInitialized;
+  bool sampled; // Whether a sample has been collected.
 
-  // Updates or initializes the previous resource usage state.
-  void updatePreviousUsage();
+  double prevTimestamp;
 
-  // Aggregates the info all of the given ProcessStats and stores the result in
-  // memTotal and cpuTotal.
-  void aggregateResourceUsage(const std::list<ProcessStats>& processes,
-      double& memTotal,
-      double& cpuTotal);
+  // The processes of the tree at the previous sample, and a scratch
+  // table the current sample is indexed into before the two swap.
+  ProcessTable previous;
+  ProcessTable current;
 };
 
 } // namespace monitoring {
@@ -21,6 +21,8 @@
 
 #include <sys/types.h>
 
+#include "common/seconds.hpp"
+
 namespace mesos {
 namespace internal {
 namespace monitoring {
@@ -29,17 +31,29 @@ namespace monitoring {
 struct ProcessStats
 {
   ProcessStats(pid_t _pid, pid_t _ppid, pid_t _pgrp, pid_t _sid,
-      seconds _cpuTime, seconds _startTime, double _memUsage) :
+      seconds _cpuTime, seconds _startTime, double _memUsage,
+      seconds _userTime = seconds(0), seconds _systemTime = seconds(0),
+      double _majorFaults = 0, double _threads = 0,
+      seconds _childUserTime = seconds(0),
+      seconds _childSystemTime = seconds(0)) :
     pid(_pid), ppid(_ppid), pgrp(_pgrp), sid(_sid), cpuTime(_cpuTime),
-    startTime(_startTime), memUsage(_memUsage) {}
+    startTime(_startTime), memUsage(_memUsage), userTime(_userTime),
+    systemTime(_systemTime), majorFaults(_majorFaults), threads(_threads),
+    childUserTime(_childUserTime), childSystemTime(_childSystemTime) {}
 
   const pid_t pid;
   const pid_t ppid;
   const pid_t pgrp;
   const pid_t sid;
-  const seconds cpuTime;   // Total cpu time used.
-  const seconds startTime; // Timestamp as time elapsed since epoch.
-  const double memUsage;   // Current RSS usage in bytes.
+  const seconds cpuTime;    // Total cpu time used.
+  const seconds startTime;  // Timestamp as time elapsed since epoch.
+  const double memUsage;    // Current RSS usage in bytes.
+  const seconds userTime;   // Cpu time used in user mode.
+  const seconds systemTime; // Cpu time used in kernel mode.
+  const double majorFaults; // Total page faults that required disk io.
+  const double threads;     // Current number of threads.
+  const seconds childUserTime;   // User time of the reaped children.
+  const seconds childSystemTime; // System time of the reaped children.
 };
 
 } // namespace monitoring {
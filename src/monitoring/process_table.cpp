@@ -0,0 +1,166 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include <sys/types.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "common/foreach.hpp"
+
+#include "monitoring/process_table.hpp"
+
+using std::vector;
+
+namespace mesos {
+namespace internal {
+namespace monitoring {
+
+// The table is kept at most half full.
+static size_t capacityFor(size_t expected)
+{
+  size_t capacity = 16;
+  while (capacity < 2 * expected) {
+    capacity *= 2;
+  }
+  return capacity;
+}
+
+
+static ProcessEntry emptyEntry()
+{
+  ProcessEntry entry;
+  memset(&entry, 0, sizeof(entry));
+  return entry;
+}
+
+
+ProcessTable::ProcessTable()
+  : entries(capacityFor(0), emptyEntry()), count(0) {}
+
+
+void ProcessTable::reset(size_t expected)
+{
+  size_t capacity = capacityFor(expected);
+
+  // Reuse the slots unless they are far too few or too many.
+  if (entries.size() < capacity || entries.size() > 4 * capacity) {
+    entries.assign(capacity, emptyEntry());
+  } else {
+    foreach (ProcessEntry& entry, entries) {
+      entry.occupied = false;
+    }
+  }
+
+  count = 0;
+}
+
+
+ProcessEntry* ProcessTable::insert(pid_t pid, double startTime)
+{
+  ProcessEntry* entry = find(pid, startTime);
+  if (entry != NULL) {
+    return entry;
+  }
+
+  if (2 * (count + 1) > entries.size()) {
+    // Rehash into a table twice the size.
+    vector<ProcessEntry> old(2 * entries.size(), emptyEntry());
+    old.swap(entries);
+    count = 0;
+    foreach (const ProcessEntry& entry, old) {
+      if (entry.occupied) {
+        *insert(entry.pid, entry.startTime) = entry;
+      }
+    }
+  }
+
+  size_t index = probe(pid);
+  while (entries[index].occupied) {
+    index = (index + 1) & (entries.size() - 1);
+  }
+
+  entry = &entries[index];
+  *entry = emptyEntry();
+  entry->pid = pid;
+  entry->startTime = startTime;
+  entry->occupied = true;
+  count++;
+
+  return entry;
+}
+
+
+ProcessEntry* ProcessTable::find(pid_t pid, double startTime)
+{
+  size_t index = probe(pid);
+  while (entries[index].occupied) {
+    if (entries[index].pid == pid && entries[index].startTime == startTime) {
+      return &entries[index];
+    }
+    index = (index + 1) & (entries.size() - 1);
+  }
+  return NULL;
+}
+
+
+ProcessEntry* ProcessTable::find(pid_t pid)
+{
+  size_t index = probe(pid);
+  while (entries[index].occupied) {
+    if (entries[index].pid == pid) {
+      return &entries[index];
+    }
+    index = (index + 1) & (entries.size() - 1);
+  }
+  return NULL;
+}
+
+
+size_t ProcessTable::size() const
+{
+  return count;
+}
+
+
+vector<ProcessEntry>& ProcessTable::slots()
+{
+  return entries;
+}
+
+
+void ProcessTable::swap(ProcessTable& that)
+{
+  entries.swap(that.entries);
+  std::swap(count, that.count);
+}
+
+
+size_t ProcessTable::probe(pid_t pid) const
+{
+  // Multiplying by an odd constant permutes the low bits, so
+  // consecutive pids still land in distinct slots.
+  return (static_cast<uint32_t>(pid) * 2654435761u) & (entries.size() - 1);
+}
+
+} // namespace monitoring {
+} // namespace internal {
+} // namespace mesos {
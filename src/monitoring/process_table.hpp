@@ -0,0 +1,106 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __PROCESS_TABLE_HPP__
+#define __PROCESS_TABLE_HPP__
+
+#include <sys/types.h>
+
+#include <vector>
+
+namespace mesos {
+namespace internal {
+namespace monitoring {
+
+// Number of counters a collector can keep per process on top of the
+// ones every collector has (see ProcessResourceCollector::counterDelta).
+const int EXTRA_PROCESS_COUNTERS = 6;
+
+
+// The counters of a process as of one sample, keyed by the pid and
+// start time of the process so that a reused pid is never mistaken for
+// the process that used it before.
+struct ProcessEntry
+{
+  pid_t pid;
+  double startTime;
+  pid_t ppid;
+  double userTime;
+  double systemTime;
+  double childUserTime;   // Of reaped children, like cutime.
+  double childSystemTime; // Of reaped children, like cstime.
+  double majorFaults;
+
+  // Time already accounted to children that exited since the previous
+  // sample and are assumed reaped by this process (see
+  // ProcessResourceCollector::collect).
+  double reapedUserTime;
+  double reapedSystemTime;
+
+  double counters[EXTRA_PROCESS_COUNTERS];
+  bool known[EXTRA_PROCESS_COUNTERS]; // Whether the counter was read.
+
+  bool occupied; // Whether the slot holds an entry.
+  bool seen;     // Whether the process is still in the next sample.
+};
+
+
+// An open addressed hash table (with linear probing) of ProcessEntries.
+// A collector keeps two of these, one per sample, and rebuilds one from
+// scratch for every sample, so entries are never removed; this keeps
+// the table a single flat array without tombstones.
+class ProcessTable
+{
+public:
+  ProcessTable();
+
+  // Removes all entries and makes room for 'expected' of them.
+  void reset(size_t expected);
+
+  // Returns the entry for the given process, adding an empty one if
+  // there is none.
+  ProcessEntry* insert(pid_t pid, double startTime);
+
+  // Returns the entry for the given process, or NULL.
+  ProcessEntry* find(pid_t pid, double startTime);
+
+  // Returns the entry with the given pid regardless of its start time,
+  // or NULL. A table only ever holds one sample, so a pid can not show
+  // up more than once.
+  ProcessEntry* find(pid_t pid);
+
+  // Returns the number of entries.
+  size_t size() const;
+
+  // The slots of the table, for iterating over the occupied ones.
+  std::vector<ProcessEntry>& slots();
+
+  void swap(ProcessTable& that);
+
+private:
+  size_t probe(pid_t pid) const;
+
+  std::vector<ProcessEntry> entries;
+  size_t count;
+};
+
+} // namespace monitoring {
+} // namespace internal {
+} // namespace mesos {
+
+#endif // __PROCESS_TABLE_HPP__
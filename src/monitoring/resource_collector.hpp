@@ -19,49 +19,87 @@
 #ifndef __RESOURCE_COLLECTOR_HPP__
 #define __RESOURCE_COLLECTOR_HPP__
 
-#include "common/try.hpp"
+#include <string>
 
 namespace mesos {
 namespace internal {
 namespace monitoring {
 
-//TODO(sam): maybe template these for different duration, difference types
-struct Rate {
-  Rate(const double _duration, const double _difference)
-    : duration(_duration), difference(_difference) {}
+// Bits of UsageRecord::fields, telling which of the measurements a
+// collector was able to fill in.
+enum UsageField
+{
+  USAGE_CPU              = 1 << 0, // cpuUser and cpuSystem.
+  USAGE_RSS              = 1 << 1,
+  USAGE_PAGE_CACHE       = 1 << 2,
+  USAGE_MAJOR_FAULTS     = 1 << 3,
+  USAGE_IO               = 1 << 4, // ioReadBytes and ioWriteBytes.
+  USAGE_CONTEXT_SWITCHES = 1 << 5,
+  USAGE_THREADS          = 1 << 6,
+  USAGE_DELAYS           = 1 << 7, // cpuDelay, blkioDelay and swapinDelay.
+  USAGE_CPU_TOTAL        = 1 << 8,
+  USAGE_MEM_TOTAL        = 1 << 9
+};
+
+
+// A single sample of everything a ResourceCollector measures. The
+// layout is fixed so that a record can be preallocated and filled in
+// by one call, without allocating per measurement. Cumulative
+// quantities (cpu time, faults, io, context switches) are reported as
+// the difference over the 'duration' seconds ending at 'timestamp',
+// everything else is the value at 'timestamp'.
+struct UsageRecord
+{
+  UsageRecord()
+    : fields(0), timestamp(0), duration(0), cpuUser(0), cpuSystem(0),
+      rss(0), pageCache(0), majorFaults(0), ioReadBytes(0),
+      ioWriteBytes(0), contextSwitches(0), threads(0), cpuDelay(0),
+      blkioDelay(0), swapinDelay(0), cpuTotal(0), memTotal(0) {}
 
-  double duration;
-  double difference;
+  unsigned int fields;    // A mask of UsageFields.
+  double timestamp;       // Time (since the epoch) of the sample.
+  double duration;        // Seconds since the previous sample.
+  double cpuUser;         // Cpu seconds spent in user mode.
+  double cpuSystem;       // Cpu seconds spent in kernel mode.
+  double rss;             // Resident memory in bytes.
+  double pageCache;       // Page cache charged to the system, in bytes.
+  double majorFaults;     // Page faults that required disk io.
+  double ioReadBytes;     // Bytes read from storage.
+  double ioWriteBytes;    // Bytes written to storage.
+  double contextSwitches; // Voluntary and involuntary.
+  double threads;
+  double cpuDelay;        // Seconds spent runnable, waiting for a cpu.
+  double blkioDelay;      // Seconds spent waiting for block io.
+  double swapinDelay;     // Seconds spent waiting for pages to swap in.
+
+  // Totals measured on their own (e.g., by a container), which take
+  // precedence over cpuUser + cpuSystem and rss + pageCache.
+  double cpuTotal;        // Cpu seconds.
+  double memTotal;        // Bytes charged, including swap.
 };
 
+
 /*
  * An interface for a module that collects usage/utilization information
  * from the operating system. The purpose of this module is to provide an 
  * interface for ResourceMonitor to have as a member variable.
  *
- * Each get method in ResourceCollector will return the appropriate value from the underlying 
- * system. The values are returned are described for each method.
- *
- * For methods that return a rate, the class that implements this interface 
- * will need to keep around the state from the previous call to get that usage 
- * statistic, including the ability to deal with special cases for inital calls.
+ * A collector measures the monitored system in one batch per call to
+ * collect. For measurements that are reported as a difference over
+ * time, the class that implements this interface will need to keep
+ * around the state from the previous call, including the ability to
+ * deal with special cases for inital calls.
  */
 class ResourceCollector
 {
 public:
   virtual ~ResourceCollector() {}
 
-  // Called before usage is retrieved from the ResourceCollector.
-  // Override this to collect usage in one batch.
-  virtual void collectUsage() {}
-
-  // Returns the number of bytes currently used by the monitored system.
-  virtual Try<double> getMemoryUsage() = 0;
-
-  // Returns the milliseconds of CPU time the monitored system has received
-  // since it started.
-  virtual Try<Rate> getCpuUsage() = 0;
-  
+  // Samples the monitored system into 'usage', setting the bits of
+  // 'usage->fields' for the measurements that were taken. Returns
+  // false and describes the problem in 'error' if the system could
+  // not be measured at all.
+  virtual bool collect(UsageRecord* usage, std::string* error) = 0;
 };
 
 } // namespace monitoring {
@@ -0,0 +1,270 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <math.h>
+#include <stdint.h>
+
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+#include "monitoring/usage_history.hpp"
+
+namespace mesos {
+namespace internal {
+namespace monitoring {
+
+// The histogram has a bucket for values below 2^MIN_EXPONENT (and
+// zero), followed by BUCKETS_PER_OCTAVE buckets for each power of two
+// up to 2^MAX_EXPONENT, which covers a thousandth of a cpu as well as
+// terabytes of memory. Larger values go in the last bucket.
+static const int MIN_EXPONENT = -20;
+static const int MAX_EXPONENT = 44;
+static const int BUCKETS_PER_OCTAVE = 16;
+static const size_t BUCKETS =
+  1 + (MAX_EXPONENT - MIN_EXPONENT) * BUCKETS_PER_OCTAVE;
+
+
+static size_t bucket(double value)
+{
+  if (!(value >= ldexp(1.0, MIN_EXPONENT))) {
+    return 0;
+  }
+
+  // The mantissa is in [0.5, 1).
+  int exponent;
+  double mantissa = frexp(value, &exponent);
+
+  size_t index = 1 +
+    (exponent - MIN_EXPONENT - 1) * BUCKETS_PER_OCTAVE +
+    (size_t) ((mantissa - 0.5) * 2 * BUCKETS_PER_OCTAVE);
+
+  return std::min(index, BUCKETS - 1);
+}
+
+
+// Returns the middle of the values in a bucket.
+static double representative(size_t index)
+{
+  if (index == 0) {
+    return 0;
+  }
+
+  int exponent = (index - 1) / BUCKETS_PER_OCTAVE + MIN_EXPONENT + 1;
+  int offset = (index - 1) % BUCKETS_PER_OCTAVE;
+
+  return ldexp(0.5 + (offset + 0.5) / (2 * BUCKETS_PER_OCTAVE), exponent);
+}
+
+
+double UsageHistory::length(Window window)
+{
+  switch (window) {
+    case WINDOW_10_SECONDS: return 10;
+    case WINDOW_1_MINUTE: return 60;
+    case WINDOW_5_MINUTES: return 300;
+    default: LOG(FATAL) << "Unknown window " << window;
+  }
+  return 0;
+}
+
+
+size_t UsageHistory::capacityFor(double interval)
+{
+  CHECK(interval > 0);
+
+  // The samples within the longest window, and the one that is just
+  // about to leave it.
+  double capacity = ceil(length((Window) (WINDOWS - 1)) / interval) + 1;
+
+  return (size_t) std::min(
+      capacity, (double) std::numeric_limits<uint16_t>::max());
+}
+
+
+UsageHistory::UsageHistory(size_t capacity)
+  : samples(capacity), head(0), tail(0)
+{
+  // Histogram buckets count up to the capacity.
+  CHECK(capacity > 0 && capacity <= std::numeric_limits<uint16_t>::max());
+
+  Aggregator empty;
+  empty.tail = 0;
+  empty.sum = 0;
+  empty.weight = 0;
+  empty.maxima.resize(capacity);
+  empty.maximaHead = 0;
+  empty.maximaTail = 0;
+  empty.histogram.resize(BUCKETS);
+
+  aggregators.resize(MEASUREMENTS * WINDOWS, empty);
+}
+
+
+void UsageHistory::add(const UsageSample& sample)
+{
+  CHECK(sample.duration > 0);
+
+  const uint64_t capacity = samples.size();
+
+  // Make room by dropping the oldest sample from the windows that
+  // still contain it.
+  if (head - tail == capacity) {
+    for (int m = 0; m < MEASUREMENTS; m++) {
+      for (int w = 0; w < WINDOWS; w++) {
+        Aggregator* a = &aggregator((Measurement) m, (Window) w);
+        if (a->tail == tail) {
+          evict(a, (Measurement) m);
+        }
+      }
+    }
+    tail++;
+  }
+
+  samples[head % capacity] = sample;
+  uint64_t sequence = head++;
+
+  for (int m = 0; m < MEASUREMENTS; m++) {
+    double v = value(sequence, (Measurement) m);
+
+    for (int w = 0; w < WINDOWS; w++) {
+      Aggregator* a = &aggregator((Measurement) m, (Window) w);
+
+      a->sum += v * sample.duration;
+      a->weight += sample.duration;
+      a->histogram[bucket(v)]++;
+
+      // Samples that are not larger than the new one can no longer be
+      // the maximum, since they leave the window first.
+      while (a->maximaTail > a->maximaHead &&
+             value(a->maxima[(a->maximaTail - 1) % capacity],
+                   (Measurement) m) <= v) {
+        a->maximaTail--;
+      }
+      a->maxima[a->maximaTail++ % capacity] = sequence;
+
+      // Drop the samples that are now outside of the window.
+      double start = sample.timestamp - length((Window) w);
+      while (a->tail < head &&
+             samples[a->tail % capacity].timestamp <= start) {
+        evict(a, (Measurement) m);
+      }
+    }
+  }
+}
+
+
+UsageAggregate UsageHistory::aggregate(
+    Measurement measurement,
+    Window window) const
+{
+  const Aggregator& a = aggregator(measurement, window);
+
+  UsageAggregate result;
+  result.samples = head - a.tail;
+
+  if (result.samples == 0) {
+    return result;
+  }
+
+  result.mean = a.sum / a.weight;
+  result.max = value(a.maxima[a.maximaHead % samples.size()], measurement);
+
+  // The nearest rank, i.e., the smallest value that is at least as
+  // large as 95% of the samples.
+  size_t rank = (size_t) ceil(0.95 * result.samples);
+  size_t count = 0;
+  for (size_t index = 0; index < BUCKETS; index++) {
+    count += a.histogram[index];
+    if (count >= rank) {
+      // The bucket may reach past the maximum.
+      result.p95 = std::min(representative(index), result.max);
+      break;
+    }
+  }
+
+  return result;
+}
+
+
+size_t UsageHistory::size() const
+{
+  return head - tail;
+}
+
+
+const UsageSample& UsageHistory::latest() const
+{
+  CHECK(head > tail);
+  return samples[(head - 1) % samples.size()];
+}
+
+
+double UsageHistory::value(uint64_t sequence, Measurement measurement) const
+{
+  const UsageSample& sample = samples[sequence % samples.size()];
+  return measurement == CPUS ? sample.cpus : sample.mem;
+}
+
+
+void UsageHistory::evict(Aggregator* a, Measurement measurement)
+{
+  double v = value(a->tail, measurement);
+  double duration = samples[a->tail % samples.size()].duration;
+
+  a->histogram[bucket(v)]--;
+
+  if (a->maximaTail > a->maximaHead &&
+      a->maxima[a->maximaHead % samples.size()] == a->tail) {
+    a->maximaHead++;
+  }
+
+  a->tail++;
+
+  // Reset the sums once the window is empty so that rounding errors do
+  // not pile up.
+  if (a->tail == head) {
+    a->sum = 0;
+    a->weight = 0;
+  } else {
+    a->sum -= v * duration;
+    a->weight -= duration;
+  }
+}
+
+
+UsageHistory::Aggregator& UsageHistory::aggregator(
+    Measurement measurement,
+    Window window)
+{
+  return aggregators[measurement * WINDOWS + window];
+}
+
+
+const UsageHistory::Aggregator& UsageHistory::aggregator(
+    Measurement measurement,
+    Window window) const
+{
+  return aggregators[measurement * WINDOWS + window];
+}
+
+} // namespace monitoring {
+} // namespace internal {
+} // namespace mesos {
@@ -0,0 +1,144 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __USAGE_HISTORY_HPP__
+#define __USAGE_HISTORY_HPP__
+
+#include <stdint.h>
+
+#include <vector>
+
+namespace mesos {
+namespace internal {
+namespace monitoring {
+
+// The usage of an executor as of one sample.
+struct UsageSample
+{
+  double timestamp; // Seconds since the epoch.
+  double duration;  // Seconds since the previous sample, positive.
+  double cpus;      // Cpus used on average since the previous sample.
+  double mem;       // Resident memory in bytes.
+};
+
+
+// Aggregates of one measurement over the samples in a window.
+struct UsageAggregate
+{
+  UsageAggregate() : samples(0), mean(0), max(0), p95(0) {}
+
+  size_t samples;
+  double mean; // Weighted by the durations of the samples.
+  double max;
+  double p95; // Approximate, see UsageHistory.
+};
+
+
+// The most recent samples of an executor in a ring buffer of fixed
+// capacity, along with the mean, maximum and 95th percentile of each
+// measurement over the last 10 seconds, minute and 5 minutes.
+//
+// Means are weighted by the duration of each sample, so that the
+// samples of an executor that is sampled less often while idle don't
+// count for less than the ones taken while it was busy.
+//
+// The aggregates are maintained as samples enter and leave a window,
+// so adding a sample and reading an aggregate take constant time
+// (amortized for the maximum, which keeps a queue of the samples that
+// may still become the maximum of the window). Percentiles come from a
+// histogram with 16 logarithmic buckets per power of two, so they are
+// within about 3% of the exact value.
+//
+// Once the buffer is full the oldest sample is dropped even if it is
+// still within a window, so the capacity should cover the longest
+// window at the highest sampling frequency (see capacityFor).
+class UsageHistory
+{
+public:
+  enum Measurement
+  {
+    CPUS,
+    MEM,
+    MEASUREMENTS
+  };
+
+  enum Window
+  {
+    WINDOW_10_SECONDS,
+    WINDOW_1_MINUTE,
+    WINDOW_5_MINUTES,
+    WINDOWS
+  };
+
+  // Returns the length of a window in seconds.
+  static double length(Window window);
+
+  // Returns the capacity that covers the longest window when samples
+  // are at least 'interval' seconds apart.
+  static size_t capacityFor(double interval);
+
+  explicit UsageHistory(size_t capacity);
+
+  // Adds a sample, which must not be older than the previous one.
+  void add(const UsageSample& sample);
+
+  UsageAggregate aggregate(Measurement measurement, Window window) const;
+
+  // Returns the number of samples in the buffer.
+  size_t size() const;
+
+  // Returns the latest sample, which must exist.
+  const UsageSample& latest() const;
+
+private:
+  // The state of one measurement over one window. Samples are referred
+  // to by their sequence number, which the buffer index derives from.
+  struct Aggregator
+  {
+    uint64_t tail; // Oldest sample in the window.
+    double sum;    // Of the values times the durations.
+    double weight; // Of the durations.
+
+    // Samples in decreasing order of value, oldest first.
+    std::vector<uint64_t> maxima;
+    uint64_t maximaHead;
+    uint64_t maximaTail;
+
+    std::vector<uint16_t> histogram;
+  };
+
+  double value(uint64_t sequence, Measurement measurement) const;
+
+  // Moves the tail of an aggregator past its oldest sample.
+  void evict(Aggregator* aggregator, Measurement measurement);
+
+  Aggregator& aggregator(Measurement measurement, Window window);
+  const Aggregator& aggregator(Measurement measurement, Window window) const;
+
+  std::vector<UsageSample> samples;
+  uint64_t head; // Sequence number of the next sample.
+  uint64_t tail; // Oldest sample in the buffer.
+
+  std::vector<Aggregator> aggregators;
+};
+
+} // namespace monitoring {
+} // namespace internal {
+} // namespace mesos {
+
+#endif // __USAGE_HISTORY_HPP__
@@ -27,6 +27,13 @@ namespace slave {
 
 const double EXECUTOR_SHUTDOWN_TIMEOUT_SECONDS = 5.0;
 const double STATUS_UPDATE_RETRY_INTERVAL_SECONDS = 10.0;
+const double USAGE_REPORT_THRESHOLD = 0.05;
+const double USAGE_FULL_REPORT_INTERVAL_SECONDS = 60.0;
+const int USAGE_SAMPLES_PER_TICK = 64;
+const int USAGE_TICKS_PER_INTERVAL = 4;
+const double USAGE_MAX_INTERVAL_FACTOR = 8.0;
+const double USAGE_NEAR_LIMIT = 0.9;
+const int USAGE_COLLECTION_THREADS = 2;
 
 } // namespace slave {
 } // namespace internal {
@@ -17,6 +17,7 @@
  */
 
 #include <iomanip>
+#include <map>
 #include <sstream>
 #include <string>
 
@@ -60,10 +61,46 @@ JSON::Object model(const Resources& resources)
   return object;
 }
 
+// Returns a JSON object modeled on a UsageWindow.
+JSON::Object model(const UsageWindow& window)
+{
+  JSON::Object object;
+  object.values["duration"] = window.duration();
+  object.values["samples"] = window.samples();
+
+  if (window.samples() > 0) {
+    object.values["cpus_mean"] = window.cpus_mean();
+    object.values["cpus_max"] = window.cpus_max();
+    object.values["cpus_p95"] = window.cpus_p95();
+    object.values["mem_mean"] = window.mem_mean();
+    object.values["mem_max"] = window.mem_max();
+    object.values["mem_p95"] = window.mem_p95();
+  }
+
+  return object;
+}
+
+
 JSON::Object model(const UsageMessage& usageMessage)
 {
-  JSON::Object a;//TODO(sam or alex): fill the model in here
-  return a;//TODO this is just to get it to compile
+  JSON::Object object;
+
+  // Nothing has been collected yet.
+  if (!usageMessage.has_timestamp()) {
+    return object;
+  }
+
+  object.values["timestamp"] = usageMessage.timestamp();
+  object.values["duration"] = usageMessage.duration();
+  object.values["resources"] = model(Resources(usageMessage.resources()));
+
+  JSON::Array array;
+  foreach (const UsageWindow& window, usageMessage.history()) {
+    array.values.push_back(model(window));
+  }
+  object.values["history"] = array;
+
+  return object;
 }
 
 JSON::Object model(const Executor& executor)
@@ -169,6 +206,29 @@ Future<HttpResponse> stats(
   object.values["valid_status_updates"] = slave.stats.validStatusUpdates;
   object.values["invalid_status_updates"] = slave.stats.invalidStatusUpdates;
 
+  // The mean usage over each window summed over all executors, i.e.,
+  // how much of the slave the executors have been using (shortest
+  // window first).
+  std::map<double, double> cpus, mem;
+  foreachvalue (Framework* framework, slave.frameworks) {
+    foreachvalue (Executor* executor, framework->executors) {
+      foreach (const UsageWindow& window, executor->currentUsage.history()) {
+        cpus[window.duration()] += window.cpus_mean();
+        mem[window.duration()] += window.mem_mean();
+      }
+    }
+  }
+
+  JSON::Array usage;
+  foreachkey (double duration, cpus) {
+    JSON::Object object;
+    object.values["duration"] = duration;
+    object.values["cpus_mean"] = cpus[duration];
+    object.values["mem_mean"] = mem[duration];
+    usage.values.push_back(object);
+  }
+  object.values["usage_history"] = usage;
+
   std::ostringstream out;
 
   JSON::render(out, object);
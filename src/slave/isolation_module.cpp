@@ -51,10 +51,10 @@ void IsolationModule::destroy(IsolationModule* module)
 }
 
 
-Future<UsageMessage> IsolationModule::sampleUsage(const FrameworkID& frameworkId,
-                                 const ExecutorID& executorId)
+Future<std::list<UsageMessage> > IsolationModule::sampleUsage(
+    const std::list<std::pair<FrameworkID, ExecutorID> >& executors)
 {
-  Promise<UsageMessage> p;
+  Promise<std::list<UsageMessage> > p;
   p.fail("usage sampling not available with this isolation module");
   return p.future();
 }
@@ -19,7 +19,9 @@
 #ifndef __ISOLATION_MODULE_HPP__
 #define __ISOLATION_MODULE_HPP__
 
+#include <list>
 #include <string>
+#include <utility>
 
 #include <mesos/mesos.hpp>
 
@@ -68,10 +70,11 @@ public:
                                 const ExecutorID& executorId,
                                 const Resources& resources) = 0;
 
-  // Sample the resource usage for a given executor.
-  // Returns a Future in to prevent usage sampling from blocking.
-  virtual process::Future<UsageMessage> sampleUsage(const FrameworkID& frameworkId,
-                                           const ExecutorID& executorId);
+  // Sample the resource usage of the given executors. Returns a Future
+  // in to prevent usage sampling from blocking. Executors whose usage
+  // could not be sampled are left out.
+  virtual process::Future<std::list<UsageMessage> > sampleUsage(
+      const std::list<std::pair<FrameworkID, ExecutorID> >& executors);
 
 };
 
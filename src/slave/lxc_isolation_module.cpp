@@ -59,7 +59,7 @@ const int64_t MIN_MEMORY_MB = 128 * Megabyte;
 
 
 LxcIsolationModule::LxcIsolationModule()
-  : initialized(false)
+  : initialized(false), monitors(NULL)
 {
   // Spawn the reaper, note that it might send us a message before we
   // actually get spawned ourselves, but that's okay, the message will
@@ -76,6 +76,8 @@ LxcIsolationModule::~LxcIsolationModule()
   terminate(reaper);
   wait(reaper);
   delete reaper;
+
+  delete monitors;
 }
 
 
@@ -100,6 +102,9 @@ void LxcIsolationModule::initialize(
     LOG(FATAL) << "LXC isolation module requires slave to run as root";
   }
 
+  monitors = new ResourceMonitorPool(
+      conf.get<int>("usage_collection_threads", USAGE_COLLECTION_THREADS));
+
   initialized = true;
 }
 
@@ -134,7 +139,6 @@ void LxcIsolationModule::launchExecutor(
   info->container = container;
   // Initialize these variables to handle corner cases.
   info->pid = -1;
-  info->resourceMonitor = NULL;
 
   infos[frameworkId][executorId] = info;
 
@@ -155,8 +159,10 @@ void LxcIsolationModule::launchExecutor(
 
     // Start up the resource monitor.
     LxcResourceCollector* collector = new LxcResourceCollector(container);
-    info->resourceMonitor = new ResourceMonitor(collector);
-    spawn(info->resourceMonitor);
+    // Executors get sampled at most at the slave's frequency.
+    double interval = 1.0 / conf.get<double>("frequency", 1.0);
+    monitors->add(frameworkId, executorId,
+                  new ResourceMonitor(collector, interval));
 
     // Tell the slave this executor has started.
     dispatch(slave, &Slave::executorStarted,
@@ -240,10 +246,8 @@ void LxcIsolationModule::killExecutor(
 
   ContainerInfo* info = infos[frameworkId][executorId];
 
-  // Terminate the monitoring process.
-  if (info->resourceMonitor != NULL) {
-    terminate(info->resourceMonitor);
-  }
+  // Stop monitoring the executor.
+  monitors->remove(frameworkId, executorId);
 
   CHECK(info->container != "");
 
@@ -375,17 +379,14 @@ bool LxcIsolationModule::setControlGroupValue(
 }
 
 
-Future<UsageMessage> LxcIsolationModule::sampleUsage(const FrameworkID& frameworkId,
-                                                     const ExecutorID& executorId)
+Future<std::list<UsageMessage> > LxcIsolationModule::sampleUsage(
+    const std::list<std::pair<FrameworkID, ExecutorID> >& executors)
 {
-  ContainerInfo* info = infos[frameworkId][executorId];//TODO(sam): should this be retrieved more safely (like through an accessor)
-
-  CHECK(info->container != "");
-  return dispatch(info->resourceMonitor,
-      &ResourceMonitor::collectUsage,
-      frameworkId, executorId);
+  CHECK(initialized) << "Cannot sample usage before initialization!";
+  return monitors->collect(executors);
 }
 
+
 vector<string> LxcIsolationModule::getControlGroupOptions(
     const Resources& resources)
 {
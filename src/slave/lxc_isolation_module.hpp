@@ -25,7 +25,7 @@
 #include "isolation_module.hpp"
 #include "reaper.hpp"
 #include "slave.hpp"
-#include "resource_monitor.hpp"
+#include "resource_monitor_pool.hpp"
 
 #include "common/hashmap.hpp"
 
@@ -59,8 +59,8 @@ public:
 
   virtual void processExited(pid_t pid, int status);
 
-  virtual Future<UsageMessage> sampleUsage(const FrameworkID& frameworkId,
-                                           const ExecutorID& executorId);
+  virtual Future<std::list<UsageMessage> > sampleUsage(
+      const std::list<std::pair<FrameworkID, ExecutorID> >& executors);
 
 private:
   // No copying, no assigning.
@@ -78,16 +78,10 @@ private:
   // Per-framework information object maintained in info hashmap.
   struct ContainerInfo
   {
-    ~ContainerInfo()
-    {
-      if (resourceMonitor != NULL)
-        delete resourceMonitor;
-    }
     FrameworkID frameworkId;
     ExecutorID executorId;
     std::string container; // Name of Linux container used for this framework.
     pid_t pid; // PID of lxc-execute command running the executor.
-    ResourceMonitor* resourceMonitor;
   };
 
   // TODO(benh): Make variables const by passing them via constructor.
@@ -96,6 +90,7 @@ private:
   process::PID<Slave> slave;
   bool initialized;
   Reaper* reaper;
+  ResourceMonitorPool* monitors; // Created in initialize.
   hashmap<FrameworkID, hashmap<ExecutorID, ContainerInfo*> > infos;
 };
 
@@ -47,7 +47,7 @@ using utils::stringify;
 
 
 ProcessBasedIsolationModule::ProcessBasedIsolationModule()
-  : initialized(false)
+  : initialized(false), monitors(NULL)
 {
   // Spawn the reaper, note that it might send us a message before we
   // actually get spawned ourselves, but that's okay, the message will
@@ -64,6 +64,8 @@ ProcessBasedIsolationModule::~ProcessBasedIsolationModule()
   terminate(reaper);
   wait(reaper);
   delete reaper;
+
+  delete monitors;
 }
 
 
@@ -76,6 +78,9 @@ void ProcessBasedIsolationModule::initialize(
   local = _local;
   slave = _slave;
 
+  monitors = new ResourceMonitorPool(
+      conf.get<int>("usage_collection_threads", USAGE_COLLECTION_THREADS));
+
   initialized = true;
 }
 
@@ -105,7 +110,6 @@ void ProcessBasedIsolationModule::launchExecutor(
   info->directory = directory;
   // Initialize these variables to handle corner cases.
   info->pid = -1;
-  info->resourceMonitor = NULL;
 
   infos[frameworkId][executorId] = info;
 
@@ -124,8 +128,10 @@ void ProcessBasedIsolationModule::launchExecutor(
     // Start up the resource monitor.
     ProcessResourceCollector* collector = ProcessResourceCollector::create(pid);
     if (collector != NULL) {
-      info->resourceMonitor = new ResourceMonitor(collector);
-      spawn(info->resourceMonitor);
+      // Executors get sampled at most at the slave's frequency.
+      double interval = 1.0 / conf.get<double>("frequency", 1.0);
+      monitors->add(frameworkId, executorId,
+                    new ResourceMonitor(collector, interval));
     }
 
     // Tell the slave this executor has started.
@@ -164,10 +170,8 @@ void ProcessBasedIsolationModule::killExecutor(
   if (pid != -1) {
     ProcessInfo* info = infos[frameworkId][executorId];
 
-    // Terminate the monitoring process.
-    if (info->resourceMonitor != NULL) {
-      terminate(info->resourceMonitor);
-    }
+    // Stop monitoring the executor.
+    monitors->remove(frameworkId, executorId);
 
     // TODO(vinod): Call killtree on the pid of the actual executor process
     // that is running the tasks (stored in the local storage by the
@@ -238,24 +242,11 @@ void ProcessBasedIsolationModule::processExited(pid_t pid, int status)
 }
 
 
-Future<UsageMessage> ProcessBasedIsolationModule::sampleUsage(
-    const FrameworkID& frameworkId, const ExecutorID& executorId)
+Future<std::list<UsageMessage> > ProcessBasedIsolationModule::sampleUsage(
+    const std::list<std::pair<FrameworkID, ExecutorID> >& executors)
 {
-  using namespace process;
-
-  ProcessInfo* info = infos[frameworkId][executorId];//TODO should this be accessed through some sort of accessor method?
+  CHECK(initialized) << "Cannot sample usage before initialization!";
 
-  CHECK(info->pid != -1);
-
-  ResourceMonitor* resourceMonitor = info->resourceMonitor;
-
-  if (resourceMonitor != NULL) { // NULL on unsupported platforms.
-    return dispatch(resourceMonitor,
-        &ResourceMonitor::collectUsage,
-        frameworkId, executorId);
-  } else {
-    Promise<UsageMessage> p;
-    p.fail("resource monitoring not supported on this platform");
-    return p.future();
-  }
+  // Executors without a monitor (on unsupported platforms) are left out.
+  return monitors->collect(executors);
 }
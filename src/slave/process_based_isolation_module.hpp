@@ -26,7 +26,7 @@
 #include "isolation_module.hpp"
 #include "reaper.hpp"
 #include "slave.hpp"
-#include "resource_monitor.hpp"
+#include "resource_monitor_pool.hpp"
 
 #include "common/hashmap.hpp"
 
@@ -62,8 +62,8 @@ public:
 
   virtual void processExited(pid_t pid, int status);
 
-  virtual Future<UsageMessage> sampleUsage(const FrameworkID& frameworkId,
-                                           const ExecutorID& executorId);
+  virtual Future<std::list<UsageMessage> > sampleUsage(
+      const std::list<std::pair<FrameworkID, ExecutorID> >& executors);
 
 protected:
   // Main method executed after a fork() to create a Launcher for launching
@@ -86,16 +86,10 @@ private:
 
   struct ProcessInfo
   {
-    ~ProcessInfo()
-    {
-      if (resourceMonitor != NULL)
-        delete resourceMonitor;
-    }
     FrameworkID frameworkId;
     ExecutorID executorId;
     pid_t pid; // PID of the forked executor process.
     std::string directory; // Working directory of the executor.
-    ResourceMonitor* resourceMonitor;
   };
 
   // TODO(benh): Make variables const by passing them via constructor.
@@ -104,6 +98,7 @@ private:
   process::PID<Slave> slave;
   bool initialized;
   Reaper* reaper;
+  ResourceMonitorPool* monitors; // Created in initialize.
   hashmap<FrameworkID, hashmap<ExecutorID, ProcessInfo*> > infos;
 };
 
@@ -16,24 +16,34 @@
  * limitations under the License.
  */
 
+#include <list>
+#include <string>
+
 #include <mesos/mesos.hpp>
 
-#include "common/resources.hpp"
+#include "common/foreach.hpp"
 
 #include "slave/resource_monitor.hpp"
 
-using process::Clock;
 using process::Future;
 using process::Promise;
-using mesos::internal::monitoring::Rate;
+
+using mesos::internal::monitoring::UsageAggregate;
+using mesos::internal::monitoring::UsageHistory;
+using mesos::internal::monitoring::UsageRecord;
+using mesos::internal::monitoring::UsageSample;
+
+using std::list;
 
 namespace mesos {
 namespace internal {
 namespace slave {
 
 
-ResourceMonitor::ResourceMonitor(ResourceCollector* _collector)
-  : collector(_collector) {}
+ResourceMonitor::ResourceMonitor(ResourceCollector* _collector,
+                                 double interval)
+  : collector(_collector),
+    history(UsageHistory::capacityFor(interval)) {}
 
 
 ResourceMonitor::~ResourceMonitor()
@@ -42,68 +52,154 @@ ResourceMonitor::~ResourceMonitor()
 }
 
 
-// The default implementation collects only the cpu and memory
-// for use in creating a UsageMessage
+// Turns a UsageRecord into a UsageMessage. Resources are added in
+// place rather than merged, since a record never measures the same
+// resource twice.
 Future<UsageMessage> ResourceMonitor::collectUsage(
     const FrameworkID& frameworkId, const ExecutorID& executorId)
 {
-  Promise<UsageMessage> p;
-  Resources resources;
-  double now = Clock::now();
-  double duration = 0;
-
-  collector->collectUsage();
-
-  // TODO(adegtiar or sam): consider making this more general to
-  // avoid code duplication and make it more flexible, e.g.
-  // foreach usageType in ["mem_usage", "cpu_usage", ...]
-  //   collector->getUsage(usageType); (+ Try stuff, etc)
-
-  // Merge the memory usage into the resources.
-  Try<double> memUsage = collector->getMemoryUsage();
-  if (memUsage.isSome()) {
-    mesos::Resource memory;
-    memory.set_type(Value::SCALAR);
-    memory.set_name("mem");
-    memory.mutable_scalar()->set_value(memUsage.get());
-    resources += memory;
-  } else {
-    p.fail(memUsage.error());
-    return p.future();
-  }
+  UsageRecord record;
+  std::string error;
 
-  // Merge the cpu usage into the resources.
-  Try<Rate> cpuUsage = collector->getCpuUsage();
-  if (cpuUsage.isSome()) {
-    Rate rate = cpuUsage.get();
-    mesos::Resource cpu;
-    cpu.set_type(Value::SCALAR);
-    cpu.set_name("cpus");
-    cpu.mutable_scalar()->set_value(rate.difference);
-    duration = rate.duration;
-    resources += cpu;
-  } else {
-    p.fail(cpuUsage.error());
+  if (!collector->collect(&record, &error)) {
+    Promise<UsageMessage> p;
+    p.fail(error);
     return p.future();
   }
 
-  // TODO(adegtiar or sam): Consider returning partial usage reports.
-  // For now if one fails, the other will almost certainly fail, and
-  // so may not be worthwhile. This could change.
-  // return UsageReport(resources, now, duration);
-
   // Assemble the UsageMessage and return the corresponding Future.
   UsageMessage usage;
   usage.mutable_framework_id()->MergeFrom(frameworkId);
   usage.mutable_executor_id()->MergeFrom(executorId);
-  usage.mutable_resources()->MergeFrom(resources);
-  usage.set_timestamp(now);
-  usage.set_duration(duration);
+  usage.set_timestamp(record.timestamp);
+  usage.set_duration(record.duration);
+
+  UsageStatistics* statistics = usage.mutable_statistics();
+
+  // Collectors that can attribute page cache (i.e., containers) are
+  // charged for it along with the resident memory, unless they measure
+  // the total charged themselves.
+  bool haveMem = true;
+  double bytes = 0;
+  if (record.fields & monitoring::USAGE_MEM_TOTAL) {
+    bytes = record.memTotal;
+  } else if (record.fields & monitoring::USAGE_RSS) {
+    bytes = record.rss;
+    if (record.fields & monitoring::USAGE_PAGE_CACHE) {
+      bytes += record.pageCache;
+    }
+  } else {
+    haveMem = false;
+  }
+
+  if (haveMem) {
+    mesos::Resource* memory = usage.add_resources();
+    memory->set_type(Value::SCALAR);
+    memory->set_name("mem");
+    memory->mutable_scalar()->set_value(bytes);
+  }
+
+  if (record.fields & monitoring::USAGE_RSS) {
+    statistics->set_rss_bytes(record.rss);
+  }
+
+  bool haveCpu = true;
+  double cpuTime = 0;
+  if (record.fields & monitoring::USAGE_CPU_TOTAL) {
+    cpuTime = record.cpuTotal;
+  } else if (record.fields & monitoring::USAGE_CPU) {
+    cpuTime = record.cpuUser + record.cpuSystem;
+  } else {
+    haveCpu = false;
+  }
+
+  if (haveCpu) {
+    mesos::Resource* cpu = usage.add_resources();
+    cpu->set_type(Value::SCALAR);
+    cpu->set_name("cpus");
+    cpu->mutable_scalar()->set_value(cpuTime);
+  }
+
+  if (record.fields & monitoring::USAGE_CPU) {
+    statistics->set_cpu_user_time(record.cpuUser);
+    statistics->set_cpu_system_time(record.cpuSystem);
+  }
+
+  if (record.fields & monitoring::USAGE_PAGE_CACHE) {
+    statistics->set_page_cache_bytes(record.pageCache);
+  }
+
+  if (record.fields & monitoring::USAGE_MAJOR_FAULTS) {
+    statistics->set_major_faults(record.majorFaults);
+  }
+
+  if (record.fields & monitoring::USAGE_IO) {
+    statistics->set_io_read_bytes(record.ioReadBytes);
+    statistics->set_io_write_bytes(record.ioWriteBytes);
+  }
+
+  if (record.fields & monitoring::USAGE_CONTEXT_SWITCHES) {
+    statistics->set_context_switches(record.contextSwitches);
+  }
+
+  if (record.fields & monitoring::USAGE_THREADS) {
+    statistics->set_threads(record.threads);
+  }
+
+  if (record.fields & monitoring::USAGE_DELAYS) {
+    statistics->set_cpu_delay_time(record.cpuDelay);
+    statistics->set_blkio_delay_time(record.blkioDelay);
+    statistics->set_swapin_delay_time(record.swapinDelay);
+  }
+
+  // Only cpu rates are comparable across samples of varying duration.
+  if (haveCpu && haveMem && record.duration > 0) {
+    UsageSample sample;
+    sample.timestamp = record.timestamp;
+    sample.duration = record.duration;
+    sample.cpus = cpuTime / record.duration;
+    sample.mem = bytes;
+    history.add(sample);
+  }
+
+  foreach (const UsageWindow& window, summarizeUsage()) {
+    usage.add_history()->MergeFrom(window);
+  }
 
   // Cast into a Future<UsageMessage> and return.
   return usage;
 }
 
+
+list<UsageWindow> ResourceMonitor::summarizeUsage()
+{
+  list<UsageWindow> windows;
+
+  for (int i = 0; i < UsageHistory::WINDOWS; i++) {
+    UsageHistory::Window window = (UsageHistory::Window) i;
+
+    UsageAggregate cpus = history.aggregate(UsageHistory::CPUS, window);
+    UsageAggregate mem = history.aggregate(UsageHistory::MEM, window);
+
+    UsageWindow summary;
+    summary.set_duration(UsageHistory::length(window));
+    summary.set_samples(cpus.samples);
+
+    if (cpus.samples > 0) {
+      summary.set_cpus_mean(cpus.mean);
+      summary.set_cpus_max(cpus.max);
+      summary.set_cpus_p95(cpus.p95);
+      summary.set_mem_mean(mem.mean);
+      summary.set_mem_max(mem.max);
+      summary.set_mem_p95(mem.p95);
+    }
+
+    windows.push_back(summary);
+  }
+
+  return windows;
+}
+
 } // namespace slave {
 } // namespace internal {
 } // namespace mesos {
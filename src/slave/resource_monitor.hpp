@@ -19,12 +19,14 @@
 #ifndef __RESOURCE_MONITOR_HPP__
 #define __RESOURCE_MONITOR_HPP__
 
-#include <process/process.hpp>
+#include <list>
+
 #include <process/future.hpp>
 
 #include "messages/messages.hpp"
 
 #include "monitoring/resource_collector.hpp"
+#include "monitoring/usage_history.hpp"
 
 using mesos::internal::monitoring::ResourceCollector;
 
@@ -33,12 +35,15 @@ namespace internal {
 namespace slave {
 
 // An abstract module for collecting resource usage reports for current
-// resource utilization.
+// resource utilization. Monitors are not thread safe; the isolation
+// modules run them on a ResourceMonitorPool.
 
-class ResourceMonitor : public process::Process<ResourceMonitor>
+class ResourceMonitor
 {
 public:
-  ResourceMonitor(ResourceCollector* collector);
+  // Keeps enough history for usage collected every 'interval' seconds
+  // (or less often).
+  ResourceMonitor(ResourceCollector* collector, double interval = 1.0);
 
   virtual ~ResourceMonitor();
 
@@ -49,8 +54,15 @@ public:
   virtual process::Future<UsageMessage> collectUsage(const FrameworkID& frameworkId,
                                                      const ExecutorID& executorId);
 
+  // Returns the mean, maximum and 95th percentile of the cpu and memory
+  // usage reported by collectUsage, over each of the windows of
+  // UsageHistory. Every UsageMessage carries these as its history.
+  virtual std::list<UsageWindow> summarizeUsage();
+
 protected:
   ResourceCollector* collector;
+
+  monitoring::UsageHistory history;
 };
 
 } // namespace slave {
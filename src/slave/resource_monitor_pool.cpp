@@ -0,0 +1,274 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <glog/logging.h>
+
+#include "common/foreach.hpp"
+#include "common/lock.hpp"
+
+#include "slave/resource_monitor_pool.hpp"
+
+using process::Future;
+using process::Promise;
+
+using std::list;
+using std::make_pair;
+using std::pair;
+using std::vector;
+
+namespace mesos {
+namespace internal {
+namespace slave {
+
+// The state of one call to collect, shared by the jobs it is split
+// into (and protected by the pool's mutex).
+struct ResourceMonitorPool::Collection
+{
+  Promise<list<UsageMessage> > promise;
+  list<UsageMessage> usages;
+  size_t pending; // Jobs not yet done.
+};
+
+
+ResourceMonitorPool::ResourceMonitorPool(int threads)
+  : stopped(false)
+{
+  CHECK(threads > 0);
+
+  pthread_mutex_init(&mutex, NULL);
+
+  for (int i = 0; i < threads; i++) {
+    Worker* worker = new Worker();
+    worker->pool = this;
+    worker->monitors = 0;
+    pthread_cond_init(&worker->cond, NULL);
+    workers.push_back(worker);
+  }
+
+  foreach (Worker* worker, workers) {
+    if (pthread_create(&worker->thread, NULL, run, worker) != 0) {
+      PLOG(FATAL) << "Failed to create usage collection thread";
+    }
+  }
+}
+
+
+ResourceMonitorPool::~ResourceMonitorPool()
+{
+  {
+    Lock lock(&mutex);
+    stopped = true;
+    foreach (Worker* worker, workers) {
+      pthread_cond_signal(&worker->cond);
+    }
+  }
+
+  // The workers finish their queued jobs before they exit.
+  foreach (Worker* worker, workers) {
+    pthread_join(worker->thread, NULL);
+    pthread_cond_destroy(&worker->cond);
+    delete worker;
+  }
+
+  foreachvalue (const Entry& entry, entries) {
+    delete entry.monitor;
+  }
+
+  pthread_mutex_destroy(&mutex);
+}
+
+
+void ResourceMonitorPool::add(
+    const FrameworkID& frameworkId,
+    const ExecutorID& executorId,
+    ResourceMonitor* monitor)
+{
+  Lock lock(&mutex);
+
+  const pair<FrameworkID, ExecutorID> key = make_pair(frameworkId, executorId);
+  CHECK(entries.find(key) == entries.end());
+
+  size_t worker = 0;
+  for (size_t i = 1; i < workers.size(); i++) {
+    if (workers[i]->monitors < workers[worker]->monitors) {
+      worker = i;
+    }
+  }
+
+  Entry entry;
+  entry.monitor = monitor;
+  entry.worker = worker;
+  entry.frameworkId = frameworkId;
+  entry.executorId = executorId;
+
+  entries[key] = entry;
+  workers[worker]->monitors++;
+}
+
+
+void ResourceMonitorPool::remove(
+    const FrameworkID& frameworkId,
+    const ExecutorID& executorId)
+{
+  Lock lock(&mutex);
+
+  hashmap<pair<FrameworkID, ExecutorID>, Entry>::iterator iterator =
+    entries.find(make_pair(frameworkId, executorId));
+
+  if (iterator == entries.end()) {
+    return;
+  }
+
+  // Jobs run in order, so the ones that use the monitor are done by
+  // the time the worker gets to delete it.
+  Job job;
+  job.collection = NULL;
+  job.entries.push_back(iterator->second);
+
+  workers[iterator->second.worker]->monitors--;
+  enqueue(iterator->second.worker, job);
+
+  entries.erase(iterator);
+}
+
+
+Future<list<UsageMessage> > ResourceMonitorPool::collect(
+    const list<pair<FrameworkID, ExecutorID> >& executors)
+{
+  Lock lock(&mutex);
+
+  Collection* collection = new Collection();
+  collection->pending = 0;
+
+  // Keep the future, the collection may be gone once it is enqueued.
+  Future<list<UsageMessage> > future = collection->promise.future();
+
+  vector<Job> jobs(workers.size());
+
+  typedef pair<FrameworkID, ExecutorID> Key;
+  foreach (const Key& key, executors) {
+    hashmap<Key, Entry>::iterator iterator = entries.find(key);
+    if (iterator != entries.end()) {
+      jobs[iterator->second.worker].entries.push_back(iterator->second);
+    }
+  }
+
+  for (size_t i = 0; i < jobs.size(); i++) {
+    if (!jobs[i].entries.empty()) {
+      jobs[i].collection = collection;
+      collection->pending++;
+    }
+  }
+
+  if (collection->pending == 0) {
+    lock.unlock();
+    collection->promise.set(list<UsageMessage>());
+    delete collection;
+    return future;
+  }
+
+  for (size_t i = 0; i < jobs.size(); i++) {
+    if (!jobs[i].entries.empty()) {
+      enqueue(i, jobs[i]);
+    }
+  }
+
+  return future;
+}
+
+
+void* ResourceMonitorPool::run(void* arg)
+{
+  Worker* worker = static_cast<Worker*>(arg);
+  worker->pool->work(worker);
+  return NULL;
+}
+
+
+void ResourceMonitorPool::work(Worker* worker)
+{
+  Lock lock(&mutex);
+
+  while (true) {
+    while (worker->jobs.empty() && !stopped) {
+      pthread_cond_wait(&worker->cond, &mutex);
+    }
+
+    if (worker->jobs.empty()) {
+      return; // Stopped.
+    }
+
+    Job job = worker->jobs.front();
+    worker->jobs.pop_front();
+
+    // Collect without holding the lock, the monitors belong to this
+    // worker alone.
+    lock.unlock();
+
+    if (job.collection == NULL) {
+      foreach (const Entry& entry, job.entries) {
+        delete entry.monitor;
+      }
+      lock.lock();
+      continue;
+    }
+
+    list<UsageMessage> usages;
+
+    foreach (const Entry& entry, job.entries) {
+      Future<UsageMessage> usage =
+        entry.monitor->collectUsage(entry.frameworkId, entry.executorId);
+
+      usage.await();
+
+      if (usage.isReady()) {
+        usages.push_back(usage.get());
+      } else {
+        LOG(WARNING) << "Failed to collect the usage of executor "
+                     << entry.executorId << " of framework "
+                     << entry.frameworkId << ": "
+                     << (usage.isFailed() ? usage.failure() : "discarded");
+      }
+    }
+
+    lock.lock();
+
+    Collection* collection = job.collection;
+    collection->usages.splice(collection->usages.end(), usages);
+
+    if (--collection->pending == 0) {
+      // Nobody else refers to the collection anymore.
+      lock.unlock();
+      collection->promise.set(collection->usages);
+      delete collection;
+      lock.lock();
+    }
+  }
+}
+
+
+// Expects the lock to be held.
+void ResourceMonitorPool::enqueue(size_t index, const Job& job)
+{
+  workers[index]->jobs.push_back(job);
+  pthread_cond_signal(&workers[index]->cond);
+}
+
+} // namespace slave {
+} // namespace internal {
+} // namespace mesos {
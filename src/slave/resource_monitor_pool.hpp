@@ -0,0 +1,126 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __RESOURCE_MONITOR_POOL_HPP__
+#define __RESOURCE_MONITOR_POOL_HPP__
+
+#include <pthread.h>
+
+#include <deque>
+#include <list>
+#include <utility>
+#include <vector>
+
+#include <process/future.hpp>
+
+#include "common/hashmap.hpp"
+#include "common/type_utils.hpp"
+
+#include "messages/messages.hpp"
+
+#include "slave/resource_monitor.hpp"
+
+namespace mesos {
+namespace internal {
+namespace slave {
+
+// Collects the usage of executors on a fixed number of threads of its
+// own, so that reading /proc or cgroups does not hold up libprocess.
+//
+// Every monitor is assigned to one thread (the one with the fewest
+// monitors at the time it is added) and is only ever used from that
+// thread, so monitors need not be thread safe. A collection is split
+// into one job per thread, and its future is set once all of them are
+// done.
+class ResourceMonitorPool
+{
+public:
+  explicit ResourceMonitorPool(int threads);
+
+  // Waits for the collections in progress and deletes the monitors.
+  ~ResourceMonitorPool();
+
+  // Takes ownership of the monitor.
+  void add(const FrameworkID& frameworkId,
+           const ExecutorID& executorId,
+           ResourceMonitor* monitor);
+
+  // The monitor is deleted once the collections that already involve
+  // it are done.
+  void remove(const FrameworkID& frameworkId, const ExecutorID& executorId);
+
+  // Collects the usage of the given executors. Executors without a
+  // monitor, and those whose usage could not be collected, are left
+  // out of the result.
+  process::Future<std::list<UsageMessage> > collect(
+      const std::list<std::pair<FrameworkID, ExecutorID> >& executors);
+
+private:
+  // No copying, no assigning.
+  ResourceMonitorPool(const ResourceMonitorPool&);
+  ResourceMonitorPool& operator = (const ResourceMonitorPool&);
+
+  struct Collection;
+
+  struct Entry
+  {
+    ResourceMonitor* monitor;
+    size_t worker;
+    FrameworkID frameworkId;
+    ExecutorID executorId;
+  };
+
+  // Either the part of a collection that falls on one worker or, if
+  // collection is NULL, a monitor to delete.
+  struct Job
+  {
+    Collection* collection;
+    std::vector<Entry> entries;
+  };
+
+  struct Worker
+  {
+    ResourceMonitorPool* pool;
+    pthread_t thread;
+    pthread_cond_t cond;
+    std::deque<Job> jobs;
+    size_t monitors; // Number of monitors assigned to this worker.
+  };
+
+  static void* run(void* arg);
+
+  // Runs the jobs of a worker until the pool is stopped.
+  void work(Worker* worker);
+
+  void enqueue(size_t index, const Job& job);
+
+  std::vector<Worker*> workers;
+
+  // Protects everything but the monitors themselves.
+  pthread_mutex_t mutex;
+
+  bool stopped;
+
+  hashmap<std::pair<FrameworkID, ExecutorID>, Entry> entries;
+};
+
+} // namespace slave {
+} // namespace internal {
+} // namespace mesos {
+
+#endif // __RESOURCE_MONITOR_POOL_HPP__
@@ -17,12 +17,15 @@
  */
 
 #include <errno.h>
+#include <math.h>
+#include <stdlib.h>
 
 #include <algorithm>
 #include <iomanip>
+#include <vector>
 
+#include <process/defer.hpp>
 #include <process/timer.hpp>
-#include <process/collect.hpp>
 
 #include "common/build.hpp"
 #include "common/option.hpp"
@@ -151,6 +154,28 @@ void Slave::registerOptions(Configurator* configurator)
       "executor_shutdown_timeout_seconds",
       "Amount of time (in seconds) to wait for an executor to shut down\n",
       EXECUTOR_SHUTDOWN_TIMEOUT_SECONDS);
+
+  configurator->addOption<double>(
+      "usage_report_threshold",
+      "Relative change in the cpu or memory usage of an executor\n"
+      "below which the usage is not sent to the master\n",
+      USAGE_REPORT_THRESHOLD);
+
+  configurator->addOption<int>(
+      "usage_samples_per_tick",
+      "Maximum number of executors to sample the usage of at once\n",
+      USAGE_SAMPLES_PER_TICK);
+
+  configurator->addOption<int>(
+      "usage_collection_threads",
+      "Number of threads the isolation module samples usage on\n",
+      USAGE_COLLECTION_THREADS);
+
+  configurator->addOption<double>(
+      "usage_full_report_interval_seconds",
+      "Amount of time (in seconds) after which the usage of all\n"
+      "executors is sent to the master, changed or not\n",
+      USAGE_FULL_REPORT_INTERVAL_SECONDS);
 }
 
 
@@ -290,6 +315,15 @@ void Slave::initialize()
   route("state.json", bind(&http::json::state, cref(*this), params::_1));
 
   pollDelay = 1.0 / conf.get<double>("frequency", 1.0);
+  usageSamplesPerTick =
+    conf.get<int>("usage_samples_per_tick", USAGE_SAMPLES_PER_TICK);
+
+  usageReportThreshold =
+    conf.get<double>("usage_report_threshold", USAGE_REPORT_THRESHOLD);
+  usageFullReportInterval =
+    conf.get<double>("usage_full_report_interval_seconds",
+                     USAGE_FULL_REPORT_INTERVAL_SECONDS);
+  lastFullUsageReport = 0;
 
   delay(pollDelay, self(), &Slave::queueUsageUpdates);
 }
@@ -349,6 +383,9 @@ void Slave::registered(const SlaveID& slaveId)
   LOG(INFO) << "Registered with master; given slave ID " << slaveId;
   id = slaveId;
   connected = true;
+
+  // The master knows nothing about our executors yet.
+  lastFullUsageReport = 0;
 }
 
 
@@ -360,6 +397,9 @@ void Slave::reregistered(const SlaveID& slaveId)
     LOG(FATAL) << "Slave re-registered but got wrong ID";
   }
   connected = true;
+
+  // The master may have failed over and lost all usage.
+  lastFullUsageReport = 0;
 }
 
 
@@ -1441,47 +1481,226 @@ string Slave::createUniqueWorkDirectory(const FrameworkID& frameworkId,
   }
 }
 
+// Every executor is sampled once per its own usageInterval, which
+// starts out at pollDelay and doubles (up to USAGE_MAX_INTERVAL_FACTOR
+// times pollDelay) with every sample that finds its usage unchanged
+// (see retrieveUsage). The first sample of an executor is taken at a
+// random point within pollDelay, which keeps the samples of executors
+// launched together from lining up.
 void Slave::queueUsageUpdates()
 {
-  std::list<Future<UsageMessage> > futures;
+  double now = Clock::now();
 
-  foreachpair (const FrameworkID& frameworkId, const Framework* framework, frameworks) {
-    foreachkey (const ExecutorID& executorId, framework->executors) {
-      futures.push_back(isolationModule->sampleUsage(frameworkId, executorId));
+  std::vector<std::pair<double, Executor*> > due;
+
+  foreachvalue (Framework* framework, frameworks) {
+    foreachvalue (Executor* executor, framework->executors) {
+      if (executor->usageInterval == 0) {
+        executor->usageInterval = pollDelay;
+        executor->nextUsageSample =
+          now + pollDelay * (::random() / (RAND_MAX + 1.0));
+      }
+
+      if (executor->nextUsageSample <= now) {
+        due.push_back(std::make_pair(executor->nextUsageSample, executor));
+      }
     }
   }
-  
-  if (!futures.empty()) {
-    Future<std::list<UsageMessage> > future = collect(futures);
+
+  // Leave the executors that have been due the shortest for later.
+  if (usageSamplesPerTick > 0 && due.size() > (size_t) usageSamplesPerTick) {
+    std::partial_sort(due.begin(), due.begin() + usageSamplesPerTick,
+                      due.end());
+    due.resize(usageSamplesPerTick);
+  }
+
+  std::list<std::pair<FrameworkID, ExecutorID> > executors;
+
+  for (size_t i = 0; i < due.size(); i++) {
+    Executor* executor = due[i].second;
+    executor->nextUsageSample = now + executor->usageInterval;
+    executors.push_back(std::make_pair(executor->frameworkId, executor->id));
+  }
+
+  if (!executors.empty()) {
+    Future<std::list<UsageMessage> > future =
+      isolationModule->sampleUsage(executors);
     future.onAny(defer(self(), &Slave::retrieveUsage, future));
+  } else if (connected && now - lastFullUsageReport >= usageFullReportInterval) {
+    // Nothing is due, but the master still needs to hear about the
+    // usage of the executors that have been backed off from.
+    reportUsage(std::list<UsageMessage>());
   }
 
-  delay(pollDelay, self(), &Slave::queueUsageUpdates);
+  delay(pollDelay / USAGE_TICKS_PER_INTERVAL,
+        self(),
+        &Slave::queueUsageUpdates);
+}
+
+// Returns the cpus used on average over the duration of a sample.
+static double cpuRate(const UsageMessage& usage)
+{
+  if (!usage.has_duration() || usage.duration() <= 0) {
+    return 0;
+  }
+
+  Resources resources = usage.resources();
+  return resources.get("cpus", Value::Scalar()).value() / usage.duration();
+}
+
+
+// Returns whether the cpu or memory usage changed by more than
+// 'threshold' relative to the previous usage.
+static bool usageChanged(
+    const UsageMessage& previous,
+    const UsageMessage& current,
+    double threshold)
+{
+  if (!previous.has_timestamp()) {
+    return true; // Never reported.
+  }
+
+  if (previous.resources_size() != current.resources_size()) {
+    return true; // Started or stopped measuring something.
+  }
+
+  double cpus = cpuRate(previous);
+  if (fabs(cpuRate(current) - cpus) > threshold * cpus) {
+    return true;
+  }
+
+  Resources resources = previous.resources();
+  double mem = resources.get("mem", Value::Scalar()).value();
+
+  resources = current.resources();
+  return fabs(resources.get("mem", Value::Scalar()).value() - mem) >
+    threshold * mem;
+}
+
+
+// Returns whether the usage is close to what the executor was given.
+static bool nearLimit(const Executor& executor, const UsageMessage& usage)
+{
+  Resources resources = usage.resources();
+
+  double cpus = executor.resources.get("cpus", Value::Scalar()).value();
+  if (cpus > 0 && cpuRate(usage) >= USAGE_NEAR_LIMIT * cpus) {
+    return true;
+  }
+
+  // Usage is in bytes, allocations in megabytes.
+  double mem = executor.resources.get("mem", Value::Scalar()).value();
+  return mem > 0 &&
+    resources.get("mem", Value::Scalar()).value() / 1048576.0 >=
+      USAGE_NEAR_LIMIT * mem;
+}
+
+
+// Adds the usage of an executor to a message for the master. The
+// history windows change little from one sample to the next, so they
+// are only sent along with the periodic full reports (the slave
+// serves the latest ones, see slave/http.cpp).
+static void addUsage(
+    SlaveUsageMessage* message,
+    const UsageMessage& um,
+    bool history)
+{
+  ExecutorUsage* usage = message->add_executors();
+  usage->mutable_framework_id()->MergeFrom(um.framework_id());
+  usage->mutable_executor_id()->MergeFrom(um.executor_id());
+  usage->mutable_resources()->MergeFrom(um.resources());
+  usage->set_timestamp(um.timestamp());
+  if (um.has_duration()) {
+    usage->set_duration(um.duration());
+  }
+  if (um.has_statistics()) {
+    usage->mutable_statistics()->MergeFrom(um.statistics());
+  }
+  if (history) {
+    usage->mutable_history()->MergeFrom(um.history());
+  }
 }
 
+
 void Slave::retrieveUsage(const Future<std::list<UsageMessage> >& future)
 {
   if (future.isReady()) {
-    std::list<UsageMessage> ums = future.get();
-    foreach (const UsageMessage &um, ums) {
-      Framework *f = getFramework(um.framework_id());
-      if (f != NULL) {
-        Executor *e = f->getExecutor(um.executor_id());
-        if (e != NULL) {
-          e->currentUsage = um;
-          Resources usage = um.resources();
-          LOG(INFO) << "mem_usage: " << usage.get("mem_usage", Value::Scalar()).value()
-            << " | cpu_usage: " << usage.get("cpu_usage", Value::Scalar()).value()
-            << " | duration: " << um.duration();
-        }
-      }
-    }
+    reportUsage(future.get());
   } else {
     assert(future.isFailed());//TODO do we need this assertion?
     LOG(WARNING) << "Error retrieving at least 1 usage message: " << future.failure();
   }
 }
 
+
+void Slave::reportUsage(const std::list<UsageMessage>& ums)
+{
+  SlaveUsageMessage message;
+  message.mutable_slave_id()->MergeFrom(id);
+
+  // Periodically send everything, so that the master catches up
+  // with usage that drifted away slowly and executors that it never
+  // heard of.
+  bool full = connected &&
+    Clock::now() - lastFullUsageReport >= usageFullReportInterval;
+
+  foreach (const UsageMessage &um, ums) {
+    Framework *f = getFramework(um.framework_id());
+    if (f != NULL) {
+      Executor *e = f->getExecutor(um.executor_id());
+      if (e != NULL) {
+        // Keep a close eye on executors that are busy changing or
+        // about to run out, and back off from the others.
+        if (usageChanged(e->currentUsage, um, usageReportThreshold) ||
+            nearLimit(*e, um)) {
+          e->usageInterval = pollDelay;
+        } else {
+          e->usageInterval = std::min(2 * e->usageInterval,
+                                      USAGE_MAX_INTERVAL_FACTOR * pollDelay);
+        }
+        e->nextUsageSample =
+          std::min(e->nextUsageSample, um.timestamp() + e->usageInterval);
+
+        e->currentUsage = um;
+        e->currentUsage.mutable_slave_id()->MergeFrom(id);
+
+        // A full report includes every executor below.
+        if (full ||
+            !usageChanged(e->reportedUsage, um, usageReportThreshold)) {
+          continue;
+        }
+
+        e->reportedUsage = e->currentUsage;
+        addUsage(&message, e->currentUsage, false);
+      }
+    }
+  }
+
+  // Only some executors are sampled at a time, so a full report
+  // sends the most recent usage of all of them.
+  if (full) {
+    foreachvalue (Framework* framework, frameworks) {
+      foreachvalue (Executor* executor, framework->executors) {
+        if (executor->currentUsage.has_timestamp()) {
+          executor->reportedUsage = executor->currentUsage;
+          addUsage(&message, executor->currentUsage, true);
+        }
+      }
+    }
+  }
+
+  if (connected && message.executors_size() > 0) {
+    VLOG(1) << "Sending " << (full ? "full" : "changed")
+            << " usage of " << message.executors_size()
+            << " executors to master " << master;
+    send(master, message);
+  }
+
+  if (full) {
+    lastFullUsageReport = Clock::now();
+  }
+}
+
 } // namespace slave {
 } // namespace internal {
 } // namespace mesos {
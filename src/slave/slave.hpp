@@ -142,10 +142,10 @@ protected:
   std::string createUniqueWorkDirectory(const FrameworkID& frameworkId,
                                         const ExecutorID& executorId);
 
-  // Ask the slave to update the UsageMessage instance in all executor
-  // info structs.
-  // TODO (sam,*): This needs to be organized better instead of hard-
-  // coded to do a 1-second delay.
+  // Ask the isolation module for the usage of the executors whose next
+  // sample is due, at most usageSamplesPerTick of them. Runs
+  // USAGE_TICKS_PER_INTERVAL times per pollDelay so that samples are
+  // spread out rather than all taken at once.
   void queueUsageUpdates();
 
 private:
@@ -165,9 +165,15 @@ private:
       const HttpRequest& request);
 
   // Method to collect UsageMessage instances from requests made
-  // to isolation module (and subsequently to ResourceMonitor).
+  // to isolation module (and subsequently to ResourceMonitor), and
+  // send them on to the master in a single SlaveUsageMessage.
   void retrieveUsage(const Future<std::list<UsageMessage> >& future);
 
+  // Sends the master the usage that changed since it was last sent
+  // (or, every usageFullReportInterval seconds, the most recent usage
+  // of every executor), given the usage just sampled.
+  void reportUsage(const std::list<UsageMessage>& ums);
+
   const Configuration conf;
 
   bool local;
@@ -194,7 +200,15 @@ private:
   } stats;
 
   double startTime;
-  double pollDelay; // The amount to wait between calling queueUsageUpdates. 1/conf.frequency
+  double pollDelay; // The shortest interval between samples of an executor. 1/conf.frequency
+  int usageSamplesPerTick; // The most executors queueUsageUpdates samples at once.
+
+  // Usage of an executor is only sent to the master if it changed by
+  // more than usageReportThreshold (relative to the usage last sent),
+  // except that every usageFullReportInterval seconds all of it is.
+  double usageReportThreshold;
+  double usageFullReportInterval;
+  double lastFullUsageReport;
 
   bool connected; // Flag to indicate if slave is registered.
 //   typedef std::pair<FrameworkID, TaskID> StatusUpdateStreamID;
@@ -216,6 +230,8 @@ struct Executor
       id(_info.executor_id()),
       uuid(UUID::random()),
       pid(UPID()),
+      usageInterval(0),
+      nextUsageSample(0),
       shutdown(false),
       resources(_info.resources()) {}
 
@@ -281,6 +297,12 @@ struct Executor
   UPID pid;
 
   UsageMessage currentUsage; // the most recent usage reported from the isolation module
+  UsageMessage reportedUsage; // The usage last sent to the master.
+
+  // Seconds between samples of the usage (0 until first scheduled), and
+  // when the next sample is due (see Slave::queueUsageUpdates).
+  double usageInterval;
+  double nextUsageSample;
 
   bool shutdown; // Indicates if executor is being shut down.
 
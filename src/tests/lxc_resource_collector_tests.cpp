@@ -0,0 +1,206 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <string>
+
+#include "common/hashmap.hpp"
+#include "common/try.hpp"
+#include "common/utils.hpp"
+
+#include "monitoring/linux/cgroup_reader.hpp"
+#include "monitoring/linux/lxc_resource_collector.hpp"
+
+using std::string;
+
+namespace mesos {
+namespace internal {
+namespace monitoring {
+
+// Lays out a fake cgroupfs in a temporary directory: the cpuacct
+// hierarchy keeps containers at its root (old lxc) while the memory
+// hierarchy, mounted at a path with a space in it, keeps them below
+// "lxc" (newer lxc).
+class LxcResourceCollectorTest : public ::testing::Test
+{
+protected:
+  virtual void SetUp()
+  {
+    char temp[] = "/tmp/mesos-cgroup-XXXXXX";
+    ASSERT_TRUE(mkdtemp(temp) != NULL);
+    root = temp;
+
+    ASSERT_TRUE(utils::os::mkdir(root + "/cpu/container"));
+    ASSERT_TRUE(utils::os::mkdir(root + "/memory controller/lxc/container"));
+
+    mountinfo = root + "/mountinfo";
+    write(mountinfo,
+          "15 20 0:3 / /proc rw,nosuid - proc proc rw\n"
+          "30 20 0:25 / " + root + "/cpu rw,relatime shared:12 - "
+          "cgroup cgroup rw,cpu,cpuacct\n"
+          "31 20 0:26 / " + root + "/memory\\040controller rw,relatime - "
+          "cgroup cgroup rw,memory\n");
+  }
+
+  virtual void TearDown()
+  {
+    utils::os::rmdir(root);
+  }
+
+  void write(const string& path, const string& contents)
+  {
+    // Truncates rather than replaces the file, like the kernel updates
+    // a control in place.
+    FILE* file = fopen(path.c_str(), "w");
+    ASSERT_TRUE(file != NULL);
+    fputs(contents.c_str(), file);
+    fclose(file);
+  }
+
+  string root;
+  string mountinfo;
+};
+
+
+TEST_F(LxcResourceCollectorTest, CgroupMount)
+{
+  Try<string> mount = getCgroupMount("cpuacct", mountinfo);
+  ASSERT_TRUE(mount.isSome());
+  EXPECT_EQ(root + "/cpu", mount.get());
+
+  // Octal escapes in the mount point are undone.
+  mount = getCgroupMount("memory", mountinfo);
+  ASSERT_TRUE(mount.isSome());
+  EXPECT_EQ(root + "/memory controller", mount.get());
+
+  EXPECT_TRUE(getCgroupMount("blkio", mountinfo).isError());
+  EXPECT_TRUE(getCgroupMount("cpuacct", root + "/missing").isError());
+}
+
+
+TEST_F(LxcResourceCollectorTest, ReadsControls)
+{
+  write(root + "/cpu/container/cpuacct.usage", "2000000000\n");
+  write(root + "/memory controller/lxc/container/memory.stat",
+        "cache 4096\nrss 1048576\npgmajfault 7\n");
+
+  CgroupReader cgroups("container", mountinfo);
+
+  Try<unsigned long long> usage = cgroups.read("cpuacct.usage");
+  ASSERT_TRUE(usage.isSome());
+  EXPECT_EQ(2000000000ull, usage.get());
+
+  // Controls are re-read through the descriptor opened the first time.
+  write(root + "/cpu/container/cpuacct.usage", "5000000000\n");
+  usage = cgroups.read("cpuacct.usage");
+  ASSERT_TRUE(usage.isSome());
+  EXPECT_EQ(5000000000ull, usage.get());
+
+  EXPECT_TRUE(cgroups.read("cpuacct.stat").isError());
+  EXPECT_TRUE(cgroups.read("blkio.io_serviced").isError());
+
+  Try<hashmap<string, unsigned long long> > fields =
+    cgroups.readFields("memory.stat");
+  ASSERT_TRUE(fields.isSome());
+  EXPECT_EQ(3u, fields.get().size());
+  EXPECT_EQ(1048576u, fields.get().find("rss")->second);
+}
+
+
+TEST_F(LxcResourceCollectorTest, Collects)
+{
+  long ticks = sysconf(_SC_CLK_TCK);
+
+  write(root + "/cpu/container/cpuacct.usage", "3500000000\n");
+  write(root + "/cpu/container/cpuacct.stat",
+        "user " + utils::stringify(2 * ticks) + "\n"
+        "system " + utils::stringify(ticks) + "\n");
+  write(root + "/memory controller/lxc/container/memory.memsw.usage_in_bytes",
+        "2097152\n");
+  write(root + "/memory controller/lxc/container/memory.stat",
+        "cache 4096\nrss 1048576\npgmajfault 7\n");
+
+  LxcResourceCollector collector("container", mountinfo);
+
+  UsageRecord usage;
+  string error;
+  ASSERT_TRUE(collector.collect(&usage, &error));
+
+  EXPECT_EQ(USAGE_CPU_TOTAL | USAGE_MEM_TOTAL | USAGE_CPU | USAGE_RSS |
+            USAGE_PAGE_CACHE | USAGE_MAJOR_FAULTS,
+            usage.fields);
+  EXPECT_EQ(3.5, usage.cpuTotal);
+  EXPECT_EQ(2097152.0, usage.memTotal);
+  EXPECT_EQ(2.0, usage.cpuUser);
+  EXPECT_EQ(1.0, usage.cpuSystem);
+  EXPECT_EQ(1048576.0, usage.rss);
+  EXPECT_EQ(4096.0, usage.pageCache);
+  EXPECT_EQ(7.0, usage.majorFaults);
+
+  write(root + "/cpu/container/cpuacct.usage", "6750000000\n");
+  write(root + "/cpu/container/cpuacct.stat",
+        "user " + utils::stringify(5 * ticks) + "\n"
+        "system " + utils::stringify(ticks) + "\n");
+
+  ASSERT_TRUE(collector.collect(&usage, &error));
+  EXPECT_EQ(3.25, usage.cpuTotal);
+  EXPECT_EQ(3.0, usage.cpuUser);
+  EXPECT_EQ(0.0, usage.cpuSystem);
+  EXPECT_EQ(0.0, usage.majorFaults);
+}
+
+
+// The breakdowns are optional, the totals are not.
+TEST_F(LxcResourceCollectorTest, CollectsTotalsOnly)
+{
+  write(root + "/cpu/container/cpuacct.usage", "1000000000\n");
+
+  LxcResourceCollector collector("container", mountinfo);
+
+  UsageRecord usage;
+  string error;
+  EXPECT_FALSE(collector.collect(&usage, &error));
+  EXPECT_FALSE(error.empty());
+
+  write(root + "/memory controller/lxc/container/memory.memsw.usage_in_bytes",
+        "2097152\n");
+
+  ASSERT_TRUE(collector.collect(&usage, &error));
+  EXPECT_EQ(USAGE_CPU_TOTAL | USAGE_MEM_TOTAL, usage.fields);
+  EXPECT_EQ(1.0, usage.cpuTotal);
+  EXPECT_EQ(2097152.0, usage.memTotal);
+}
+
+
+TEST_F(LxcResourceCollectorTest, MissingContainer)
+{
+  LxcResourceCollector collector("missing", mountinfo);
+
+  UsageRecord usage;
+  string error;
+  EXPECT_FALSE(collector.collect(&usage, &error));
+  EXPECT_FALSE(error.empty());
+}
+
+} // namespace monitoring {
+} // namespace internal {
+} // namespace mesos {
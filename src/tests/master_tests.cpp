@@ -21,6 +21,8 @@
 #include <mesos/executor.hpp>
 #include <mesos/scheduler.hpp>
 
+#include "common/json.hpp"
+
 #include "detector/detector.hpp"
 
 #include "local/local.hpp"
@@ -29,6 +31,7 @@
 #include "master/master.hpp"
 #include "master/simple_allocator.hpp"
 
+#include <process/clock.hpp>
 #include <process/dispatch.hpp>
 #include <process/future.hpp>
 
@@ -506,6 +509,757 @@ TEST(MasterTest, MultipleExecutors)
 }
 
 
+// A framework that is removed while only its executor runs on a slave
+// (which is otherwise offered to another framework) must give the
+// executor's resources back to the allocator.
+TEST(MasterTest, ReoffersExecutorResourcesOfRemovedFramework)
+{
+  ASSERT_TRUE(GTEST_IS_THREADSAFE);
+
+  SimpleAllocator a;
+  Master m(&a);
+  PID<Master> master = process::spawn(&m);
+
+  MockExecutor exec;
+  trigger shutdownCall;
+
+  EXPECT_CALL(exec, registered(_, _, _, _, _, _))
+    .Times(1);
+
+  EXPECT_CALL(exec, launchTask(_, _))
+    .WillOnce(SendStatusUpdate(TASK_FINISHED));
+
+  EXPECT_CALL(exec, shutdown(_))
+    .WillOnce(Trigger(&shutdownCall));
+
+  ExecutorID executorId;
+  executorId.set_value("executor-1");
+
+  map<ExecutorID, Executor*> execs;
+  execs[executorId] = &exec;
+
+  TestingIsolationModule isolationModule(execs);
+
+  Resources resources = Resources::parse("cpus:2;mem:1024");
+
+  Slave s(resources, true, &isolationModule);
+  PID<Slave> slave = process::spawn(&s);
+
+  BasicMasterDetector detector(master, slave, true);
+
+  MockScheduler sched1;
+  MesosSchedulerDriver driver1(&sched1, "", DEFAULT_EXECUTOR_INFO, master);
+
+  vector<Offer> offers1;
+  TaskStatus status;
+
+  trigger resourceOffersCall1, statusUpdateCall;
+
+  EXPECT_CALL(sched1, registered(&driver1, _))
+    .Times(1);
+
+  EXPECT_CALL(sched1, resourceOffers(&driver1, _))
+    .WillOnce(DoAll(SaveArg<1>(&offers1),
+                    Trigger(&resourceOffersCall1)))
+    .WillRepeatedly(Return());
+
+  EXPECT_CALL(sched1, statusUpdate(&driver1, _))
+    .WillOnce(DoAll(SaveArg<1>(&status), Trigger(&statusUpdateCall)));
+
+  driver1.start();
+
+  WAIT_UNTIL(resourceOffersCall1);
+
+  ASSERT_NE(0, offers1.size());
+
+  // The second framework gets nothing while the first one holds the
+  // whole slave.
+  MockScheduler sched2;
+  MesosSchedulerDriver driver2(&sched2, "", DEFAULT_EXECUTOR_INFO, master);
+
+  vector<Offer> offers2, offers3;
+
+  trigger registeredCall2, resourceOffersCall2, resourceOffersCall3;
+
+  EXPECT_CALL(sched2, registered(&driver2, _))
+    .WillOnce(Trigger(&registeredCall2));
+
+  EXPECT_CALL(sched2, resourceOffers(&driver2, _))
+    .WillOnce(DoAll(SaveArg<1>(&offers2),
+                    Trigger(&resourceOffersCall2)))
+    .WillOnce(DoAll(SaveArg<1>(&offers3),
+                    Trigger(&resourceOffersCall3)))
+    .WillRepeatedly(Return());
+
+  driver2.start();
+
+  WAIT_UNTIL(registeredCall2);
+
+  // The task finishes right away, leaving just its executor running.
+  TaskDescription task;
+  task.set_name("");
+  task.mutable_task_id()->set_value("1");
+  task.mutable_slave_id()->MergeFrom(offers1[0].slave_id());
+  task.mutable_resources()->MergeFrom(Resources::parse("cpus:1;mem:512"));
+  task.mutable_executor()->mutable_executor_id()->MergeFrom(executorId);
+  task.mutable_executor()->set_uri("noexecutor");
+  task.mutable_executor()->mutable_resources()->MergeFrom(
+      Resources::parse("cpus:1;mem:512"));
+
+  vector<TaskDescription> tasks;
+  tasks.push_back(task);
+
+  driver1.launchTasks(offers1[0].id(), tasks);
+
+  WAIT_UNTIL(statusUpdateCall);
+
+  EXPECT_EQ(TASK_FINISHED, status.state());
+
+  // The task's resources go to the second framework (which holds on
+  // to them), so the slave has nothing left to offer.
+  WAIT_UNTIL(resourceOffersCall2);
+
+  ASSERT_NE(0, offers2.size());
+  EXPECT_EQ(Resources::parse("cpus:1;mem:512"),
+            Resources(offers2[0].resources()));
+
+  driver1.stop();
+  driver1.join();
+
+  WAIT_UNTIL(shutdownCall); // To ensure can deallocate MockExecutor.
+
+  // Removing the first framework frees the resources of its executor.
+  WAIT_UNTIL(resourceOffersCall3);
+
+  ASSERT_NE(0, offers3.size());
+  EXPECT_EQ(Resources::parse("cpus:1;mem:512"),
+            Resources(offers3[0].resources()));
+
+  driver2.stop();
+  driver2.join();
+
+  process::terminate(slave);
+  process::wait(slave);
+
+  process::terminate(master);
+  process::wait(master);
+}
+
+
+TEST(MasterTest, ObservedUsage)
+{
+  SlaveInfo info;
+  info.set_hostname("localhost");
+  info.set_webui_hostname("localhost");
+
+  SlaveID slaveId;
+  slaveId.set_value("slave");
+
+  mesos::internal::master::Slave slave(info, slaveId, process::UPID(), 0);
+
+  FrameworkID frameworkId;
+  frameworkId.set_value("framework");
+
+  ExecutorInfo executorInfo;
+  executorInfo.mutable_executor_id()->set_value("executor");
+  executorInfo.set_uri("noexecutor");
+
+  slave.addExecutor(frameworkId, executorInfo);
+
+  UsageMessage usage;
+  usage.mutable_slave_id()->MergeFrom(slaveId);
+  usage.mutable_framework_id()->MergeFrom(frameworkId);
+  usage.mutable_executor_id()->MergeFrom(executorInfo.executor_id());
+  usage.set_timestamp(100);
+
+  Resources resources = Resources::parse("cpus:2;mem:1024;ports:[1-2]");
+  usage.mutable_resources()->MergeFrom(resources);
+  slave.addUsageMessage(usage);
+
+  // Later usage replaces earlier usage, and only well-known scalars
+  // are kept.
+  resources = Resources::parse("cpus:1;mem:512;ports:[1-2]");
+  usage.mutable_resources()->Clear();
+  usage.mutable_resources()->MergeFrom(resources);
+  slave.addUsageMessage(usage);
+
+  Resources observed = slave.resourcesObservedUsed.resources();
+  EXPECT_EQ(1.0, observed.get("cpus", Value::Scalar()).value());
+  EXPECT_EQ(512.0, observed.get("mem", Value::Scalar()).value());
+  EXPECT_FALSE(observed.get(Resources::parse("ports", "[1-2]")).isSome());
+
+  slave.removeExecutor(frameworkId, executorInfo.executor_id());
+
+  EXPECT_EQ(0u, slave.resourcesObservedUsed.resources().size());
+}
+
+
+TEST(MasterTest, EstimatedPeakUsage)
+{
+  using mesos::internal::master::ObservedUsage;
+
+  UsageMessage usage;
+  usage.mutable_slave_id()->set_value("slave");
+  usage.mutable_framework_id()->set_value("framework");
+  usage.mutable_executor_id()->set_value("executor");
+  usage.set_timestamp(100);
+
+  // Nothing to go by without a duration or history.
+  ObservedUsage peak;
+  EXPECT_FALSE(mesos::internal::master::Slave::estimatePeak(usage, &peak));
+
+  // Cpu seconds over the duration, and bytes in megabytes.
+  usage.mutable_resources()->MergeFrom(
+      Resources::parse("cpus:3;mem:" + utils::stringify(64 * 1048576)));
+  usage.set_duration(2);
+  ASSERT_TRUE(mesos::internal::master::Slave::estimatePeak(usage, &peak));
+  EXPECT_EQ(1.5, peak.values[ObservedUsage::CPUS]);
+  EXPECT_EQ(64.0, peak.values[ObservedUsage::MEM]);
+
+  // The longest window with samples wins over the latest usage.
+  UsageWindow* window = usage.add_history();
+  window->set_duration(10);
+  window->set_samples(10);
+  window->set_cpus_p95(0.5);
+  window->set_mem_p95(32 * 1048576);
+
+  window = usage.add_history();
+  window->set_duration(300);
+  window->set_samples(0);
+
+  ASSERT_TRUE(mesos::internal::master::Slave::estimatePeak(usage, &peak));
+  EXPECT_EQ(0.5, peak.values[ObservedUsage::CPUS]);
+  EXPECT_EQ(32.0, peak.values[ObservedUsage::MEM]);
+}
+
+
+TEST(MasterTest, KeepsPeakFromHistory)
+{
+  using mesos::internal::master::ObservedUsage;
+
+  SlaveInfo info;
+  info.set_hostname("localhost");
+  info.set_webui_hostname("localhost");
+
+  SlaveID slaveId;
+  slaveId.set_value("slave");
+
+  mesos::internal::master::Slave slave(info, slaveId, process::UPID(), 0);
+
+  FrameworkID frameworkId;
+  frameworkId.set_value("framework");
+
+  ExecutorInfo executorInfo;
+  executorInfo.mutable_executor_id()->set_value("executor");
+  executorInfo.set_uri("noexecutor");
+
+  slave.addExecutor(frameworkId, executorInfo);
+
+  // A full report, with the history.
+  UsageMessage usage;
+  usage.mutable_slave_id()->MergeFrom(slaveId);
+  usage.mutable_framework_id()->MergeFrom(frameworkId);
+  usage.mutable_executor_id()->MergeFrom(executorInfo.executor_id());
+  usage.set_timestamp(100);
+  usage.set_duration(1);
+  usage.mutable_resources()->MergeFrom(Resources::parse("cpus:1;mem:0"));
+
+  UsageWindow* window = usage.add_history();
+  window->set_duration(300);
+  window->set_samples(300);
+  window->set_cpus_p95(2);
+  window->set_mem_p95(0);
+
+  slave.addUsageMessage(usage);
+  EXPECT_EQ(2.0, slave.resourcesObservedPeak.values[ObservedUsage::CPUS]);
+
+  // Changed usage comes without the history, and the peak holds.
+  usage.clear_history();
+  usage.mutable_resources()->Clear();
+  usage.mutable_resources()->MergeFrom(Resources::parse("cpus:3;mem:0"));
+  slave.addUsageMessage(usage);
+
+  EXPECT_EQ(3.0, slave.resourcesObservedUsed.values[ObservedUsage::CPUS]);
+  EXPECT_EQ(2.0, slave.resourcesObservedPeak.values[ObservedUsage::CPUS]);
+}
+
+
+// SimpleAllocator test cases.
+
+// Returns a task with the given id and resources on the slave of an
+// offer, to run on the executor of its framework.
+static TaskDescription createTask(const string& id,
+                                  const Offer& offer,
+                                  const string& resources)
+{
+  TaskDescription task;
+  task.set_name("");
+  task.mutable_task_id()->set_value(id);
+  task.mutable_slave_id()->MergeFrom(offer.slave_id());
+  task.mutable_resources()->MergeFrom(Resources::parse(resources));
+  return task;
+}
+
+
+// This fixture starts a master with a slave (of cpus:3;mem:768) that
+// two frameworks use up: framework A runs a task of cpus:1;mem:256 and
+// framework B one of cpus:2;mem:512. Tests start more slaves to see
+// which framework gets offered them first.
+class SimpleAllocatorTest : public ::testing::Test
+{
+protected:
+  SimpleAllocatorTest()
+    : allocator(NULL), m(NULL), driverA(NULL), driverB(NULL),
+      execDriverA(NULL), execDriverB(NULL) {}
+
+  void start(const Configuration& conf)
+  {
+    ASSERT_TRUE(GTEST_IS_THREADSAFE);
+
+    allocator = new SimpleAllocator(conf);
+    m = new Master(allocator);
+    master = process::spawn(m);
+
+    executorIdA.set_value("executor-a");
+    executorIdB.set_value("executor-b");
+
+    EXPECT_CALL(execA, registered(_, _, _, _, _, _))
+      .Times(1);
+
+    EXPECT_CALL(execA, launchTask(_, _))
+      .WillOnce(DoAll(SaveArg<0>(&execDriverA),
+                      SendStatusUpdate(TASK_RUNNING)));
+
+    EXPECT_CALL(execA, shutdown(_))
+      .WillOnce(Trigger(&shutdownCallA));
+
+    EXPECT_CALL(execB, registered(_, _, _, _, _, _))
+      .Times(1);
+
+    EXPECT_CALL(execB, launchTask(_, _))
+      .WillOnce(DoAll(SaveArg<0>(&execDriverB),
+                      SendStatusUpdate(TASK_RUNNING)));
+
+    EXPECT_CALL(execB, shutdown(_))
+      .WillOnce(Trigger(&shutdownCallB));
+
+    map<ExecutorID, Executor*> execs;
+    execs[executorIdA] = &execA;
+    execs[executorIdB] = &execB;
+
+    startSlave(Resources::parse("cpus:3;mem:768"), execs);
+
+    driverA = new MesosSchedulerDriver(
+        &schedA, "", CREATE_EXECUTOR_INFO(executorIdA, "noexecutor"), master);
+
+    driverB = new MesosSchedulerDriver(
+        &schedB, "", CREATE_EXECUTOR_INFO(executorIdB, "noexecutor"), master);
+
+    vector<Offer> offersA, offersB;
+
+    trigger registeredCallB, resourceOffersCallA, resourceOffersCallB;
+    trigger statusUpdateCallA, statusUpdateCallB;
+
+    EXPECT_CALL(schedA, registered(driverA, _))
+      .WillOnce(SaveArg<1>(&frameworkIdA));
+
+    EXPECT_CALL(schedB, registered(driverB, _))
+      .WillOnce(DoAll(SaveArg<1>(&frameworkIdB),
+                      Trigger(&registeredCallB)));
+
+    expectOffer(&schedA, driverA, &offersA, &resourceOffersCallA);
+    expectOffer(&schedB, driverB, &offersB, &resourceOffersCallB);
+
+    EXPECT_CALL(schedA, statusUpdate(driverA, _))
+      .WillOnce(Trigger(&statusUpdateCallA))
+      .WillRepeatedly(Return());
+
+    EXPECT_CALL(schedB, statusUpdate(driverB, _))
+      .WillOnce(Trigger(&statusUpdateCallB))
+      .WillRepeatedly(Return());
+
+    driverA->start();
+
+    WAIT_UNTIL(resourceOffersCallA);
+
+    ASSERT_EQ(1u, offersA.size());
+    slaveId = offersA[0].slave_id();
+
+    // B registers while A holds the whole slave.
+    driverB->start();
+
+    WAIT_UNTIL(registeredCallB);
+
+    // A leaves the rest of the slave unused, which goes to B.
+    vector<TaskDescription> tasks;
+    tasks.push_back(createTask("a", offersA[0], "cpus:1;mem:256"));
+    driverA->launchTasks(offersA[0].id(), tasks);
+
+    WAIT_UNTIL(resourceOffersCallB);
+
+    ASSERT_EQ(1u, offersB.size());
+    EXPECT_EQ(Resources::parse("cpus:2;mem:512"),
+              Resources(offersB[0].resources()));
+
+    tasks.clear();
+    tasks.push_back(createTask("b", offersB[0], "cpus:2;mem:512"));
+    driverB->launchTasks(offersB[0].id(), tasks);
+
+    WAIT_UNTIL(statusUpdateCallA);
+    WAIT_UNTIL(statusUpdateCallB);
+  }
+
+  virtual void TearDown()
+  {
+    if (m == NULL) {
+      return;
+    }
+
+    if (driverA != NULL) {
+      driverA->stop();
+      driverA->join();
+      delete driverA;
+    }
+
+    if (driverB != NULL) {
+      driverB->stop();
+      driverB->join();
+      delete driverB;
+    }
+
+    // To ensure can deallocate the MockExecutors.
+    if (execDriverA != NULL) {
+      WAIT_UNTIL(shutdownCallA);
+    }
+
+    if (execDriverB != NULL) {
+      WAIT_UNTIL(shutdownCallB);
+    }
+
+    foreach (const PID<Slave>& slave, slaves) {
+      process::terminate(slave);
+      process::wait(slave);
+    }
+
+    process::terminate(master);
+    process::wait(master);
+
+    foreach (BasicMasterDetector* detector, detectors) {
+      delete detector;
+    }
+
+    foreach (Slave* s, slaveProcesses) {
+      delete s;
+    }
+
+    foreach (TestingIsolationModule* isolationModule, isolationModules) {
+      delete isolationModule;
+    }
+
+    delete m;
+    delete allocator;
+  }
+
+  // Starts a slave that runs the given executors.
+  void startSlave(const Resources& resources,
+                  const map<ExecutorID, Executor*>& execs)
+  {
+    TestingIsolationModule* isolationModule = new TestingIsolationModule(execs);
+    Slave* s = new Slave(resources, true, isolationModule);
+    PID<Slave> slave = process::spawn(s);
+
+    isolationModules.push_back(isolationModule);
+    slaveProcesses.push_back(s);
+    slaves.push_back(slave);
+    detectors.push_back(new BasicMasterDetector(master, slave, true));
+  }
+
+  // Starts a slave that runs no executors.
+  void startSlave(const Resources& resources)
+  {
+    startSlave(resources, map<ExecutorID, Executor*>());
+  }
+
+  // Saves the next offer made to a framework.
+  void expectOffer(MockScheduler* sched,
+                   MesosSchedulerDriver* driver,
+                   vector<Offer>* offers,
+                   trigger* resourceOffersCall)
+  {
+    EXPECT_CALL(*sched, resourceOffers(driver, _))
+      .WillOnce(DoAll(SaveArg<1>(offers),
+                      Trigger(resourceOffersCall)))
+      .WillRepeatedly(Return());
+  }
+
+  // Reports that an executor on the first slave used the given cpus
+  // over the last second, and the given megabytes of memory.
+  void sendUsage(const FrameworkID& frameworkId,
+                 const ExecutorID& executorId,
+                 double cpus,
+                 int mem)
+  {
+    UsageMessage usage;
+    usage.mutable_slave_id()->MergeFrom(slaveId);
+    usage.mutable_framework_id()->MergeFrom(frameworkId);
+    usage.mutable_executor_id()->MergeFrom(executorId);
+    usage.mutable_resources()->MergeFrom(
+        Resources::parse("cpus:" + utils::stringify(cpus) +
+                         ";mem:" + utils::stringify(mem * 1048576)));
+    usage.set_timestamp(Clock::now());
+    usage.set_duration(1);
+
+    process::dispatch(master, &Master::updateUsage, usage);
+  }
+
+  SimpleAllocator* allocator;
+  Master* m;
+  PID<Master> master;
+
+  vector<TestingIsolationModule*> isolationModules;
+  vector<Slave*> slaveProcesses;
+  vector<PID<Slave> > slaves;
+  vector<BasicMasterDetector*> detectors;
+
+  SlaveID slaveId; // Of the first slave.
+
+  MockScheduler schedA, schedB;
+  MesosSchedulerDriver* driverA;
+  MesosSchedulerDriver* driverB;
+  FrameworkID frameworkIdA, frameworkIdB;
+
+  MockExecutor execA, execB;
+  ExecutorID executorIdA, executorIdB;
+  ExecutorDriver* execDriverA;
+  ExecutorDriver* execDriverB;
+  trigger shutdownCallA, shutdownCallB;
+};
+
+
+TEST_F(SimpleAllocatorTest, OrdersByAllocationWithoutUsageWeight)
+{
+  Configuration conf;
+  conf.set("allocation_interval", 0);
+  start(conf);
+
+  // A uses a lot more than B, but only allocations count.
+  sendUsage(frameworkIdA, executorIdA, 3, 256);
+  sendUsage(frameworkIdB, executorIdB, 0.1, 32);
+
+  vector<Offer> offersA, offersB;
+  trigger resourceOffersCallA, resourceOffersCallB;
+
+  expectOffer(&schedA, driverA, &offersA, &resourceOffersCallA);
+  expectOffer(&schedB, driverB, &offersB, &resourceOffersCallB);
+
+  // A has the smaller allocation, so it gets offered the new slave.
+  startSlave(Resources::parse("cpus:2;mem:512"));
+
+  WAIT_UNTIL(resourceOffersCallA);
+
+  ASSERT_EQ(1u, offersA.size());
+  EXPECT_NE(slaveId.value(), offersA[0].slave_id().value());
+  EXPECT_EQ(Resources::parse("cpus:2;mem:512"),
+            Resources(offersA[0].resources()));
+  EXPECT_FALSE(resourceOffersCallB.value);
+}
+
+
+TEST_F(SimpleAllocatorTest, OrdersByObservedUsageWithUsageWeight)
+{
+  Configuration conf;
+  conf.set("allocation_interval", 0);
+  conf.set("drf_usage_weight", 0.5);
+  start(conf);
+
+  // With the new slave the allocated shares are 0.2 for A and 0.4 for
+  // B, the observed shares 0.6 for A and 0.025 for B, which puts B
+  // first (0.2125 against 0.4).
+  sendUsage(frameworkIdA, executorIdA, 3, 256);
+  sendUsage(frameworkIdB, executorIdB, 0.1, 32);
+
+  vector<Offer> offersA, offersB;
+  trigger resourceOffersCallA, resourceOffersCallB;
+
+  expectOffer(&schedA, driverA, &offersA, &resourceOffersCallA);
+  expectOffer(&schedB, driverB, &offersB, &resourceOffersCallB);
+
+  startSlave(Resources::parse("cpus:2;mem:512"));
+
+  WAIT_UNTIL(resourceOffersCallB);
+
+  ASSERT_EQ(1u, offersB.size());
+  EXPECT_NE(slaveId.value(), offersB[0].slave_id().value());
+  EXPECT_EQ(Resources::parse("cpus:2;mem:512"),
+            Resources(offersB[0].resources()));
+  EXPECT_FALSE(resourceOffersCallA.value);
+}
+
+
+TEST_F(SimpleAllocatorTest, OffersSlackAsRevocable)
+{
+  Configuration conf;
+  conf.set("allocation_interval", 0);
+  conf.set("oversubscribe", true);
+  conf.set("oversubscription_margin", 0.5);
+  start(conf);
+
+  vector<Offer> offersA, offersB;
+  trigger resourceOffersCallA, resourceOffersCallB;
+
+  expectOffer(&schedA, driverA, &offersA, &resourceOffersCallA);
+  expectOffer(&schedB, driverB, &offersB, &resourceOffersCallB);
+
+  // Nothing is revocable until all of the executors reported usage.
+  sendUsage(frameworkIdA, executorIdA, 0.5, 128);
+  process::dispatch(master, &Master::timerTick);
+
+  // The estimated peak of the slave is then 1 cpu and 256 megabytes,
+  // or 1.5 cpus and 384 megabytes with the margin, out of the cpus:3;
+  // mem:768 that are in use. A left resources unused on the slave
+  // when it launched its task, so the slack goes to B.
+  sendUsage(frameworkIdB, executorIdB, 0.5, 128);
+  process::dispatch(master, &Master::timerTick);
+
+  WAIT_UNTIL(resourceOffersCallB);
+
+  ASSERT_EQ(1u, offersB.size());
+  EXPECT_EQ(slaveId.value(), offersB[0].slave_id().value());
+  EXPECT_TRUE(offersB[0].revocable());
+  EXPECT_EQ(Resources::parse("cpus:1.5;mem:384"),
+            Resources(offersB[0].resources()));
+  EXPECT_FALSE(resourceOffersCallA.value);
+}
+
+
+TEST_F(SimpleAllocatorTest, ResortsFrameworkWhoseUsageChanged)
+{
+  Configuration conf;
+  conf.set("allocation_interval", 0);
+  conf.set("drf_usage_weight", 1);
+  start(conf);
+
+  sendUsage(frameworkIdA, executorIdA, 3, 256);
+  sendUsage(frameworkIdB, executorIdB, 0.1, 32);
+
+  vector<Offer> offersA, offersB;
+  trigger resourceOffersCallA, resourceOffersCallB;
+
+  expectOffer(&schedA, driverA, &offersA, &resourceOffersCallA);
+  expectOffer(&schedB, driverB, &offersB, &resourceOffersCallB);
+
+  startSlave(Resources::parse("cpus:2;mem:512"));
+
+  WAIT_UNTIL(resourceOffersCallB);
+
+  ASSERT_EQ(1u, offersB.size());
+  EXPECT_FALSE(resourceOffersCallA.value);
+
+  // Now B uses a lot more than A, so A must be offered the next slave
+  // (B holds on to its offer, which does not count with this weight).
+  sendUsage(frameworkIdA, executorIdA, 0.1, 32);
+  sendUsage(frameworkIdB, executorIdB, 3, 512);
+
+  trigger resourceOffersCallB2;
+  expectOffer(&schedB, driverB, &offersB, &resourceOffersCallB2);
+
+  startSlave(Resources::parse("cpus:2;mem:512"));
+
+  WAIT_UNTIL(resourceOffersCallA);
+
+  ASSERT_EQ(1u, offersA.size());
+  EXPECT_NE(slaveId.value(), offersA[0].slave_id().value());
+  EXPECT_NE(offersB[0].slave_id().value(), offersA[0].slave_id().value());
+  EXPECT_FALSE(resourceOffersCallB2.value);
+}
+
+
+TEST_F(SimpleAllocatorTest, ResortsFrameworkWhoseTaskFinished)
+{
+  Configuration conf;
+  conf.set("allocation_interval", 0);
+  start(conf);
+
+  vector<Offer> offersA, offersB;
+  trigger resourceOffersCallA, resourceOffersCallB;
+
+  expectOffer(&schedA, driverA, &offersA, &resourceOffersCallA);
+  expectOffer(&schedB, driverB, &offersB, &resourceOffersCallB);
+
+  // B gets its resources back, which leaves it with nothing allocated
+  // (down from two thirds of the slave, ahead of A's third), so it must
+  // be offered them first.
+  TaskStatus status;
+  status.mutable_task_id()->set_value("b");
+  status.set_state(TASK_FINISHED);
+  execDriverB->sendStatusUpdate(status);
+
+  WAIT_UNTIL(resourceOffersCallB);
+
+  ASSERT_EQ(1u, offersB.size());
+  EXPECT_EQ(slaveId.value(), offersB[0].slave_id().value());
+  EXPECT_EQ(Resources::parse("cpus:2;mem:512"),
+            Resources(offersB[0].resources()));
+  EXPECT_FALSE(resourceOffersCallA.value);
+}
+
+
+// Returns one of the statistics of an allocator.
+static double getStat(SimpleAllocator* allocator, const string& name)
+{
+  JSON::Object object;
+  allocator->getStats(&object);
+  return boost::get<JSON::Number>(object.values[name]).value;
+}
+
+
+TEST_F(SimpleAllocatorTest, BatchesEventsWithinAllocationInterval)
+{
+  Clock::pause();
+
+  Configuration conf;
+  conf.set("allocation_interval", 0.5);
+
+  allocator = new SimpleAllocator(conf);
+  m = new Master(allocator);
+  master = process::spawn(m);
+
+  // An event long enough after the last allocation gets allocated for
+  // right away (the timer ticks of the master itself are a second
+  // apart, more than this test advances the clock).
+  process::dispatch(master, &Master::timerTick);
+  Clock::settle();
+
+  EXPECT_EQ(1, getStat(allocator, "allocation_events"));
+  EXPECT_EQ(1, getStat(allocator, "allocations"));
+
+  // The events within the allocation interval get one allocation at
+  // its end.
+  process::dispatch(master, &Master::timerTick);
+  process::dispatch(master, &Master::timerTick);
+  process::dispatch(master, &Master::timerTick);
+  Clock::settle();
+
+  EXPECT_EQ(4, getStat(allocator, "allocation_events"));
+  EXPECT_EQ(1, getStat(allocator, "allocations"));
+
+  Clock::advance(0.25);
+  Clock::settle();
+
+  EXPECT_EQ(1, getStat(allocator, "allocations"));
+
+  Clock::advance(0.25);
+  Clock::settle();
+
+  EXPECT_EQ(4, getStat(allocator, "allocation_events"));
+  EXPECT_EQ(2, getStat(allocator, "allocations"));
+  EXPECT_NEAR(0.5, getStat(allocator, "allocation_max_latency_secs"), 0.001);
+  EXPECT_NEAR(0.5, getStat(allocator, "allocation_latency_secs"), 0.001);
+
+  Clock::resume();
+}
+
+
 // FrameworksManager test cases.
 
 class MockFrameworksStorage : public FrameworksStorage
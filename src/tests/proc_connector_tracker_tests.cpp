@@ -0,0 +1,293 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <signal.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <linux/cn_proc.h>
+
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include <algorithm>
+#include <list>
+#include <string>
+
+#include "common/seconds.hpp"
+#include "common/try.hpp"
+
+#include "monitoring/linux/proc_connector_tracker.hpp"
+#include "monitoring/linux/proc_resource_collector.hpp"
+#include "monitoring/linux/proc_snapshot.hpp"
+
+#include "monitoring/resource_collector.hpp"
+
+using std::list;
+using std::string;
+
+namespace mesos {
+namespace internal {
+namespace monitoring {
+
+static ProcessStats makeProcess(pid_t pid, pid_t ppid, pid_t sid)
+{
+  return ProcessStats(pid, ppid, pid, sid, seconds(1), seconds(0), 1024);
+}
+
+
+static bool contains(const list<pid_t>& pids, pid_t pid)
+{
+  return std::find(pids.begin(), pids.end(), pid) != pids.end();
+}
+
+
+static proc_event forkEvent(pid_t parent, pid_t child, pid_t thread)
+{
+  proc_event event;
+  memset(&event, 0, sizeof(event));
+  event.what = proc_event::PROC_EVENT_FORK;
+  event.event_data.fork.parent_pid = parent;
+  event.event_data.fork.parent_tgid = parent;
+  event.event_data.fork.child_pid = thread;
+  event.event_data.fork.child_tgid = child;
+  return event;
+}
+
+
+static proc_event forkEvent(pid_t parent, pid_t child)
+{
+  return forkEvent(parent, child, child);
+}
+
+
+// A snapshotter with an executor (100) that has a child (101), next to
+// an unrelated process (200), and another executor (300) that gets
+// started after the first scan if 'late' is set.
+class FakeSnapshotter : public ProcSnapshotter
+{
+public:
+  FakeSnapshotter(bool _late = false)
+    : ProcSnapshotter(1.0), scans(0), late(_late) {}
+
+  int scans;
+  bool late;
+
+protected:
+  virtual Try<ProcSnapshot*> scan(uint64_t generation)
+  {
+    scans++;
+    ProcSnapshot* snapshot = new ProcSnapshot(generation);
+    snapshot->add(makeProcess(1, 0, 1));
+    snapshot->add(makeProcess(100, 1, 100));
+    snapshot->add(makeProcess(101, 100, 100));
+    snapshot->add(makeProcess(200, 1, 200));
+    if (late && scans > 1) {
+      snapshot->add(makeProcess(300, 1, 300));
+    }
+    return snapshot;
+  }
+};
+
+
+TEST(ProcConnectorTrackerTest, SeedsFromSnapshot)
+{
+  FakeSnapshotter snapshotter;
+  ProcConnectorTracker tracker;
+
+  EXPECT_FALSE(tracker.isTracking(100));
+
+  ASSERT_TRUE(tracker.track(100, &snapshotter).isSome());
+  EXPECT_EQ(1, snapshotter.scans);
+
+  EXPECT_TRUE(tracker.isTracking(100));
+
+  list<pid_t> members = tracker.getMembers(100);
+  ASSERT_EQ(2u, members.size());
+  EXPECT_EQ(100, members.front());
+  EXPECT_EQ(101, members.back());
+
+  // Tracking again shares the snapshot.
+  ASSERT_TRUE(tracker.track(100, &snapshotter).isSome());
+  EXPECT_EQ(1, snapshotter.scans);
+  EXPECT_EQ(2u, tracker.getMembers(100).size());
+
+  // A root that is not in the snapshot gets another scan.
+  EXPECT_TRUE(tracker.track(300, &snapshotter).isError());
+  EXPECT_EQ(2, snapshotter.scans);
+  EXPECT_FALSE(tracker.isTracking(300));
+}
+
+
+TEST(ProcConnectorTrackerTest, TracksRootStartedAfterSnapshot)
+{
+  FakeSnapshotter snapshotter(true);
+  ProcConnectorTracker tracker;
+  ASSERT_TRUE(tracker.track(100, &snapshotter).isSome());
+
+  // Executor 300 gets started, and 100 forks before 300 gets tracked.
+  tracker.process(forkEvent(1, 300));
+  tracker.process(forkEvent(100, 102));
+
+  ASSERT_TRUE(tracker.track(300, &snapshotter).isSome());
+  EXPECT_EQ(2, snapshotter.scans);
+  EXPECT_TRUE(tracker.isTracking(300));
+  EXPECT_EQ(1u, tracker.getMembers(300).size());
+
+  // The tree of 100 is untouched.
+  list<pid_t> members = tracker.getMembers(100);
+  ASSERT_EQ(3u, members.size());
+  EXPECT_TRUE(contains(members, 102));
+
+  // Later trees share the new snapshot.
+  ASSERT_TRUE(tracker.track(200, &snapshotter).isSome());
+  EXPECT_EQ(2, snapshotter.scans);
+}
+
+
+TEST(ProcConnectorTrackerTest, CatchesUpWithForksSinceSnapshot)
+{
+  FakeSnapshotter snapshotter;
+  ProcConnectorTracker tracker;
+  ASSERT_TRUE(tracker.track(100, &snapshotter).isSome());
+
+  // Process 200 forks before it gets tracked, and 101 is gone and its
+  // pid handed to a child of 200.
+  tracker.process(forkEvent(200, 201));
+  tracker.process(forkEvent(200, 101));
+
+  ASSERT_TRUE(tracker.track(200, &snapshotter).isSome());
+  EXPECT_EQ(1, snapshotter.scans);
+
+  list<pid_t> members = tracker.getMembers(200);
+  ASSERT_EQ(3u, members.size());
+  EXPECT_TRUE(contains(members, 201));
+  EXPECT_TRUE(contains(members, 101));
+
+  // Seeding 100 again from the snapshot must not take 101 back.
+  ASSERT_TRUE(tracker.track(100, &snapshotter).isSome());
+  EXPECT_EQ(1u, tracker.getMembers(100).size());
+  EXPECT_TRUE(contains(tracker.getMembers(200), 101));
+}
+
+
+TEST(ProcConnectorTrackerTest, FollowsForks)
+{
+  FakeSnapshotter snapshotter;
+  ProcConnectorTracker tracker;
+  ASSERT_TRUE(tracker.track(100, &snapshotter).isSome());
+
+  tracker.process(forkEvent(101, 102)); // Grandchild.
+  tracker.process(forkEvent(102, 102, 103)); // A thread, not a process.
+  tracker.process(forkEvent(200, 201)); // Outside of the tree.
+
+  list<pid_t> members = tracker.getMembers(100);
+  ASSERT_EQ(3u, members.size());
+  EXPECT_EQ(100, members.front());
+  EXPECT_TRUE(contains(members, 102));
+  EXPECT_FALSE(contains(members, 103));
+  EXPECT_FALSE(contains(members, 201));
+
+  // Exiting does not drop a process, only failing to read it does.
+  proc_event event;
+  memset(&event, 0, sizeof(event));
+  event.what = proc_event::PROC_EVENT_EXIT;
+  event.event_data.exit.process_pid = 102;
+  event.event_data.exit.process_tgid = 102;
+  tracker.process(event);
+  EXPECT_EQ(3u, tracker.getMembers(100).size());
+
+  tracker.remove(102);
+  EXPECT_EQ(2u, tracker.getMembers(100).size());
+}
+
+
+TEST(ProcConnectorTrackerTest, ReusedPids)
+{
+  FakeSnapshotter snapshotter;
+  ProcConnectorTracker tracker;
+  ASSERT_TRUE(tracker.track(100, &snapshotter).isSome());
+
+  // Process 101 is gone and its pid is handed to a child of 200.
+  tracker.process(forkEvent(200, 101));
+
+  list<pid_t> members = tracker.getMembers(100);
+  ASSERT_EQ(1u, members.size());
+  EXPECT_EQ(100, members.front());
+
+  // A child of the new 101 is not part of the tree either.
+  tracker.process(forkEvent(101, 102));
+  EXPECT_EQ(1u, tracker.getMembers(100).size());
+}
+
+
+TEST(ProcConnectorTrackerTest, Untrack)
+{
+  FakeSnapshotter snapshotter;
+  ProcConnectorTracker tracker;
+  ASSERT_TRUE(tracker.track(100, &snapshotter).isSome());
+
+  tracker.untrack(100);
+  EXPECT_FALSE(tracker.isTracking(100));
+  EXPECT_TRUE(tracker.getMembers(100).empty());
+
+  // Forks of former members are ignored.
+  tracker.process(forkEvent(101, 102));
+  EXPECT_TRUE(tracker.getMembers(100).empty());
+}
+
+
+// Feeds the events the kernel would publish by hand, so that this runs
+// without the privileges needed to subscribe to the proc connector.
+TEST(ProcConnectorTrackerTest, CollectsTrackedProcesses)
+{
+  ProcSnapshotter snapshotter(0);
+  ProcConnectorTracker tracker;
+  ProcResourceCollector collector(getpid(), &snapshotter, &tracker);
+
+  UsageRecord usage;
+  string error;
+  ASSERT_TRUE(collector.collect(&usage, &error)) << error;
+  ASSERT_TRUE(tracker.isTracking(getpid()));
+
+  pid_t pid = fork();
+  ASSERT_NE(-1, pid);
+
+  if (pid == 0) {
+    pause();
+    _exit(0);
+  }
+
+  tracker.process(forkEvent(getpid(), pid));
+
+  ASSERT_TRUE(collector.collect(&usage, &error)) << error;
+  EXPECT_TRUE(contains(tracker.getMembers(getpid()), pid));
+
+  kill(pid, SIGKILL);
+  waitpid(pid, NULL, 0);
+
+  // The reaped child gets dropped once its stats can not be read.
+  ASSERT_TRUE(collector.collect(&usage, &error)) << error;
+  EXPECT_FALSE(contains(tracker.getMembers(getpid()), pid));
+}
+
+} // namespace monitoring {
+} // namespace internal {
+} // namespace mesos {
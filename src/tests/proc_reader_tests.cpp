@@ -0,0 +1,159 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include "monitoring/linux/proc_reader.hpp"
+#include "monitoring/linux/proc_utils.hpp"
+
+namespace mesos {
+namespace internal {
+namespace monitoring {
+
+TEST(ProcReaderTest, ReusesDescriptors)
+{
+  ProcReader reader;
+
+  ProcStat stat;
+  ASSERT_TRUE(reader.readStat(getpid(), &stat));
+  EXPECT_EQ(getpid(), stat.pid);
+  EXPECT_EQ(1u, reader.size());
+
+  ASSERT_TRUE(reader.readStat(getpid(), &stat));
+  EXPECT_EQ(getpid(), stat.pid);
+  EXPECT_EQ(1u, reader.size());
+
+  ProcStatm statm;
+  ASSERT_TRUE(reader.readStatm(getpid(), &statm));
+  EXPECT_GT(statm.resident, 0u);
+
+  // Reading statm a second time goes through the same descriptor.
+  ASSERT_TRUE(reader.readStatm(getpid(), &statm));
+  EXPECT_GT(statm.resident, 0u);
+
+  ProcStatus status;
+  ASSERT_TRUE(reader.readStatus(getpid(), &status));
+  EXPECT_GT(status.voluntaryCtxtSwitches + status.nonvoluntaryCtxtSwitches,
+            0u);
+}
+
+
+TEST(ProcReaderTest, EvictsExitedProcesses)
+{
+  pid_t pid = fork();
+  ASSERT_NE(-1, pid);
+
+  if (pid == 0) {
+    pause();
+    _exit(0);
+  }
+
+  ProcReader reader;
+
+  ProcStat stat;
+  ASSERT_TRUE(reader.readStat(pid, &stat));
+  EXPECT_EQ(pid, stat.pid);
+  EXPECT_EQ(1u, reader.size());
+
+  kill(pid, SIGKILL);
+  waitpid(pid, NULL, 0);
+
+  // The cached descriptor now refers to a reaped process.
+  EXPECT_FALSE(reader.readStat(pid, &stat));
+  EXPECT_EQ(0u, reader.size());
+}
+
+
+TEST(ProcReaderTest, CachesWithoutReadingStat)
+{
+  pid_t pid = fork();
+  ASSERT_NE(-1, pid);
+
+  if (pid == 0) {
+    pause();
+    _exit(0);
+  }
+
+  ProcReader reader;
+
+  ProcStatus status;
+  ASSERT_TRUE(reader.readStatus(pid, &status));
+  EXPECT_EQ(1u, reader.size());
+
+  ProcStat stat;
+  ASSERT_TRUE(reader.readStat(pid, &stat));
+  EXPECT_EQ(pid, stat.pid);
+  EXPECT_EQ(1u, reader.size());
+
+  kill(pid, SIGKILL);
+  waitpid(pid, NULL, 0);
+
+  // The cached descriptor fails rather than reading another process.
+  EXPECT_FALSE(reader.readStatus(pid, &status));
+
+  // Reading does not keep the reaped process cached past a sweep.
+  reader.sweep();
+  reader.sweep();
+  EXPECT_EQ(0u, reader.size());
+}
+
+
+TEST(ProcReaderTest, SweepClosesUnusedEntries)
+{
+  ProcReader reader;
+
+  ProcStat stat;
+  ASSERT_TRUE(reader.readStat(getpid(), &stat));
+  ASSERT_TRUE(reader.readStat(getppid(), &stat));
+  EXPECT_EQ(2u, reader.size());
+
+  // Both processes were read since the last sweep.
+  reader.sweep();
+  EXPECT_EQ(2u, reader.size());
+
+  ASSERT_TRUE(reader.readStat(getpid(), &stat));
+  reader.sweep();
+  EXPECT_EQ(1u, reader.size());
+
+  reader.sweep();
+  EXPECT_EQ(0u, reader.size());
+}
+
+
+TEST(ProcReaderTest, ReadsUncachedBeyondLimit)
+{
+  ProcReader reader(0);
+
+  ProcStat stat;
+  ASSERT_TRUE(reader.readStat(getpid(), &stat));
+  EXPECT_EQ(getpid(), stat.pid);
+  EXPECT_EQ(0u, reader.size());
+
+  ProcStatm statm;
+  EXPECT_TRUE(reader.readStatm(getpid(), &statm));
+}
+
+} // namespace monitoring {
+} // namespace internal {
+} // namespace mesos {
@@ -0,0 +1,170 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <list>
+#include <tr1/memory>
+
+#include "common/foreach.hpp"
+#include "common/hashset.hpp"
+#include "common/seconds.hpp"
+#include "common/try.hpp"
+
+#include "monitoring/linux/proc_snapshot.hpp"
+
+using std::list;
+using std::tr1::shared_ptr;
+
+namespace mesos {
+namespace internal {
+namespace monitoring {
+
+static ProcessStats makeProcess(pid_t pid, pid_t ppid, pid_t sid)
+{
+  return ProcessStats(pid, ppid, pid, sid, seconds(1), seconds(0), 1024);
+}
+
+
+static hashset<pid_t> pids(const list<ProcessStats>& processes)
+{
+  hashset<pid_t> result;
+  foreach (const ProcessStats& process, processes) {
+    result.insert(process.pid);
+  }
+  return result;
+}
+
+
+// A snapshotter that counts scans and hands out fake snapshots.
+class CountingSnapshotter : public ProcSnapshotter
+{
+public:
+  CountingSnapshotter(double maxAge) : ProcSnapshotter(maxAge), scans(0) {}
+
+  int scans;
+
+protected:
+  virtual Try<ProcSnapshot*> scan(uint64_t generation)
+  {
+    scans++;
+    ProcSnapshot* snapshot = new ProcSnapshot(generation);
+    snapshot->add(makeProcess(1, 0, 1));
+    return snapshot;
+  }
+};
+
+
+TEST(ProcSnapshotTest, ProcessTree)
+{
+  ProcSnapshot snapshot(1);
+  snapshot.add(makeProcess(1, 0, 1));      // init
+  snapshot.add(makeProcess(100, 1, 100));  // slave
+  snapshot.add(makeProcess(200, 100, 200)); // executor
+  snapshot.add(makeProcess(201, 200, 200)); // task
+  snapshot.add(makeProcess(202, 201, 200)); // task's child
+  snapshot.add(makeProcess(300, 100, 300)); // another executor
+
+  ASSERT_EQ(6u, snapshot.size());
+
+  Try<list<ProcessStats> > tree = snapshot.getProcessTree(200);
+  ASSERT_TRUE(tree.isSome());
+  EXPECT_EQ(3u, tree.get().size());
+  EXPECT_EQ(200, tree.get().front().pid);
+
+  hashset<pid_t> members = pids(tree.get());
+  EXPECT_TRUE(members.contains(201));
+  EXPECT_TRUE(members.contains(202));
+
+  // The sibling executor must not be picked up.
+  EXPECT_FALSE(members.contains(300));
+
+  EXPECT_TRUE(snapshot.getProcessTree(400).isError());
+}
+
+
+TEST(ProcSnapshotTest, ProcessTreeFollowsSessions)
+{
+  ProcSnapshot snapshot(1);
+  snapshot.add(makeProcess(1, 0, 1));       // init
+  snapshot.add(makeProcess(100, 1, 100));   // slave
+  snapshot.add(makeProcess(200, 100, 200)); // executor
+  snapshot.add(makeProcess(201, 200, 201)); // task jvm in its own session
+  snapshot.add(makeProcess(202, 1, 201));   // orphan in the jvm's session
+  snapshot.add(makeProcess(203, 1, 200));   // orphan in executor's session
+  snapshot.add(makeProcess(204, 1, 204));   // unrelated daemon
+  snapshot.add(makeProcess(300, 100, 300)); // another executor
+
+  Try<list<ProcessStats> > tree = snapshot.getProcessTree(200);
+  ASSERT_TRUE(tree.isSome());
+
+  hashset<pid_t> members = pids(tree.get());
+  EXPECT_EQ(4u, members.size());
+  EXPECT_TRUE(members.contains(200));
+  EXPECT_TRUE(members.contains(201));
+  EXPECT_TRUE(members.contains(202));
+  EXPECT_TRUE(members.contains(203));
+
+  // Neither the slave's other children nor init's are included.
+  EXPECT_FALSE(members.contains(100));
+  EXPECT_FALSE(members.contains(204));
+  EXPECT_FALSE(members.contains(300));
+}
+
+
+TEST(ProcSnapshotTest, SharesScansAcrossCollectors)
+{
+  CountingSnapshotter snapshotter(1000);
+
+  // Two collectors sampling in the same interval share one scan.
+  Try<shared_ptr<const ProcSnapshot> > first = snapshotter.snapshot(0);
+  ASSERT_TRUE(first.isSome());
+  Try<shared_ptr<const ProcSnapshot> > second = snapshotter.snapshot(0);
+  ASSERT_TRUE(second.isSome());
+
+  EXPECT_EQ(1, snapshotter.scans);
+  EXPECT_EQ(first.get()->generation, second.get()->generation);
+
+  // A collector that already used the cached snapshot triggers a scan.
+  Try<shared_ptr<const ProcSnapshot> > third =
+    snapshotter.snapshot(first.get()->generation);
+  ASSERT_TRUE(third.isSome());
+
+  EXPECT_EQ(2, snapshotter.scans);
+  EXPECT_NE(first.get()->generation, third.get()->generation);
+}
+
+
+TEST(ProcSnapshotTest, ScansProc)
+{
+  ProcSnapshotter snapshotter;
+
+  Try<shared_ptr<const ProcSnapshot> > snapshot = snapshotter.snapshot(0);
+  ASSERT_TRUE(snapshot.isSome());
+
+  Try<list<ProcessStats> > tree = snapshot.get()->getProcessTree(getpid());
+  ASSERT_TRUE(tree.isSome());
+  EXPECT_EQ(getpid(), tree.get().front().pid);
+}
+
+} // namespace monitoring {
+} // namespace internal {
+} // namespace mesos {
@@ -16,15 +16,22 @@
  * limitations under the License.
  */
 
+#include <asm/param.h>
 #include <gtest/gtest.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <sys/types.h>
 #include <unistd.h>
 
 #include <process/process.hpp>
 
 #include <algorithm>
+#include <fstream>
 #include <list>
+#include <string>
 
+#include "common/foreach.hpp"
 #include "common/seconds.hpp"
 #include "common/try.hpp"
 #include "common/utils.hpp"
@@ -33,6 +40,7 @@
 using process::Clock;
 
 using std::find;
+using std::ifstream;
 using std::string;
 using std::list;
 
@@ -100,6 +108,203 @@ TEST(ProcUtilsTest, GetAllPids)
   EXPECT_NE(find(allPids.begin(), allPids.end(), mPid), allPids.end());
 }
 
+TEST(ProcUtilsTest, ParseProcStat)
+{
+  // A comm containing spaces and parentheses must not shift the fields.
+  const char* contents =
+    "4321 (a) b (c)) S 1 4321 4320 0 -1 4202752 120 0 7 0 250 50 -3 -4 20 "
+    "0 5 0 1500 10485760 300 18446744073709551615 1 1 0 0 0 0 0 0 0 0 0 0 "
+    "17 0 0 0 0 0 0\n";
+
+  ProcStat stat;
+  ASSERT_TRUE(parseProcStat(contents, strlen(contents), &stat));
+
+  EXPECT_EQ(4321, stat.pid);
+  EXPECT_EQ(1, stat.ppid);
+  EXPECT_EQ(4321, stat.pgrp);
+  EXPECT_EQ(4320, stat.sid);
+  EXPECT_EQ(120u, stat.minflt);
+  EXPECT_EQ(7u, stat.majflt);
+  EXPECT_EQ(250u, stat.utime);
+  EXPECT_EQ(50u, stat.stime);
+  EXPECT_EQ(-3, stat.cutime);
+  EXPECT_EQ(-4, stat.cstime);
+  EXPECT_EQ(5, stat.numThreads);
+  EXPECT_EQ(1500u, stat.starttime);
+  EXPECT_EQ(10485760u, stat.vsize);
+  EXPECT_EQ(300, stat.rss);
+
+  // Truncated contents are rejected.
+  EXPECT_FALSE(parseProcStat(contents, 40, &stat));
+  EXPECT_FALSE(parseProcStat("4321 (bash", 10, &stat));
+}
+
+
+TEST(ProcUtilsTest, ParseProcStatm)
+{
+  const char* contents = "2500 300 120 40 0 900 0\n";
+
+  ProcStatm statm;
+  ASSERT_TRUE(parseProcStatm(contents, strlen(contents), &statm));
+
+  EXPECT_EQ(2500u, statm.size);
+  EXPECT_EQ(300u, statm.resident);
+  EXPECT_EQ(120u, statm.shared);
+  EXPECT_EQ(40u, statm.text);
+  EXPECT_EQ(900u, statm.data);
+
+  EXPECT_FALSE(parseProcStatm("2500 300", 8, &statm));
+}
+
+
+TEST(ProcUtilsTest, ParseProcIo)
+{
+  const char* contents =
+    "rchar: 1000\n"
+    "wchar: 2000\n"
+    "syscr: 10\n"
+    "syscw: 20\n"
+    "read_bytes: 4096\n"
+    "write_bytes: 8192\n"
+    "cancelled_write_bytes: 0\n";
+
+  ProcIo io;
+  ASSERT_TRUE(parseProcIo(contents, strlen(contents), &io));
+
+  EXPECT_EQ(1000u, io.rchar);
+  EXPECT_EQ(2000u, io.wchar);
+  EXPECT_EQ(4096u, io.readBytes);
+  EXPECT_EQ(8192u, io.writeBytes);
+
+  // All four fields are required.
+  EXPECT_FALSE(parseProcIo(contents, 24, &io));
+}
+
+
+TEST(ProcUtilsTest, ParseProcStatus)
+{
+  const char* contents =
+    "Name:\tbash\n"
+    "State:\tS (sleeping)\n"
+    "Threads:\t1\n"
+    "voluntary_ctxt_switches:\t150\n"
+    "nonvoluntary_ctxt_switches:\t7\n";
+
+  ProcStatus status;
+  ASSERT_TRUE(parseProcStatus(contents, strlen(contents), &status));
+
+  EXPECT_EQ(150u, status.voluntaryCtxtSwitches);
+  EXPECT_EQ(7u, status.nonvoluntaryCtxtSwitches);
+
+  // Both counters are required.
+  EXPECT_FALSE(parseProcStatus(contents, strlen(contents) - 32, &status));
+}
+
+
+TEST(ProcUtilsTest, ReadProcStat)
+{
+  ProcStat stat;
+  ASSERT_TRUE(readProcStat(getpid(), &stat));
+  EXPECT_EQ(getpid(), stat.pid);
+  EXPECT_EQ(getppid(), stat.ppid);
+  EXPECT_GT(stat.rss, 0);
+}
+
+
+// The ifstream based parser that readProcStat replaced, kept around
+// to benchmark against.
+static Try<ProcessStats> legacyGetProcessStats(const string& path)
+{
+  ifstream pStatFile(path.c_str());
+  if (!pStatFile.is_open()) {
+    return Try<ProcessStats>::error("Cannot open " + path + " for stats");
+  }
+
+  // Dummy vars for leading entries in stat that we don't care about.
+  string comm, state, tty_nr, tpgid, flags, minflt, cminflt, majflt, cmajflt;
+  string cutime, cstime, priority, nice, num_threads, itrealvalue, vsize;
+
+  // These are the fields we want.
+  double rss, utime, stime, starttime;
+  pid_t _pid, ppid, pgrp, sid;
+
+  // Parse all fields from stat.
+  pStatFile >> _pid >> comm >> state >> ppid >> pgrp >> sid >> tty_nr >>
+               tpgid >> flags >> minflt >> cminflt >> majflt >> cmajflt >>
+               utime >> stime >> cutime >> cstime >> priority >> nice >>
+               num_threads >> itrealvalue >> starttime >> vsize >> rss;
+
+  if (!pStatFile) {
+    return Try<ProcessStats>::error("Failed to read ProcessStats from proc");
+  }
+
+  Try<seconds> bootTime = getBootTime();
+  if (bootTime.isError()) {
+    return Try<ProcessStats>::error(bootTime.error());
+  }
+
+  return ProcessStats(_pid, ppid, pgrp, sid,
+      seconds((utime + stime) / sysconf(_SC_CLK_TCK)),
+      seconds(bootTime.get().value + starttime / HZ),
+      rss * sysconf(_SC_PAGE_SIZE));
+}
+
+
+// Compares readProcStat against the legacy parser over a synthetic
+// /proc tree of 10k processes. Run with --gtest_also_run_disabled_tests.
+TEST(ProcUtilsTest, DISABLED_ProcStatParserBenchmark)
+{
+  const int processes = 10000;
+  const int rounds = 10;
+
+  char root[] = "/tmp/mesos-proc-XXXXXX";
+  ASSERT_TRUE(mkdtemp(root) != NULL);
+
+  list<string> paths;
+  for (int pid = 1; pid <= processes; pid++) {
+    string directory = string(root) + "/" + utils::stringify(pid);
+    ASSERT_TRUE(utils::os::mkdir(directory));
+
+    string path = directory + "/stat";
+    FILE* file = fopen(path.c_str(), "w");
+    ASSERT_TRUE(file != NULL);
+    fprintf(file, "%d (java) S %d %d %d 0 -1 4202752 120 0 7 0 "
+            "%d 50 0 0 20 0 31 0 1500 1048576000 %d 18446744073709551615 "
+            "1 1 0 0 0 0 0 0 0 0 0 0 17 3 0 0 0 0 0\n",
+            pid, pid / 2, pid, pid, pid * 3, pid * 7);
+    fclose(file);
+    paths.push_back(path);
+  }
+
+  Try<seconds> bootTime = getBootTime();
+  ASSERT_TRUE(bootTime.isSome());
+
+  double start = Clock::now();
+  for (int i = 0; i < rounds; i++) {
+    foreach (const string& path, paths) {
+      ASSERT_TRUE(legacyGetProcessStats(path).isSome());
+    }
+  }
+  double legacy = Clock::now() - start;
+
+  ProcStat stat;
+
+  start = Clock::now();
+  for (int i = 0; i < rounds; i++) {
+    foreach (const string& path, paths) {
+      ASSERT_TRUE(readProcStat(path.c_str(), &stat));
+      toProcessStats(stat, bootTime.get());
+    }
+  }
+  double current = Clock::now() - start;
+
+  std::cout << "Parsed " << rounds << " x " << processes << " stat files: "
+            << "ifstream " << legacy << " secs, "
+            << "readProcStat " << current << " secs" << std::endl;
+
+  EXPECT_TRUE(utils::os::rmdir(root));
+}
+
 } // namespace monitoring {
 } // namespace internal {
 } // namespace mesos {
@@ -19,11 +19,16 @@
 #include <gtest/gtest.h>
 #include <gmock/gmock.h>
 
+#include <cmath>
+
+#include <process/clock.hpp>
+
 #include "common/seconds.hpp"
 #include "common/try.hpp"
 
 #include "monitoring/process_stats.hpp"
 #include "monitoring/process_resource_collector.hpp"
+#include "monitoring/process_table.hpp"
 
 /* Tests for ProcessResourceCollector.
  * TODO(adegtiar): add more tests.
@@ -33,6 +38,7 @@ using namespace mesos;
 using namespace mesos::internal;
 using namespace mesos::internal::monitoring;
 
+using process::Clock;
 using std::list;
 using std::string;
 using testing::Return;
@@ -45,6 +51,12 @@ public:
   MOCK_METHOD0(getStartTime, Try<seconds>());
 };
 
+static ProcessStats makeProcess(pid_t pid, double user, double system)
+{
+  return ProcessStats(pid, 1, pid, pid, seconds(user + system), seconds(0),
+                      1024, seconds(user), seconds(system), 2, 3);
+}
+
 TEST(ProcessResourceCollectorTest, PropagatesError)
 {
   MockProcessCollector collector(1);
@@ -52,20 +64,307 @@ TEST(ProcessResourceCollectorTest, PropagatesError)
   ON_CALL(collector, getStartTime())
     .WillByDefault(Return(seconds(0)));
 
-  // Make sure collectUsage is called before retrieve mem/cpu usage.
   string error_message = "failed query";
   EXPECT_CALL(collector, getProcessTreeStats())
     .WillOnce(Return(Try<list<ProcessStats> >::error(error_message)));
 
-  collector.collectUsage();
+  // Make sure the failed query is propagated.
+  UsageRecord usage;
+  string error;
+  ASSERT_FALSE(collector.collect(&usage, &error));
+  ASSERT_EQ(error_message, error);
+}
+
+TEST(ProcessResourceCollectorTest, SumsProcessTree)
+{
+  MockProcessCollector collector(1);
+
+  EXPECT_CALL(collector, getStartTime())
+    .WillOnce(Return(seconds(0)));
+
+  list<ProcessStats> first;
+  first.push_back(makeProcess(1, 1.0, 0.5));
+  first.push_back(makeProcess(2, 2.0, 0.25));
+
+  list<ProcessStats> second;
+  second.push_back(makeProcess(1, 3.0, 0.5));
+  second.push_back(makeProcess(2, 2.5, 1.25));
+
+  EXPECT_CALL(collector, getProcessTreeStats())
+    .WillOnce(Return(first))
+    .WillOnce(Return(second));
+
+  UsageRecord usage;
+  string error;
+
+  // The first sample covers the usage since the process started.
+  ASSERT_TRUE(collector.collect(&usage, &error));
+  EXPECT_TRUE(usage.fields & USAGE_CPU);
+  EXPECT_TRUE(usage.fields & USAGE_RSS);
+  EXPECT_EQ(3.0, usage.cpuUser);
+  EXPECT_EQ(0.75, usage.cpuSystem);
+  EXPECT_EQ(2048.0, usage.rss);
+  EXPECT_EQ(4.0, usage.majorFaults);
+  EXPECT_EQ(6.0, usage.threads);
+
+  // Later samples cover the usage since the previous one.
+  ASSERT_TRUE(collector.collect(&usage, &error));
+  EXPECT_EQ(2.5, usage.cpuUser);
+  EXPECT_EQ(1.0, usage.cpuSystem);
+  EXPECT_EQ(0.0, usage.majorFaults);
+}
+
+static ProcessStats makeProcess(pid_t pid, pid_t ppid, double startTime,
+                                double user, double childUser)
+{
+  return ProcessStats(pid, ppid, pid, pid, seconds(user), seconds(startTime),
+                      1024, seconds(user), seconds(0), 0, 1,
+                      seconds(childUser), seconds(0));
+}
+
+TEST(ProcessResourceCollectorTest, CreditsExitedChildrenToReaper)
+{
+  MockProcessCollector collector(1);
+
+  EXPECT_CALL(collector, getStartTime())
+    .WillOnce(Return(seconds(0)));
+
+  // The executor (1) runs a task (2), which runs a helper (3).
+  list<ProcessStats> first;
+  first.push_back(makeProcess(1, 0, 0, 1.0, 0));
+  first.push_back(makeProcess(2, 1, 0, 5.0, 0));
+  first.push_back(makeProcess(3, 2, 0, 2.0, 0));
+
+  // The helper and then the task exit, having used another 0.5 and
+  // 0.7 seconds, and the executor reaps the task.
+  list<ProcessStats> second;
+  second.push_back(makeProcess(1, 0, 0, 1.5, 5.7 + 2.5));
+
+  EXPECT_CALL(collector, getProcessTreeStats())
+    .WillOnce(Return(first))
+    .WillOnce(Return(second));
+
+  UsageRecord usage;
+  string error;
+
+  ASSERT_TRUE(collector.collect(&usage, &error));
+  EXPECT_DOUBLE_EQ(8.0, usage.cpuUser);
+
+  // Only the time used since the previous sample is reported, instead
+  // of the 6.5 seconds drop a difference of the totals would give.
+  ASSERT_TRUE(collector.collect(&usage, &error));
+  EXPECT_DOUBLE_EQ(0.5 + 0.7 + 0.5, usage.cpuUser);
+}
+
+TEST(ProcessResourceCollectorTest, TracksProcessesByStartTime)
+{
+  MockProcessCollector collector(1);
+
+  EXPECT_CALL(collector, getStartTime())
+    .WillOnce(Return(seconds(0)));
+
+  list<ProcessStats> first;
+  first.push_back(makeProcess(1, 0, 0, 1.0, 0));
+  first.push_back(makeProcess(2, 1, 0, 4.0, 0));
+
+  // Pid 2 got reaped (without the parent accounting for it yet) and
+  // reused by a process that started after the first sample, and an
+  // older process (3) joined the tree.
+  list<ProcessStats> second;
+  second.push_back(makeProcess(1, 0, 0, 1.0, 0));
+  second.push_back(makeProcess(2, 1, 1e10, 0.25, 0));
+  second.push_back(makeProcess(3, 1, 0, 9.0, 0));
+
+  list<ProcessStats> third;
+  third.push_back(makeProcess(1, 0, 0, 1.0, 0));
+  third.push_back(makeProcess(2, 1, 1e10, 0.5, 0));
+  third.push_back(makeProcess(3, 1, 0, 10.0, 0));
+
+  EXPECT_CALL(collector, getProcessTreeStats())
+    .WillOnce(Return(first))
+    .WillOnce(Return(second))
+    .WillOnce(Return(third));
+
+  UsageRecord usage;
+  string error;
+
+  ASSERT_TRUE(collector.collect(&usage, &error));
+  EXPECT_DOUBLE_EQ(5.0, usage.cpuUser);
+
+  // The new process counts in full, the one that joined late does not.
+  ASSERT_TRUE(collector.collect(&usage, &error));
+  EXPECT_DOUBLE_EQ(0.25, usage.cpuUser);
+
+  ASSERT_TRUE(collector.collect(&usage, &error));
+  EXPECT_DOUBLE_EQ(0.25 + 1.0, usage.cpuUser);
+}
+
+TEST(ProcessResourceCollectorTest, NewProcessesWithWholeSecondStartTimes)
+{
+  MockProcessCollector collector(1);
+
+  EXPECT_CALL(collector, getStartTime())
+    .WillOnce(Return(seconds(0)));
+
+  list<ProcessStats> first;
+  first.push_back(makeProcess(1, 0, 0, 1.0, 0));
+
+  EXPECT_CALL(collector, getProcessTreeStats())
+    .WillOnce(Return(first));
+
+  UsageRecord usage;
+  string error;
+  ASSERT_TRUE(collector.collect(&usage, &error));
+
+  // A child started right after the first sample, but its start time
+  // got rounded down to the second.
+  list<ProcessStats> second;
+  second.push_back(makeProcess(1, 0, 0, 1.0, 0));
+  second.push_back(makeProcess(2, 1, floor(Clock::now()), 0.5, 0));
+
+  EXPECT_CALL(collector, getProcessTreeStats())
+    .WillOnce(Return(second));
+
+  ASSERT_TRUE(collector.collect(&usage, &error));
+  EXPECT_DOUBLE_EQ(0.5, usage.cpuUser);
+}
+
+// Keeps a counter per process (ten times its user time) and sums how
+// much the counters grew. The counter of 'unreadable' can't be read.
+class CountingProcessCollector : public MockProcessCollector
+{
+public:
+  CountingProcessCollector(pid_t rootPid)
+    : MockProcessCollector(rootPid), growth(-1), unreadable(0) {}
+
+  virtual void collectProcessTreeUsage(
+      const list<ProcessStats>& processes, UsageRecord* usage)
+  {
+    double total = 0;
+    list<ProcessStats>::const_iterator it;
+    for (it = processes.begin(); it != processes.end(); ++it) {
+      if (it->pid == unreadable) {
+        keepCounter(*it, 0);
+      } else {
+        total += counterDelta(*it, 0, 10 * it->userTime.value);
+      }
+    }
+    growth = isFirstSample() ? -1 : total;
+  }
+
+  double growth; // -1 on the first sample.
+  pid_t unreadable;
+};
+
+TEST(ProcessResourceCollectorTest, DifferencesCountersPerProcess)
+{
+  CountingProcessCollector collector(1);
+
+  EXPECT_CALL(collector, getStartTime())
+    .WillOnce(Return(seconds(0)));
+
+  list<ProcessStats> first;
+  first.push_back(makeProcess(1, 0, 0, 1.0, 0));
+  first.push_back(makeProcess(2, 1, 0, 5.0, 0));
+
+  // The child exits, taking its 50 out of the total.
+  list<ProcessStats> second;
+  second.push_back(makeProcess(1, 0, 0, 2.0, 0));
+
+  // A new child starts.
+  list<ProcessStats> third;
+  third.push_back(makeProcess(1, 0, 0, 2.0, 0));
+  third.push_back(makeProcess(3, 1, 1e10, 0.5, 0));
+
+  EXPECT_CALL(collector, getProcessTreeStats())
+    .WillOnce(Return(first))
+    .WillOnce(Return(second))
+    .WillOnce(Return(third));
+
+  UsageRecord usage;
+  string error;
+
+  // The first sample is only a baseline.
+  ASSERT_TRUE(collector.collect(&usage, &error));
+  EXPECT_EQ(-1, collector.growth);
+
+  ASSERT_TRUE(collector.collect(&usage, &error));
+  EXPECT_DOUBLE_EQ(10.0, collector.growth);
+
+  ASSERT_TRUE(collector.collect(&usage, &error));
+  EXPECT_DOUBLE_EQ(5.0, collector.growth);
+}
+
+TEST(ProcessResourceCollectorTest, KeepsCountersThatCantBeRead)
+{
+  CountingProcessCollector collector(1);
+
+  EXPECT_CALL(collector, getStartTime())
+    .WillOnce(Return(seconds(0)));
+
+  list<ProcessStats> first;
+  first.push_back(makeProcess(1, 0, 0, 1.0, 0));
+  first.push_back(makeProcess(2, 1, 0, 5.0, 0));
+
+  list<ProcessStats> second;
+  second.push_back(makeProcess(1, 0, 0, 2.0, 0));
+  second.push_back(makeProcess(2, 1, 0, 6.0, 0));
+
+  list<ProcessStats> third;
+  third.push_back(makeProcess(1, 0, 0, 2.0, 0));
+  third.push_back(makeProcess(2, 1, 0, 7.0, 0));
+
+  EXPECT_CALL(collector, getProcessTreeStats())
+    .WillOnce(Return(first))
+    .WillOnce(Return(second))
+    .WillOnce(Return(third));
+
+  UsageRecord usage;
+  string error;
+
+  ASSERT_TRUE(collector.collect(&usage, &error));
+
+  // The counter of the child can't be read, the parent's still counts.
+  collector.unreadable = 2;
+  ASSERT_TRUE(collector.collect(&usage, &error));
+  EXPECT_DOUBLE_EQ(10.0, collector.growth);
+
+  // Once it can be read again, the child's counter is differenced
+  // against the last value that was read.
+  collector.unreadable = 0;
+  ASSERT_TRUE(collector.collect(&usage, &error));
+  EXPECT_DOUBLE_EQ(20.0, collector.growth);
+}
+
+TEST(ProcessTableTest, InsertAndFind)
+{
+  ProcessTable table;
+  table.reset(4);
+
+  // Grow well past the initial capacity.
+  for (pid_t pid = 1; pid <= 1000; pid++) {
+    ProcessEntry* entry = table.insert(pid, pid * 10.0);
+    entry->userTime = pid;
+  }
+
+  EXPECT_EQ(1000u, table.size());
+
+  for (pid_t pid = 1; pid <= 1000; pid++) {
+    ProcessEntry* entry = table.find(pid, pid * 10.0);
+    ASSERT_TRUE(entry != NULL);
+    EXPECT_EQ(pid, entry->userTime);
+    EXPECT_EQ(entry, table.find(pid));
+  }
+
+  // A reused pid is a different process.
+  EXPECT_TRUE(table.find(5, 0.0) == NULL);
+  EXPECT_TRUE(table.find(1001) == NULL);
 
-  // Make sure the retrieved memory usage propgates the failed query.
-  Try<double> mem_usage = collector.getMemoryUsage();
-  ASSERT_TRUE(mem_usage.isError());
-  ASSERT_EQ(error_message, mem_usage.error());
+  // Inserting an existing process returns its entry.
+  EXPECT_EQ(table.find(7), table.insert(7, 70.0));
+  EXPECT_EQ(1000u, table.size());
 
-  // Make sure the retrieved cpu usage propgates the failed query.
-  Try<Rate> cpu_usage = collector.getCpuUsage();
-  ASSERT_TRUE(cpu_usage.isError());
-  ASSERT_EQ(error_message, cpu_usage.error());
+  table.reset(4);
+  EXPECT_EQ(0u, table.size());
+  EXPECT_TRUE(table.find(7) == NULL);
 }
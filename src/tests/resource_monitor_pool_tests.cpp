@@ -0,0 +1,184 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <list>
+#include <set>
+#include <string>
+#include <utility>
+
+#include <process/future.hpp>
+
+#include "common/foreach.hpp"
+#include "common/utils.hpp"
+#include "monitoring/resource_collector.hpp"
+#include "slave/resource_monitor_pool.hpp"
+
+using namespace mesos;
+using namespace mesos::internal;
+using namespace mesos::internal::monitoring;
+using namespace mesos::internal::slave;
+
+using process::Future;
+
+using std::list;
+using std::make_pair;
+using std::pair;
+using std::set;
+using std::string;
+
+// Measures a constant usage, or fails, and records when it is deleted.
+class ConstantCollector : public ResourceCollector
+{
+public:
+  ConstantCollector(bool _fail, bool* _deleted = NULL)
+    : fail(_fail), deleted(_deleted) {}
+
+  virtual ~ConstantCollector()
+  {
+    if (deleted != NULL) {
+      *deleted = true;
+    }
+  }
+
+  virtual bool collect(UsageRecord* usage, string* error)
+  {
+    if (fail) {
+      *error = "failed to collect";
+      return false;
+    }
+
+    usage->fields = USAGE_CPU | USAGE_RSS;
+    usage->timestamp = 100.0;
+    usage->duration = 1.0;
+    usage->cpuUser = 0.5;
+    usage->rss = 1024.0;
+    return true;
+  }
+
+private:
+  bool fail;
+  bool* deleted;
+};
+
+
+static pair<FrameworkID, ExecutorID> executor(int framework, int executor)
+{
+  FrameworkID frameworkId;
+  frameworkId.set_value("framework" + utils::stringify(framework));
+  ExecutorID executorId;
+  executorId.set_value("executor" + utils::stringify(executor));
+  return make_pair(frameworkId, executorId);
+}
+
+
+TEST(ResourceMonitorPoolTest, CollectsAcrossThreads)
+{
+  ResourceMonitorPool pool(3);
+
+  list<pair<FrameworkID, ExecutorID> > executors;
+  for (int i = 0; i < 8; i++) {
+    executors.push_back(executor(i % 2, i));
+    pool.add(executors.back().first,
+             executors.back().second,
+             new ResourceMonitor(new ConstantCollector(false)));
+  }
+
+  // Executors without a monitor are left out.
+  executors.push_back(executor(0, 8));
+
+  Future<list<UsageMessage> > future = pool.collect(executors);
+
+  ASSERT_TRUE(future.await(5));
+  ASSERT_TRUE(future.isReady());
+  ASSERT_EQ(8u, future.get().size());
+
+  set<string> ids;
+  foreach (const UsageMessage& usage, future.get()) {
+    EXPECT_EQ(1.0, usage.duration());
+    ids.insert(usage.framework_id().value() + "/" +
+               usage.executor_id().value());
+  }
+
+  EXPECT_EQ(8u, ids.size());
+  EXPECT_EQ(1u, ids.count("framework1/executor7"));
+}
+
+
+TEST(ResourceMonitorPoolTest, LeavesOutFailures)
+{
+  ResourceMonitorPool pool(2);
+
+  pool.add(executor(0, 0).first, executor(0, 0).second,
+           new ResourceMonitor(new ConstantCollector(false)));
+  pool.add(executor(0, 1).first, executor(0, 1).second,
+           new ResourceMonitor(new ConstantCollector(true)));
+
+  list<pair<FrameworkID, ExecutorID> > executors;
+  executors.push_back(executor(0, 0));
+  executors.push_back(executor(0, 1));
+
+  Future<list<UsageMessage> > future = pool.collect(executors);
+
+  ASSERT_TRUE(future.await(5));
+  ASSERT_TRUE(future.isReady());
+  ASSERT_EQ(1u, future.get().size());
+  EXPECT_EQ("executor0", future.get().front().executor_id().value());
+}
+
+
+TEST(ResourceMonitorPoolTest, EmptyCollection)
+{
+  ResourceMonitorPool pool(1);
+
+  Future<list<UsageMessage> > future =
+    pool.collect(list<pair<FrameworkID, ExecutorID> >());
+
+  ASSERT_TRUE(future.isReady());
+  EXPECT_TRUE(future.get().empty());
+}
+
+
+TEST(ResourceMonitorPoolTest, RemoveDeletesMonitor)
+{
+  bool deleted = false;
+
+  ResourceMonitorPool pool(1);
+
+  pool.add(executor(0, 0).first, executor(0, 0).second,
+           new ResourceMonitor(new ConstantCollector(false, &deleted)));
+  pool.add(executor(0, 1).first, executor(0, 1).second,
+           new ResourceMonitor(new ConstantCollector(false)));
+
+  pool.remove(executor(0, 0).first, executor(0, 0).second);
+
+  // With a single thread, the monitor is gone by the time a later
+  // collection is done.
+  list<pair<FrameworkID, ExecutorID> > executors;
+  executors.push_back(executor(0, 0));
+  executors.push_back(executor(0, 1));
+
+  Future<list<UsageMessage> > future = pool.collect(executors);
+
+  ASSERT_TRUE(future.await(5));
+  ASSERT_TRUE(future.isReady());
+  ASSERT_EQ(1u, future.get().size());
+  EXPECT_EQ("executor1", future.get().front().executor_id().value());
+  EXPECT_TRUE(deleted);
+}
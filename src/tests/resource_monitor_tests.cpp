@@ -39,36 +39,35 @@ using namespace mesos::internal::slave;
 using process::Clock;
 using process::Future;
 using std::string;
-using testing::Expectation;
+using testing::_;
+using testing::DoAll;
 using testing::Return;
+using testing::SetArgPointee;
 
 class MockCollector : public ResourceCollector
 {
 public:
-  MOCK_METHOD0(getMemoryUsage, Try<double>());
-  MOCK_METHOD0(getCpuUsage, Try<Rate>());
-  MOCK_METHOD0(collectUsage, void());
+  MOCK_METHOD2(collect, bool(UsageRecord*, string*));
 };
 
 TEST(ResourceMonitorTest, MonitorsCorrectly)
 {
   MockCollector* mock_collector = new MockCollector();
 
-  // Make sure collectUsage is called before retrieve mem/cpu usage.
-  Expectation collect_usage = EXPECT_CALL(*mock_collector, collectUsage())
-    .Times(1);
-
-  // Set the memory usage the collector will return.
-  double memoryUsage = 123456789.0;
-  EXPECT_CALL(*mock_collector, getMemoryUsage())
-    .After(collect_usage)
-    .WillOnce(Return(Try<double>::some(memoryUsage)));
-
-  // Set the cpu usage the collector will return.
-  double duration = 13579.0, difference = 2468.0;
-  EXPECT_CALL(*mock_collector, getCpuUsage())
-    .After(collect_usage)
-    .WillOnce(Return(Try<Rate>::some(Rate(duration, difference))));
+  // Set the usage the collector will return.
+  UsageRecord record;
+  record.fields = USAGE_CPU | USAGE_RSS | USAGE_IO | USAGE_THREADS;
+  record.timestamp = Clock::now();
+  record.duration = 13579.0;
+  record.cpuUser = 2000.0;
+  record.cpuSystem = 468.0;
+  record.rss = 123456789.0;
+  record.ioReadBytes = 4096.0;
+  record.ioWriteBytes = 8192.0;
+  record.threads = 12;
+
+  EXPECT_CALL(*mock_collector, collect(_, _))
+    .WillOnce(DoAll(SetArgPointee<0>(record), Return(true)));
 
   ResourceMonitor mocked_monitor(mock_collector);
 
@@ -90,14 +89,148 @@ TEST(ResourceMonitorTest, MonitorsCorrectly)
   UsageMessage usage_msg = usage_msg_future.get();
 
   // Make sure the returned UsageMessage matches the expected values.
-  EXPECT_EQ(duration, usage_msg.duration());
+  EXPECT_EQ(record.duration, usage_msg.duration());
   EXPECT_FALSE(usage_msg.timestamp() > Clock::now()); // To fix roundoff errors.
-  
-  // TODO(adegtiar or sam): fix this check.
-  //EXPECT_EQ(framework_id, usage_msg.framework_id());
-  //EXPECT_EQ(executor_id, usage_msg.executor_id());
+  EXPECT_EQ(framework_id.value(), usage_msg.framework_id().value());
+  EXPECT_EQ(executor_id.value(), usage_msg.executor_id().value());
 
   Resources usage = usage_msg.resources();
-  EXPECT_EQ(memoryUsage, usage.get("mem_usage", Value::Scalar()).value());
-  EXPECT_EQ(difference, usage.get("cpu_usage", Value::Scalar()).value());
+  EXPECT_EQ(record.rss, usage.get("mem", Value::Scalar()).value());
+  EXPECT_EQ(record.cpuUser + record.cpuSystem,
+            usage.get("cpus", Value::Scalar()).value());
+
+  // Only the measured statistics are set.
+  const UsageStatistics& statistics = usage_msg.statistics();
+  EXPECT_EQ(record.cpuUser, statistics.cpu_user_time());
+  EXPECT_EQ(record.cpuSystem, statistics.cpu_system_time());
+  EXPECT_EQ(record.ioReadBytes, statistics.io_read_bytes());
+  EXPECT_EQ(record.ioWriteBytes, statistics.io_write_bytes());
+  EXPECT_EQ(record.threads, statistics.threads());
+  EXPECT_FALSE(statistics.has_page_cache_bytes());
+  EXPECT_FALSE(statistics.has_major_faults());
+  EXPECT_FALSE(statistics.has_context_switches());
+}
+
+TEST(ResourceMonitorTest, PrefersTotals)
+{
+  MockCollector* mock_collector = new MockCollector();
+
+  // A container charged for more than its user and system time, and
+  // for swap on top of its resident memory and page cache.
+  UsageRecord record;
+  record.fields = USAGE_CPU_TOTAL | USAGE_MEM_TOTAL | USAGE_CPU |
+    USAGE_RSS | USAGE_PAGE_CACHE;
+  record.timestamp = Clock::now();
+  record.duration = 1.0;
+  record.cpuTotal = 2.5;
+  record.memTotal = 8192.0;
+  record.cpuUser = 1.0;
+  record.cpuSystem = 1.0;
+  record.rss = 2048.0;
+  record.pageCache = 1024.0;
+
+  EXPECT_CALL(*mock_collector, collect(_, _))
+    .WillOnce(DoAll(SetArgPointee<0>(record), Return(true)));
+
+  ResourceMonitor mocked_monitor(mock_collector);
+
+  FrameworkID framework_id;
+  framework_id.set_value("framework_id1");
+  ExecutorID executor_id;
+  executor_id.set_value("executor_id1");
+
+  Future<UsageMessage> usage_msg_future = mocked_monitor.collectUsage(
+      framework_id, executor_id);
+
+  usage_msg_future.await(5);
+
+  ASSERT_TRUE(usage_msg_future.isReady());
+
+  UsageMessage usage_msg = usage_msg_future.get();
+
+  Resources usage = usage_msg.resources();
+  EXPECT_EQ(record.memTotal, usage.get("mem", Value::Scalar()).value());
+  EXPECT_EQ(record.cpuTotal, usage.get("cpus", Value::Scalar()).value());
+
+  // The breakdowns are still reported.
+  const UsageStatistics& statistics = usage_msg.statistics();
+  EXPECT_EQ(record.cpuUser, statistics.cpu_user_time());
+  EXPECT_EQ(record.cpuSystem, statistics.cpu_system_time());
+  EXPECT_EQ(record.rss, statistics.rss_bytes());
+  EXPECT_EQ(record.pageCache, statistics.page_cache_bytes());
+}
+
+TEST(ResourceMonitorTest, PropagatesError)
+{
+  MockCollector* mock_collector = new MockCollector();
+
+  EXPECT_CALL(*mock_collector, collect(_, _))
+    .WillOnce(DoAll(SetArgPointee<1>(string("failed query")), Return(false)));
+
+  ResourceMonitor mocked_monitor(mock_collector);
+
+  FrameworkID framework_id;
+  framework_id.set_value("framework_id1");
+  ExecutorID executor_id;
+  executor_id.set_value("executor_id1");
+
+  Future<UsageMessage> usage_msg_future = mocked_monitor.collectUsage(
+      framework_id, executor_id);
+
+  usage_msg_future.await(5);
+
+  ASSERT_TRUE(usage_msg_future.isFailed());
+  EXPECT_EQ("failed query", usage_msg_future.failure());
+}
+
+TEST(ResourceMonitorTest, KeepsHistory)
+{
+  MockCollector* mock_collector = new MockCollector();
+
+  // Two samples a second apart, using 1 and then 3 cpus.
+  UsageRecord first;
+  first.fields = USAGE_CPU | USAGE_RSS;
+  first.timestamp = 100.0;
+  first.duration = 1.0;
+  first.cpuUser = 1.0;
+  first.rss = 1024.0;
+
+  UsageRecord second = first;
+  second.timestamp = 101.0;
+  second.cpuUser = 3.0;
+  second.rss = 3072.0;
+
+  EXPECT_CALL(*mock_collector, collect(_, _))
+    .WillOnce(DoAll(SetArgPointee<0>(first), Return(true)))
+    .WillOnce(DoAll(SetArgPointee<0>(second), Return(true)));
+
+  ResourceMonitor mocked_monitor(mock_collector);
+
+  FrameworkID framework_id;
+  framework_id.set_value("framework_id1");
+  ExecutorID executor_id;
+  executor_id.set_value("executor_id1");
+
+  mocked_monitor.collectUsage(framework_id, executor_id);
+
+  Future<UsageMessage> usage_msg_future = mocked_monitor.collectUsage(
+      framework_id, executor_id);
+
+  usage_msg_future.await(5);
+
+  ASSERT_TRUE(usage_msg_future.isReady());
+
+  // One window each for 10 seconds, a minute and 5 minutes.
+  UsageMessage usage_msg = usage_msg_future.get();
+  ASSERT_EQ(3, usage_msg.history_size());
+
+  const UsageWindow& window = usage_msg.history(0);
+  EXPECT_EQ(10.0, window.duration());
+  EXPECT_EQ(2u, window.samples());
+  EXPECT_DOUBLE_EQ(2.0, window.cpus_mean());
+  EXPECT_EQ(3.0, window.cpus_max());
+  EXPECT_DOUBLE_EQ(2048.0, window.mem_mean());
+  EXPECT_EQ(3072.0, window.mem_max());
+
+  EXPECT_EQ(3u, mocked_monitor.summarizeUsage().size());
 }
@@ -0,0 +1,194 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <signal.h>
+#include <unistd.h>
+
+#include <linux/taskstats.h>
+
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include <string>
+
+#include "monitoring/linux/proc_resource_collector.hpp"
+#include "monitoring/linux/proc_snapshot.hpp"
+#include "monitoring/linux/taskstats_reader.hpp"
+#include "monitoring/linux/taskstats_resource_collector.hpp"
+
+#include "monitoring/resource_collector.hpp"
+
+using std::string;
+
+namespace mesos {
+namespace internal {
+namespace monitoring {
+
+// These tests pass trivially on kernels without taskstats.
+
+TEST(TaskstatsTest, ReadsThreadGroup)
+{
+  if (!TaskstatsResourceCollector::isSupported()) {
+    return;
+  }
+
+  TaskstatsReader reader;
+  ASSERT_TRUE(reader.connect().isSome());
+
+  struct taskstats stats;
+  ASSERT_TRUE(reader.read(getpid(), &stats));
+  EXPECT_GT(stats.version, 0);
+
+  // Queries go through the same socket.
+  ASSERT_TRUE(reader.read(getpid(), &stats));
+}
+
+
+TEST(TaskstatsTest, MissingProcess)
+{
+  if (!TaskstatsResourceCollector::isSupported()) {
+    return;
+  }
+
+  pid_t pid = fork();
+  ASSERT_NE(-1, pid);
+
+  if (pid == 0) {
+    _exit(0);
+  }
+
+  waitpid(pid, NULL, 0);
+
+  TaskstatsReader reader;
+  ASSERT_TRUE(reader.connect().isSome());
+
+  struct taskstats stats;
+  EXPECT_FALSE(reader.read(pid, &stats));
+
+  // The socket is still usable after an error.
+  EXPECT_TRUE(reader.read(getpid(), &stats));
+}
+
+
+TEST(TaskstatsTest, Unconnected)
+{
+  TaskstatsReader reader;
+
+  struct taskstats stats;
+  EXPECT_FALSE(reader.read(getpid(), &stats));
+}
+
+
+TEST(TaskstatsTest, CollectsDelays)
+{
+  if (!TaskstatsResourceCollector::isSupported()) {
+    return;
+  }
+
+  ProcSnapshotter snapshotter(0);
+  TaskstatsResourceCollector collector(getpid(), &snapshotter, NULL);
+
+  UsageRecord usage;
+  string error;
+
+  // The first sample is only a baseline for the delays.
+  ASSERT_TRUE(collector.collect(&usage, &error)) << error;
+  EXPECT_TRUE(usage.fields & USAGE_CPU);
+  EXPECT_FALSE(usage.fields & USAGE_DELAYS);
+
+  ASSERT_TRUE(collector.collect(&usage, &error)) << error;
+  EXPECT_TRUE(usage.fields & USAGE_CPU);
+  EXPECT_TRUE(usage.fields & USAGE_DELAYS);
+  EXPECT_GE(usage.cpuDelay, 0);
+  EXPECT_GE(usage.blkioDelay, 0);
+  EXPECT_GE(usage.swapinDelay, 0);
+}
+
+TEST(TaskstatsTest, CollectsRunTime)
+{
+  if (!TaskstatsResourceCollector::isSupported()) {
+    return;
+  }
+
+  const unsigned long long tick = 1000000000ull / sysconf(_SC_CLK_TCK);
+
+  // A child that burns cpu until its run time is off a clock tick
+  // (unless the kernel lacks delay accounting), and then stops so
+  // that its times hold still.
+  pid_t pid = fork();
+  ASSERT_NE(-1, pid);
+
+  if (pid == 0) {
+    TaskstatsReader reader;
+    if (reader.connect().isSome()) {
+      volatile double sum = 0;
+      struct taskstats stats;
+      for (int i = 0; i < 1000; i++) {
+        for (int j = 0; j < 100000; j++) {
+          sum += j;
+        }
+        if (reader.read(getpid(), &stats) &&
+            stats.cpu_run_real_total > tick &&
+            stats.cpu_run_real_total % tick != 0) {
+          break;
+        }
+      }
+    }
+    raise(SIGSTOP);
+    _exit(0);
+  }
+
+  int status;
+  ASSERT_EQ(pid, waitpid(pid, &status, WUNTRACED));
+  ASSERT_TRUE(WIFSTOPPED(status));
+
+  TaskstatsReader reader;
+  ASSERT_TRUE(reader.connect().isSome());
+
+  struct taskstats stats;
+  ASSERT_TRUE(reader.read(pid, &stats));
+
+  if (stats.cpu_run_real_total % tick != 0) {
+    ProcSnapshotter snapshotter(0);
+
+    // The first sample has all the cpu time since the child started.
+    UsageRecord usage;
+    string error;
+    TaskstatsResourceCollector collector(pid, &snapshotter, NULL);
+    ASSERT_TRUE(collector.collect(&usage, &error)) << error;
+    ASSERT_TRUE(usage.fields & USAGE_CPU);
+
+    UsageRecord ticks;
+    ProcResourceCollector proc(pid, &snapshotter, NULL);
+    ASSERT_TRUE(proc.collect(&ticks, &error)) << error;
+
+    EXPECT_NEAR(stats.cpu_run_real_total / 1000000000.0,
+                usage.cpuUser + usage.cpuSystem,
+                1e-9);
+    EXPECT_NE(ticks.cpuUser + ticks.cpuSystem,
+              usage.cpuUser + usage.cpuSystem);
+  }
+
+  kill(pid, SIGKILL);
+  waitpid(pid, NULL, 0);
+}
+
+} // namespace monitoring {
+} // namespace internal {
+} // namespace mesos {
@@ -0,0 +1,174 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include "monitoring/usage_history.hpp"
+
+using namespace mesos::internal::monitoring;
+
+
+static UsageSample makeSample(double timestamp, double cpus, double mem,
+                              double duration = 1)
+{
+  UsageSample sample;
+  sample.timestamp = timestamp;
+  sample.duration = duration;
+  sample.cpus = cpus;
+  sample.mem = mem;
+  return sample;
+}
+
+
+TEST(UsageHistoryTest, Empty)
+{
+  UsageHistory history(UsageHistory::capacityFor(1));
+  EXPECT_EQ(0u, history.size());
+
+  UsageAggregate aggregate =
+    history.aggregate(UsageHistory::CPUS, UsageHistory::WINDOW_1_MINUTE);
+  EXPECT_EQ(0u, aggregate.samples);
+  EXPECT_EQ(0, aggregate.mean);
+}
+
+
+TEST(UsageHistoryTest, Windows)
+{
+  UsageHistory history(UsageHistory::capacityFor(1));
+
+  // One sample per second for 2 minutes, with cpus going 1, 2, ..., 120.
+  for (int i = 1; i <= 120; i++) {
+    history.add(makeSample(i, i, 1024 * 1024));
+  }
+
+  EXPECT_EQ(120u, history.size());
+  EXPECT_EQ(120, history.latest().cpus);
+
+  UsageAggregate last10 =
+    history.aggregate(UsageHistory::CPUS, UsageHistory::WINDOW_10_SECONDS);
+  EXPECT_EQ(10u, last10.samples);
+  EXPECT_DOUBLE_EQ(115.5, last10.mean);
+  EXPECT_EQ(120, last10.max);
+  EXPECT_NEAR(120, last10.p95, 120 * 0.03);
+
+  UsageAggregate lastMinute =
+    history.aggregate(UsageHistory::CPUS, UsageHistory::WINDOW_1_MINUTE);
+  EXPECT_EQ(60u, lastMinute.samples);
+  EXPECT_DOUBLE_EQ(90.5, lastMinute.mean);
+  EXPECT_EQ(120, lastMinute.max);
+  EXPECT_NEAR(117, lastMinute.p95, 117 * 0.03);
+
+  UsageAggregate all =
+    history.aggregate(UsageHistory::CPUS, UsageHistory::WINDOW_5_MINUTES);
+  EXPECT_EQ(120u, all.samples);
+  EXPECT_DOUBLE_EQ(60.5, all.mean);
+
+  UsageAggregate mem =
+    history.aggregate(UsageHistory::MEM, UsageHistory::WINDOW_5_MINUTES);
+  EXPECT_DOUBLE_EQ(1024 * 1024, mem.mean);
+  EXPECT_EQ(1024 * 1024, mem.max);
+  EXPECT_NEAR(1024 * 1024, mem.p95, 1024 * 1024 * 0.03);
+}
+
+
+TEST(UsageHistoryTest, MaximumLeavesWindow)
+{
+  UsageHistory history(UsageHistory::capacityFor(1));
+
+  history.add(makeSample(0, 8, 0));
+  for (int i = 1; i <= 10; i++) {
+    history.add(makeSample(i, 1, 0));
+  }
+
+  // The spike at time 0 just left the 10 second window.
+  UsageAggregate aggregate =
+    history.aggregate(UsageHistory::CPUS, UsageHistory::WINDOW_10_SECONDS);
+  EXPECT_EQ(10u, aggregate.samples);
+  EXPECT_EQ(1, aggregate.max);
+  EXPECT_DOUBLE_EQ(1, aggregate.mean);
+
+  aggregate =
+    history.aggregate(UsageHistory::CPUS, UsageHistory::WINDOW_1_MINUTE);
+  EXPECT_EQ(11u, aggregate.samples);
+  EXPECT_EQ(8, aggregate.max);
+}
+
+
+TEST(UsageHistoryTest, DropsOldestWhenFull)
+{
+  UsageHistory history(4);
+
+  for (int i = 1; i <= 6; i++) {
+    history.add(makeSample(i, i, 0));
+  }
+
+  EXPECT_EQ(4u, history.size());
+
+  UsageAggregate aggregate =
+    history.aggregate(UsageHistory::CPUS, UsageHistory::WINDOW_1_MINUTE);
+  EXPECT_EQ(4u, aggregate.samples);
+  EXPECT_DOUBLE_EQ(4.5, aggregate.mean);
+  EXPECT_EQ(6, aggregate.max);
+}
+
+
+TEST(UsageHistoryTest, WeightsMeanByDuration)
+{
+  UsageHistory history(UsageHistory::capacityFor(1));
+
+  // Busy for a second, then idle for the 8 seconds until the next
+  // sample.
+  history.add(makeSample(1, 4, 0));
+  history.add(makeSample(9, 0, 0, 8));
+
+  UsageAggregate aggregate =
+    history.aggregate(UsageHistory::CPUS, UsageHistory::WINDOW_10_SECONDS);
+  EXPECT_EQ(2u, aggregate.samples);
+  EXPECT_DOUBLE_EQ(4.0 / 9, aggregate.mean);
+  EXPECT_EQ(4, aggregate.max);
+
+  // The busy sample leaves the window.
+  history.add(makeSample(11, 2, 0, 2));
+
+  aggregate =
+    history.aggregate(UsageHistory::CPUS, UsageHistory::WINDOW_10_SECONDS);
+  EXPECT_EQ(2u, aggregate.samples);
+  EXPECT_DOUBLE_EQ(4.0 / 10, aggregate.mean);
+}
+
+
+TEST(UsageHistoryTest, CapacityCoversLongestWindow)
+{
+  EXPECT_EQ(301u, UsageHistory::capacityFor(1));
+  EXPECT_EQ(3001u, UsageHistory::capacityFor(0.1));
+  EXPECT_EQ(31u, UsageHistory::capacityFor(10));
+
+  // Histogram buckets can't count any higher.
+  EXPECT_EQ(65535u, UsageHistory::capacityFor(0.001));
+
+  // Five minutes of samples a second apart fit.
+  UsageHistory history(UsageHistory::capacityFor(1));
+  for (int i = 1; i <= 600; i++) {
+    history.add(makeSample(i, i, 0));
+  }
+
+  UsageAggregate aggregate =
+    history.aggregate(UsageHistory::CPUS, UsageHistory::WINDOW_5_MINUTES);
+  EXPECT_EQ(300u, aggregate.samples);
+  EXPECT_DOUBLE_EQ(450.5, aggregate.mean);
+}
@@ -32,6 +32,8 @@ struct EventVisitor
 
 struct Event
 {
+  Event() : next(NULL), injected(false) {}
+
   virtual ~Event() {}
 
   virtual void visit(EventVisitor* visitor) const = 0;
@@ -67,6 +69,16 @@ struct Event
     }
     return *result;
   }
+
+private:
+  friend class ProcessBase;
+  friend class ProcessManager;
+
+  // Next event in a process' mailbox, and whether or not the event
+  // should be run before the events received before it (see
+  // ProcessBase::enqueue).
+  Event* next;
+  bool injected;
 };
 
 
@@ -175,15 +175,17 @@ private:
          BLOCKED,
 	 FINISHED } state;
 
-  // Mutex protecting internals. TODO(benh): Replace with a spinlock.
-  pthread_mutex_t m;
-  void lock() { pthread_mutex_lock(&m); }
-  void unlock() { pthread_mutex_unlock(&m); }
-
   // Enqueue the specified message, request, or function call.
   void enqueue(Event* event, bool inject = false);
 
-  // Queue of received events.
+  // Mailbox of received events, pushed onto by any thread without
+  // locking and linked (most recent first) through Event::next. Also
+  // marks whether the process is blocked waiting for events or has
+  // finished (see ProcessBase::enqueue).
+  Event* mailbox;
+
+  // Queue of received events taken out of the mailbox, only used by
+  // the thread running the process.
   std::deque<Event*> events;
 
   // Delegates for messages.
@@ -208,6 +210,15 @@ private:
   // Active references.
   int refs;
 
+  // Index of the run queue of the processing thread the process last
+  // ran on (or was first queued on), -1 until it is first queued.
+  int runq;
+
+  // Statistics, only updated by the thread running the process.
+  uint64_t served; // Events served.
+  double busy; // Seconds spent serving events.
+  size_t maxQueued; // Most events queued at once.
+
   // Process PID.
   UPID pid;
 };
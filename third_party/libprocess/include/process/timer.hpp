@@ -15,6 +15,7 @@ namespace process {
 // if the issuing process is still valid and get a refernce to it).
 
 class Timer; // Forward declaration.
+class TimerWheel; // Forward declaration.
 
 namespace timers {
 
@@ -55,6 +56,7 @@ public:
   }
 
 private:
+  friend class TimerWheel;
   friend Timer timers::create(double, const std::tr1::function<void(void)>&);
 
   Timer(long _id,
@@ -5,6 +5,7 @@
 #include <libgen.h>
 #include <netdb.h>
 #include <pthread.h>
+#include <sched.h>
 #include <signal.h>
 #include <stdarg.h>
 #include <stdio.h>
@@ -32,6 +33,7 @@
 #include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <limits>
 #include <list>
 #include <map>
 #include <queue>
@@ -62,6 +64,7 @@
 #include "gate.hpp"
 #include "synchronized.hpp"
 #include "thread.hpp"
+#include "timer_wheel.hpp"
 #include "tokenize.hpp"
 
 
@@ -315,10 +318,39 @@ private:
 };
 
 
+// Queue of the runnable processes of one processing thread. A thread
+// runs the processes of its own queue first (in order) and steals
+// from the back of the other queues when its own is empty.
+struct RunQueue
+{
+  explicit RunQueue(int _index)
+    : index(_index), busy(0.0), idle(0.0), dequeued(0), stolen(0)
+  {
+    pthread_mutex_init(&m, NULL);
+  }
+
+  void lock() { pthread_mutex_lock(&m); }
+  void unlock() { pthread_mutex_unlock(&m); }
+
+  const int index;
+
+  pthread_mutex_t m;
+  deque<ProcessBase*> processes;
+
+  // Statistics of the processing thread. These are only updated by
+  // the thread itself, so reading them from another thread might
+  // give a slightly stale value.
+  double busy; // Seconds spent running processes.
+  double idle; // Seconds spent waiting for processes to run.
+  uint64_t dequeued; // Processes taken off this queue.
+  uint64_t stolen; // Processes taken off the other queues.
+};
+
+
 class ProcessManager
 {
 public:
-  ProcessManager(const string& delegate);
+  ProcessManager(const string& delegate, int workers);
   ~ProcessManager();
 
   ProcessReference use(const UPID& pid);
@@ -343,8 +375,17 @@ public:
   void enqueue(ProcessBase* process);
   ProcessBase* dequeue();
 
+  // Number of processing threads.
+  int workers() const { return runqs.size(); }
+
+  // Run queue of the i'th processing thread.
+  RunQueue* runq(int i) { return runqs[i]; }
+
   void settle();
 
+  // Returns statistics of the spawned processes as a JSON array.
+  string stats();
+
 private:
   // Delegate process name to receive root HTTP requests.
   const string delegate;
@@ -356,9 +397,21 @@ private:
   // Gates for waiting threads (protected by synchronizable(processes)).
   map<ProcessBase*, Gate*> gates;
 
-  // Queue of runnable processes (implemented using list).
-  list<ProcessBase*> runq;
-  synchronizable(runq);
+  // Takes a process off the front (or, if stealing, the back) of a
+  // run queue, or returns NULL if the queue is empty.
+  ProcessBase* dequeue(RunQueue* queue, bool steal);
+
+  // Takes all the events out of the mailbox of a (running) process
+  // and adds them to its queue of events.
+  void drain(ProcessBase* process);
+
+  // Run queues of the processing threads, each protected by its own
+  // lock. When more than one is locked, they are locked in order.
+  vector<RunQueue*> runqs;
+
+  // Used to spread the processes that are first queued by threads
+  // other than the processing threads.
+  unsigned int next;
 
   // Number of running processes, to support Clock::settle operation.
   int running;
@@ -399,13 +452,16 @@ static ev_io server_watcher;
 static queue<ev_io*>* watchers = new queue<ev_io*>();
 static synchronizable(watchers) = SYNCHRONIZED_INITIALIZER;
 
-// We store the timers in a map of lists indexed by the timeout of the
-// timer so that we can have two timers that have the same timeout. We
-// exploit that the map is SORTED!
-static map<double, list<Timer> >* timeouts =
-  new map<double, list<Timer> >();
+// We store the timers in a timer wheel so that adding and canceling
+// a timer takes constant time (see timer_wheel.hpp).
+static TimerWheel* timeouts = new TimerWheel();
 static synchronizable(timeouts) = SYNCHRONIZED_INITIALIZER_RECURSIVE;
 
+// Time the timeouts watcher was last set to fire at (infinity if it
+// wasn't set), used to determine whether a new timer requires updating
+// the watcher. Protected by the timeouts lock.
+static double armed = std::numeric_limits<double>::infinity();
+
 // For supporting Clock::settle(), true if timers have been removed
 // from 'timeouts' but may not have been executed yet. Protected by
 // the timeouts lock. This is only used when the clock is paused.
@@ -414,7 +470,31 @@ static bool pending_timers = false;
 // Flag to indicate whether or to update the timer on async interrupt.
 static bool update_timer = false;
 
-const int NUMBER_OF_PROCESSING_THREADS = 4; // TODO(benh): Do 2x cores.
+// Minimum number of processing threads. Processes may block the
+// thread they run on (e.g., waiting for a future), so even a machine
+// with fewer cores gets at least this many.
+const int MINIMUM_PROCESSING_THREADS = 4;
+
+// Whether or not each processing thread is pinned to a core (set via
+// the LIBPROCESS_WORKER_AFFINITY environment variable), and the cores
+// this process may run on (e.g., as limited by taskset or a cpuset),
+// which the threads get pinned to in turn.
+static bool affinity = false;
+static vector<int> cores;
+
+// Most events a process serves, and most microseconds it spends
+// serving events, each time it is resumed before it yields its thread
+// to other processes (0 for no limit). Set via the
+// LIBPROCESS_QUANTUM_EVENTS and LIBPROCESS_QUANTUM_USECS environment
+// variables.
+static int quantum_events = 100;
+static int quantum_usecs = 0;
+
+// Values of the mailbox of a process (besides a list of events or
+// NULL) when the process is blocked waiting for events, and when the
+// process has finished and drops any events it receives.
+static Event* const BLOCKED_MAILBOX = reinterpret_cast<Event*>(1);
+static Event* const CLOSED_MAILBOX = reinterpret_cast<Event*>(2);
 
 
 // Thread local process pointer magic (constructed in
@@ -425,6 +505,12 @@ static ThreadLocal<ProcessBase>* _process_ = NULL;
 
 #define __process__ (*_process_)
 
+// Thread local run queue of the processing thread (NULL on any other
+// thread), constructed in 'initialize'.
+static ThreadLocal<RunQueue>* _runq_ = NULL;
+
+#define __runq__ (*_runq_)
+
 
 // Scheduling gate that threads wait at when there is nothing to run.
 static Gate* gate = new Gate();
@@ -689,9 +775,10 @@ void handle_async(struct ev_loop* loop, ev_async* _, int revents)
 
   synchronized (timeouts) {
     if (update_timer) {
+      armed = timeouts->next();
       if (!timeouts->empty()) {
 	// Determine when the next timer should fire.
-	timeouts_watcher.repeat = timeouts->begin()->first - Clock::now();
+	timeouts_watcher.repeat = armed - Clock::now();
 
         if (timeouts_watcher.repeat <= 0) {
 	  // Feed the event now!
@@ -726,33 +813,28 @@ void handle_timeouts(struct ev_loop* loop, ev_timer* _, int revents)
     VLOG(1) << "Handling timeouts up to "
             << std::fixed << std::setprecision(9) << now;
 
-    foreachkey (double timeout, *timeouts) {
-      if (timeout > now) {
-        break;
-      }
+    // Remove the timers that timed out (in order of their timeouts).
+    timedout = timeouts->advance(now);
 
-      VLOG(2) << "Have timeout(s) at "
-              << std::fixed << std::setprecision(9) << timeout;
+    foreach (const Timer& timer, timedout) {
+      VLOG(2) << "Have timeout at "
+              << std::fixed << std::setprecision(9)
+              << timer.timeout().value();
 
       // Record that we have pending timers to execute so the
       // Clock::settle() operation can wait until we're done.
       pending_timers = true;
-
-      foreach (const Timer& timer, (*timeouts)[timeout]) {
-        timedout.push_back(timer);
-      }
     }
 
-    // Now erase the range of timeouts that timed out.
-    timeouts->erase(timeouts->begin(), timeouts->upper_bound(now));
+    armed = timeouts->next();
 
     // Okay, so the timeout for the next timer should not have fired.
-    CHECK(timeouts->empty() || (timeouts->begin()->first > now));
+    CHECK(armed > now);
 
     // Update the timer as necessary.
     if (!timeouts->empty()) {
       // Determine when the next timer should fire.
-      timeouts_watcher.repeat = timeouts->begin()->first - Clock::now();
+      timeouts_watcher.repeat = armed - Clock::now();
 
       if (timeouts_watcher.repeat <= 0) {
         // Feed the event now!
@@ -1097,6 +1179,26 @@ void* serve(void* arg)
 void* schedule(void* arg)
 {
   __process__ = NULL; // Start off not running anything.
+  __runq__ = (RunQueue*) arg;
+
+  if (affinity) {
+#ifdef __linux__
+    // Pin the i'th processing thread to the i'th core we may run on
+    // (wrapping around if there are more threads than cores).
+    if (!cores.empty()) {
+      cpu_set_t cpus;
+      CPU_ZERO(&cpus);
+      CPU_SET(cores[__runq__->index % cores.size()], &cpus);
+      int result = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+      if (result != 0) {
+        LOG(WARNING) << "Failed to pin processing thread "
+                     << __runq__->index << ": " << strerror(result);
+      }
+    }
+#else
+    LOG(WARNING) << "Pinning processing threads is not supported";
+#endif // __linux__
+  }
 
   do {
     ProcessBase* process = process_manager->dequeue();
@@ -1104,17 +1206,80 @@ void* schedule(void* arg)
       Gate::state_t old = gate->approach();
       process = process_manager->dequeue();
       if (process == NULL) {
+	double start = ev_time();
 	gate->arrive(old); // Wait at gate if idle.
+	__runq__->idle += ev_time() - start;
 	continue;
       } else {
 	gate->leave();
       }
     }
+    double start = ev_time();
     process_manager->resume(process);
+    __runq__->busy += ev_time() - start;
   } while (true);
 }
 
 
+// Exposes statistics of the processing threads (at
+// /__workers__/stats.json) and of the processes they run (at
+// /__workers__/processes.json).
+class WorkersProcess : public Process<WorkersProcess>
+{
+public:
+  WorkersProcess() : ProcessBase("__workers__")
+  {
+    route("stats.json", &WorkersProcess::stats);
+    route("processes.json", &WorkersProcess::processes);
+  }
+
+private:
+  Future<HttpResponse> stats(const HttpRequest& request)
+  {
+    std::ostringstream out;
+
+    out << "{\"workers\":" << process_manager->workers()
+        << ",\"affinity\":" << (affinity ? 1 : 0)
+        << ",\"threads\":[";
+
+    for (int i = 0; i < process_manager->workers(); i++) {
+      RunQueue* queue = process_manager->runq(i);
+
+      size_t queued;
+      queue->lock();
+      {
+        queued = queue->processes.size();
+      }
+      queue->unlock();
+
+      out << (i > 0 ? "," : "")
+          << "{\"index\":" << queue->index
+          << ",\"busy_secs\":" << queue->busy
+          << ",\"idle_secs\":" << queue->idle
+          << ",\"dequeued\":" << queue->dequeued
+          << ",\"stolen\":" << queue->stolen
+          << ",\"queued\":" << queued
+          << "}";
+    }
+
+    out << "]}";
+
+    HttpOKResponse response;
+    response.headers["Content-Type"] = "application/json";
+    response.body = out.str();
+    return response;
+  }
+
+  Future<HttpResponse> processes(const HttpRequest& request)
+  {
+    HttpOKResponse response;
+    response.headers["Content-Type"] = "application/json";
+    response.body = "{\"processes\":" + process_manager->stats() + "}";
+    return response;
+  }
+};
+
+
 // We might find value in catching terminating signals at some point.
 // However, for now, adding signal handlers freely is not allowed
 // because they will clash with Java and Python virtual machines and
@@ -1188,8 +1353,65 @@ void initialize(const string& delegate, bool initialize_glog)
   signal(SIGPIPE, SIG_IGN);
 #endif // __sun__
 
+  char* value;
+
+  // Check environment for the number of processing threads, otherwise
+  // use one per core.
+  int workers = max(sysconf(_SC_NPROCESSORS_ONLN), 1L);
+  value = getenv("LIBPROCESS_NUM_WORKER_THREADS");
+  if (value != NULL) {
+    workers = atoi(value);
+    if (workers <= 0) {
+      LOG(FATAL) << "LIBPROCESS_NUM_WORKER_THREADS=" << value
+                 << " is not a valid number of threads";
+    }
+  } else {
+    workers = max(workers, MINIMUM_PROCESSING_THREADS);
+  }
+
+  // Check environment for the quantum of a process.
+  value = getenv("LIBPROCESS_QUANTUM_EVENTS");
+  if (value != NULL) {
+    quantum_events = atoi(value);
+    if (quantum_events < 0) {
+      LOG(FATAL) << "LIBPROCESS_QUANTUM_EVENTS=" << value
+                 << " is not a valid number of events";
+    }
+  }
+
+  value = getenv("LIBPROCESS_QUANTUM_USECS");
+  if (value != NULL) {
+    quantum_usecs = atoi(value);
+    if (quantum_usecs < 0) {
+      LOG(FATAL) << "LIBPROCESS_QUANTUM_USECS=" << value
+                 << " is not a valid number of microseconds";
+    }
+  }
+
+  // Check environment for pinning processing threads to cores.
+  value = getenv("LIBPROCESS_WORKER_AFFINITY");
+  if (value != NULL) {
+    affinity = string(value) != "0" && string(value) != "false";
+  }
+
+#ifdef __linux__
+  if (affinity) {
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    if (sched_getaffinity(0, sizeof(cpus), &cpus) == 0) {
+      for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (CPU_ISSET(cpu, &cpus)) {
+          cores.push_back(cpu);
+        }
+      }
+    } else {
+      PLOG(WARNING) << "Failed to get the cores to pin processing threads to";
+    }
+  }
+#endif // __linux__
+
   // Create a new ProcessManager and SocketManager.
-  process_manager = new ProcessManager(delegate);
+  process_manager = new ProcessManager(delegate, workers);
   socket_manager = new SocketManager();
 
   // Setup the thread local process pointer.
@@ -1200,10 +1422,17 @@ void initialize(const string& delegate, bool initialize_glog)
 
   _process_ = new ThreadLocal<ProcessBase>(key);
 
+  // Setup the thread local run queue pointer.
+  if (pthread_key_create(&key, NULL) != 0) {
+    LOG(FATAL) << "Failed to initialize, pthread_key_create";
+  }
+
+  _runq_ = new ThreadLocal<RunQueue>(key);
+
   // Setup processing threads.
-  for (int i = 0; i < NUMBER_OF_PROCESSING_THREADS; i++) {
+  for (int i = 0; i < workers; i++) {
     pthread_t thread; // For now, not saving handles on our threads.
-    if (pthread_create(&thread, NULL, schedule, NULL) != 0) {
+    if (pthread_create(&thread, NULL, schedule, process_manager->runq(i)) != 0) {
       LOG(FATAL) << "Failed to initialize, pthread_create";
     }
   }
@@ -1211,8 +1440,6 @@ void initialize(const string& delegate, bool initialize_glog)
   __ip__ = 0;
   __port__ = 0;
 
-  char* value;
-
   // Check environment for ip.
   value = getenv("LIBPROCESS_IP");
   if (value != NULL) {
@@ -1338,6 +1565,9 @@ void initialize(const string& delegate, bool initialize_glog)
   // Create global garbage collector.
   gc = spawn(new GarbageCollector());
 
+  // Create the process exposing the processing thread statistics.
+  spawn(new WorkersProcess());
+
   char temp[INET_ADDRSTRLEN];
   if (inet_ntop(AF_INET, (in_addr*) &__ip__, temp, INET_ADDRSTRLEN) == NULL) {
     PLOG(FATAL) << "Failed to initialize, inet_ntop";
@@ -1920,11 +2150,14 @@ void SocketManager::exited(ProcessBase* process)
 }
 
 
-ProcessManager::ProcessManager(const string& _delegate)
+ProcessManager::ProcessManager(const string& _delegate, int workers)
   : delegate(_delegate)
 {
   synchronizer(processes) = SYNCHRONIZED_INITIALIZER_RECURSIVE;
-  synchronizer(runq) = SYNCHRONIZED_INITIALIZER_RECURSIVE;
+  for (int i = 0; i < workers; i++) {
+    runqs.push_back(new RunQueue(i));
+  }
+  next = 0;
   running = 0;
   __sync_synchronize(); // Ensure write to 'running' visible in other threads.
 }
@@ -2111,11 +2344,23 @@ void ProcessManager::resume(ProcessBase* process)
 {
   __process__ = process;
 
+  // Have the process queued on this thread the next time it runs
+  // (unless this is a thread donated by a waiter).
+  if (__runq__ != NULL) {
+    process->runq = __runq__->index;
+  }
+
   VLOG(2) << "Resuming " << process->pid << " at "
           << std::fixed << std::setprecision(9) << Clock::now();
 
   bool terminate = false;
   bool blocked = false;
+  bool yielded = false;
+
+  // Number of events served, and seconds spent serving them, since
+  // the process was resumed (to determine when its quantum is up).
+  int served = 0;
+  double elapsed = 0.0;
 
   CHECK(process->state == ProcessBase::BOTTOM ||
         process->state == ProcessBase::READY);
@@ -2126,28 +2371,39 @@ void ProcessManager::resume(ProcessBase* process)
     catch (...) { terminate = true; }
   }
 
-  while (!terminate && !blocked) {
-    Event* event = NULL;
+  while (!terminate && !blocked && !yielded) {
+    // Take any newly received events out of the mailbox (all at once,
+    // checking each time since injected events need to go first).
+    if (process->mailbox != NULL) {
+      drain(process);
+    }
 
-    process->lock();
-    {
-      if (process->events.size() > 0) {
-        event = process->events.front();
-        process->events.pop_front();
-        process->state = ProcessBase::RUNNING;
-      } else {
-        process->state = ProcessBase::BLOCKED;
+    if (process->events.empty()) {
+      // Block waiting for events unless some were received in the
+      // mean time. Once blocked, the first thread to enqueue an event
+      // will queue the process to get resumed (possibly by another
+      // thread), so we can't dereference the process after that.
+      process->state = ProcessBase::BLOCKED;
+      if (__sync_bool_compare_and_swap(
+              &process->mailbox, (Event*) NULL, BLOCKED_MAILBOX)) {
         blocked = true;
+      } else {
+        process->state = ProcessBase::RUNNING;
       }
-    }
-    process->unlock();
-
-    if (!blocked) {
-      CHECK(event != NULL);
+    } else if ((quantum_events > 0 && served >= quantum_events) ||
+               (quantum_usecs > 0 && elapsed * 1000000 >= quantum_usecs)) {
+      // Let the other processes run before serving any more events.
+      yielded = true;
+    } else {
+      Event* event = process->events.front();
+      process->events.pop_front();
+      process->state = ProcessBase::RUNNING;
 
       // Determine if we should terminate.
       terminate = event->is<TerminateEvent>();
 
+      double start = ev_time();
+
       // Now service the event.
       try {
         process->serve(*event);
@@ -2162,6 +2418,14 @@ void ProcessManager::resume(ProcessBase* process)
         terminate = true;
       }
 
+      double duration = ev_time() - start;
+
+      served++;
+      elapsed += duration;
+
+      process->served++;
+      process->busy += duration;
+
       delete event;
 
       if (terminate) {
@@ -2170,6 +2434,14 @@ void ProcessManager::resume(ProcessBase* process)
     }
   }
 
+  // Queue a process that yielded to get resumed after the processes
+  // already queued (another thread might resume it right away, so we
+  // can't dereference the process after this).
+  if (yielded) {
+    process->state = ProcessBase::READY;
+    enqueue(process);
+  }
+
   __process__ = NULL;
 
   CHECK_GE(running, 1);
@@ -2195,29 +2467,46 @@ void ProcessManager::cleanup(ProcessBase* process)
       __sync_synchronize();
     }
 
-    process->lock();
+    // Confirm process not in runq (it can only have been queued on
+    // the run queue it was last queued on). We check before removing
+    // the process since afterwards a waiter might deallocate it and
+    // another process might get allocated (and queued) in its place.
+    RunQueue* queue = runqs[process->runq];
+    queue->lock();
     {
-      // Free any pending events.
-      while (!process->events.empty()) {
-        Event* event = process->events.front();
-        process->events.pop_front();
-        delete event;
-      }
+      CHECK(find(queue->processes.begin(), queue->processes.end(), process) ==
+            queue->processes.end());
+    }
+    queue->unlock();
+
+    // Free any pending events, closing the mailbox so that any
+    // events received from now on get freed as well.
+    Event* event =
+      __sync_lock_test_and_set(&process->mailbox, CLOSED_MAILBOX);
+    while (event != NULL) {
+      Event* next = event->next;
+      delete event;
+      event = next;
+    }
 
-      processes.erase(process->pid.id);
- 
-      // Lookup gate to wake up waiting threads.
-      map<ProcessBase*, Gate*>::iterator it = gates.find(process);
-      if (it != gates.end()) {
-        gate = it->second;
-        // N.B. The last thread that leaves the gate also free's it.
-        gates.erase(it);
-      }
+    while (!process->events.empty()) {
+      Event* event = process->events.front();
+      process->events.pop_front();
+      delete event;
+    }
 
-      CHECK(process->refs == 0);
-      process->state = ProcessBase::FINISHED;
+    processes.erase(process->pid.id);
+ 
+    // Lookup gate to wake up waiting threads.
+    map<ProcessBase*, Gate*>::iterator it = gates.find(process);
+    if (it != gates.end()) {
+      gate = it->second;
+      // N.B. The last thread that leaves the gate also free's it.
+      gates.erase(it);
     }
-    process->unlock();
+
+    CHECK(process->refs == 0);
+    process->state = ProcessBase::FINISHED;
 
     // Note that we don't remove the process from the clock during
     // cleanup, but rather the clock is reset for a process when it is
@@ -2242,11 +2531,6 @@ void ProcessManager::cleanup(ProcessBase* process)
     socket_manager->exited(process);
   }
 
-  // Confirm process not in runq.
-  synchronized (runq) {
-    CHECK(find(runq.begin(), runq.end(), process) == runq.end());
-  }
-
   // ***************************************************************
   // At this point we can no longer dereference the process since it
   // might already be deallocated (e.g., by the garbage collector).
@@ -2328,19 +2612,24 @@ bool ProcessManager::wait(const UPID& pid)
       gate = gates[process];
       old = gate->approach();
 
-      // Check if it is runnable in order to donate this thread.
-      if (process->state == ProcessBase::BOTTOM ||
-          process->state == ProcessBase::READY) {
-        synchronized (runq) {
-          list<ProcessBase*>::iterator it =
-            find(runq.begin(), runq.end(), process);
-          if (it != runq.end()) {
-            runq.erase(it);
+      // Check if it is runnable in order to donate this thread. The
+      // process is on the run queue it was last queued on, if at all.
+      if ((process->state == ProcessBase::BOTTOM ||
+           process->state == ProcessBase::READY) &&
+          process->runq != -1) {
+        RunQueue* queue = runqs[process->runq];
+        queue->lock();
+        {
+          deque<ProcessBase*>::iterator it =
+            find(queue->processes.begin(), queue->processes.end(), process);
+          if (it != queue->processes.end()) {
+            queue->processes.erase(it);
           } else {
             // Another thread has resumed the process ...
             process = NULL;
           }
         }
+        queue->unlock();
       } else {
         // Process is not runnable, so no need to donate ...
         process = NULL;
@@ -2378,39 +2667,110 @@ void ProcessManager::enqueue(ProcessBase* process)
 {
   CHECK(process != NULL);
 
-  // TODO(benh): Check and see if this process has it's own thread. If
-  // it does, push it on that threads runq, and wake up that thread if
-  // it's not running. Otherwise, check and see which thread this
-  // process was last running on, and put it on that threads runq.
+  // Put the process on the run queue of the thread it last ran on, so
+  // that it tends to stay on one thread (and its caches). A process
+  // that has not run yet goes on the queue of the thread that queues
+  // it, or, if that is not a processing thread, on the next queue in
+  // turn.
+  if (process->runq == -1) {
+    if (__runq__ != NULL) {
+      process->runq = __runq__->index;
+    } else {
+      process->runq = __sync_fetch_and_add(&next, 1) % runqs.size();
+    }
+  }
 
-  synchronized (runq) {
-    CHECK(find(runq.begin(), runq.end(), process) == runq.end());
-    runq.push_back(process);
+  RunQueue* queue = runqs[process->runq];
+  queue->lock();
+  {
+    queue->processes.push_back(process);
   }
-    
-  // Wake up the processing thread if necessary.
+  queue->unlock();
+
+  // Wake up the processing threads if necessary (any of them can
+  // steal the process).
   gate->open();
 }
 
 
 ProcessBase* ProcessManager::dequeue()
 {
-  // TODO(benh): Remove a process from this thread's runq. If there
-  // are no processes to run, and this is not a dedicated thread, then
-  // steal one from another threads runq.
+  RunQueue* queue = __runq__;
+  CHECK(queue != NULL) << "Dequeue from a non-processing thread";
+
+  ProcessBase* process = dequeue(queue, false);
 
+  if (process != NULL) {
+    queue->dequeued++;
+    return process;
+  }
+
+  // Steal from the other threads, starting with the next one.
+  for (size_t i = 1; process == NULL && i < runqs.size(); i++) {
+    process = dequeue(runqs[(queue->index + i) % runqs.size()], true);
+  }
+
+  if (process != NULL) {
+    queue->stolen++;
+  }
+
+  return process;
+}
+
+
+void ProcessManager::drain(ProcessBase* process)
+{
+  Event* event = __sync_lock_test_and_set(&process->mailbox, (Event*) NULL);
+
+  CHECK(event != BLOCKED_MAILBOX && event != CLOSED_MAILBOX);
+
+  // Reverse the events so that they are oldest first.
+  Event* events = NULL;
+  while (event != NULL) {
+    Event* next = event->next;
+    event->next = events;
+    events = event;
+    event = next;
+  }
+
+  // Injected events go in front of all the events received before
+  // them, the rest go at the back.
+  while (events != NULL) {
+    event = events;
+    events = events->next;
+    event->next = NULL;
+    if (!event->injected) {
+      process->events.push_back(event);
+    } else {
+      process->events.push_front(event);
+    }
+  }
+
+  process->maxQueued = max(process->maxQueued, process->events.size());
+}
+
+
+ProcessBase* ProcessManager::dequeue(RunQueue* queue, bool steal)
+{
   ProcessBase* process = NULL;
 
-  synchronized (runq) {
-    if (!runq.empty()) {
-      process = runq.front();
-      runq.pop_front();
+  queue->lock();
+  {
+    if (!queue->processes.empty()) {
+      if (!steal) {
+        process = queue->processes.front();
+        queue->processes.pop_front();
+      } else {
+        process = queue->processes.back();
+        queue->processes.pop_back();
+      }
       // Increment the running count of processes in order to support
       // the Clock::settle() operation (this must be done atomically
       // with removing the process from the runq).
       __sync_fetch_and_add(&running, 1);
     }
   }
+  queue->unlock();
 
   return process;
 }
@@ -2422,13 +2782,19 @@ void ProcessManager::settle()
   do {
     usleep(10000);
     done = true;
-    // Hopefully this is the only place we acquire both these locks.
-    synchronized (runq) {
+    // Hopefully this is the only place we acquire the run queue locks
+    // and the timeouts lock together.
+    foreach (RunQueue* queue, runqs) {
+      queue->lock();
+    }
+    {
       synchronized (timeouts) {
         CHECK(Clock::paused()); // Since another thread could resume the clock!
 
-        if (!runq.empty()) {
-          done = false;
+        foreach (RunQueue* queue, runqs) {
+          if (!queue->processes.empty()) {
+            done = false;
+          }
         }
 
         __sync_synchronize(); // Read barrier for 'running'.
@@ -2436,8 +2802,7 @@ void ProcessManager::settle()
           done = false;
         }
 
-        if (timeouts->size() > 0 &&
-            timeouts->begin()->first <= clock::current) {
+        if (timeouts->next() <= clock::current) {
           done = false;
         }
 
@@ -2446,10 +2811,41 @@ void ProcessManager::settle()
         }
       }
     }
+    foreach (RunQueue* queue, runqs) {
+      queue->unlock();
+    }
   } while (!done);
 }
 
 
+string ProcessManager::stats()
+{
+  std::ostringstream out;
+
+  out << "[";
+
+  // Processes only get deallocated after they have been removed from
+  // 'processes', so it's safe to read their statistics here (even if
+  // the values might be slightly stale).
+  synchronized (processes) {
+    bool first = true;
+    foreachvalue (ProcessBase* process, processes) {
+      out << (first ? "" : ",")
+          << "{\"id\":\"" << process->pid.id << "\""
+          << ",\"served\":" << process->served
+          << ",\"busy_secs\":" << process->busy
+          << ",\"max_queued\":" << process->maxQueued
+          << "}";
+      first = false;
+    }
+  }
+
+  out << "]";
+
+  return out.str();
+}
+
+
 namespace timers {
 
 Timer create(double secs, const lambda::function<void(void)>& thunk)
@@ -2467,16 +2863,12 @@ Timer create(double secs, const lambda::function<void(void)>& thunk)
 
   // Add the timer.
   synchronized (timeouts) {
-    if (timeouts->size() == 0 ||
-        timer.timeout().value() < timeouts->begin()->first) {
+    timeouts->insert(timer, Clock::now(NULL));
+    if (timer.timeout().value() < armed) {
       // Need to interrupt the loop to update/set timer repeat.
-      (*timeouts)[timer.timeout().value()].push_back(timer);
+      armed = timer.timeout().value();
       update_timer = true;
       ev_async_send(loop, &async_watcher);
-    } else {
-      // Timer repeat is adequate, just add the timeout.
-      CHECK(timeouts->size() >= 1);
-      (*timeouts)[timer.timeout().value()].push_back(timer);
     }
   }
 
@@ -2488,16 +2880,8 @@ bool cancel(const Timer& timer)
 {
   bool canceled = false;
   synchronized (timeouts) {
-    // Check if the timeout is still pending, and if so, erase it. In
-    // addition, erase an empty list if we just removed the last
-    // timeout.
-    if (timeouts->count(timer.timeout().value()) > 0) {
-      canceled = true;
-      (*timeouts)[timer.timeout().value()].remove(timer);
-      if ((*timeouts)[timer.timeout().value()].empty()) {
-        timeouts->erase(timer.timeout().value());
-      }
-    }
+    // Erase the timer if it is still pending.
+    canceled = timeouts->cancel(timer);
   }
 
   return canceled;
@@ -2512,10 +2896,16 @@ ProcessBase::ProcessBase(const std::string& _id)
 
   state = ProcessBase::BOTTOM;
 
-  pthread_mutex_init(&m, NULL);
+  mailbox = NULL;
 
   refs = 0;
 
+  runq = -1;
+
+  served = 0;
+  busy = 0.0;
+  maxQueued = 0;
+
   if (_id != "") {
     pid.id = _id;
   } else {
@@ -2594,28 +2984,27 @@ void ProcessBase::enqueue(Event* event, bool inject)
     }
   }
 
-  lock();
-  {
-    if (state != FINISHED) {
-      if (!inject) {
-        events.push_back(event);
-      } else {
-        events.push_front(event);
-      }
+  event->injected = inject;
 
-      if (state == BLOCKED) {
-        state = READY;
-        process_manager->enqueue(this);
-      }
-
-      CHECK(state == BOTTOM ||
-            state == READY ||
-            state == RUNNING);
-    } else {
+  // Push the event onto the mailbox without locking (unless the
+  // process has finished, in which case we just drop the event).
+  Event* head;
+  do {
+    head = mailbox;
+    if (head == CLOSED_MAILBOX) {
       delete event;
+      return;
     }
+    event->next = head != BLOCKED_MAILBOX ? head : NULL;
+  } while (!__sync_bool_compare_and_swap(&mailbox, head, event));
+
+  // If the process was blocked waiting for events we're the only
+  // thread that will queue it to get resumed. Otherwise the process
+  // might already have finished so we can't dereference it anymore.
+  if (head == BLOCKED_MAILBOX) {
+    state = READY;
+    process_manager->enqueue(this);
   }
-  unlock();
 }
 
 
@@ -7,6 +7,7 @@
 
 #include <string>
 #include <sstream>
+#include <vector>
 
 #include <process/collect.hpp>
 #include <process/clock.hpp>
@@ -491,6 +492,75 @@ TEST(libprocess, order)
 }
 
 
+static void timedout(std::vector<int>* fired, int i)
+{
+  fired->push_back(i);
+}
+
+
+TEST(libprocess, timers)
+{
+  ASSERT_TRUE(GTEST_IS_THREADSAFE);
+
+  Clock::pause();
+
+  // Timers are invoked one after another by the event loop, so we
+  // can record them without any synchronization.
+  std::vector<int> fired;
+
+  // Create timers out to a couple of days, which exercises every
+  // level of the timer wheel, and cancel every third one.
+  std::vector<Timer> timers;
+  for (int i = 0; i < 300; i++) {
+    double secs = (300 - i) * (i % 2 == 0 ? 0.001 : 600.0);
+    timers.push_back(
+        timers::create(secs, std::tr1::bind(&timedout, &fired, i)));
+  }
+
+  for (int i = 0; i < 300; i += 3) {
+    EXPECT_TRUE(timers::cancel(timers[i]));
+    EXPECT_FALSE(timers::cancel(timers[i]));
+  }
+
+  // Only the short timers should fire, in order of their timeouts.
+  Clock::advance(1.0);
+  Clock::settle();
+
+  std::vector<int> expected;
+  for (int i = 298; i >= 0; i -= 2) {
+    if (i % 3 != 0) {
+      expected.push_back(i);
+    }
+  }
+
+  EXPECT_EQ(expected, fired);
+
+  for (int i = 1; i < 300; i += 2) {
+    if (i % 3 != 0) {
+      EXPECT_TRUE(timers::cancel(timers[i]));
+      break;
+    }
+  }
+
+  // Now advance past the long timers in increments (minus the one
+  // we just canceled).
+  for (int i = 0; i < 24 * 3; i++) {
+    Clock::advance(60.0 * 60.0);
+    Clock::settle();
+  }
+
+  for (int i = 299; i > 1; i -= 2) {
+    if (i % 3 != 0) {
+      expected.push_back(i);
+    }
+  }
+
+  EXPECT_EQ(expected, fired);
+
+  Clock::resume();
+}
+
+
 class DonateProcess : public Process<DonateProcess>
 {
 public:
@@ -661,6 +731,138 @@ TEST(libprocess, settle)
 }
 
 
+class CountProcess : public Process<CountProcess>
+{
+public:
+  CountProcess() : count(0) {}
+
+  int increment()
+  {
+    return ++count;
+  }
+
+private:
+  int count;
+};
+
+
+TEST(libprocess, runqueues)
+{
+  ASSERT_TRUE(GTEST_IS_THREADSAFE);
+
+  // Spawn more processes than there are processing threads so that
+  // they get spread across (and stolen between) the run queues.
+  const int PROCESSES = 32;
+  const int DISPATCHES = 100;
+
+  CountProcess processes[PROCESSES];
+
+  for (int i = 0; i < PROCESSES; i++) {
+    spawn(processes[i]);
+  }
+
+  std::list<Future<int> > futures;
+
+  for (int j = 0; j < DISPATCHES; j++) {
+    for (int i = 0; i < PROCESSES; i++) {
+      futures.push_back(dispatch(processes[i], &CountProcess::increment));
+    }
+  }
+
+  // Each process has served its dispatches in order.
+  int dispatched = 0;
+  std::list<Future<int> >::iterator it = futures.begin();
+  for (; it != futures.end(); ++it, ++dispatched) {
+    ASSERT_TRUE(it->await(5.0));
+    EXPECT_EQ(dispatched / PROCESSES + 1, it->get());
+  }
+
+  for (int i = 0; i < PROCESSES; i++) {
+    terminate(processes[i]);
+    wait(processes[i]);
+  }
+}
+
+
+class SequenceProcess : public Process<SequenceProcess>
+{
+public:
+  SequenceProcess() : ordered(true)
+  {
+    for (int i = 0; i < PRODUCERS; i++) {
+      sequences[i] = 0;
+    }
+  }
+
+  void receive(int producer, int sequence)
+  {
+    ordered = ordered && sequences[producer] + 1 == sequence;
+    sequences[producer] = sequence;
+  }
+
+  bool done()
+  {
+    return ordered;
+  }
+
+  static const int PRODUCERS = 4;
+  static const int EVENTS = 10000;
+
+private:
+  int sequences[PRODUCERS];
+  bool ordered;
+};
+
+
+struct Producer
+{
+  PID<SequenceProcess> pid;
+  int index;
+};
+
+
+void* produce(void* arg)
+{
+  Producer* producer = (Producer*) arg;
+  for (int i = 1; i <= SequenceProcess::EVENTS; i++) {
+    dispatch(producer->pid, &SequenceProcess::receive, producer->index, i);
+  }
+  return NULL;
+}
+
+
+TEST(libprocess, mailbox)
+{
+  ASSERT_TRUE(GTEST_IS_THREADSAFE);
+
+  SequenceProcess process;
+  spawn(process);
+
+  // Have multiple threads enqueue events concurrently, each of which
+  // should be received in the order it was sent.
+  Producer producers[SequenceProcess::PRODUCERS];
+  pthread_t threads[SequenceProcess::PRODUCERS];
+
+  for (int i = 0; i < SequenceProcess::PRODUCERS; i++) {
+    producers[i].pid = process.self();
+    producers[i].index = i;
+    ASSERT_EQ(0, pthread_create(&threads[i], NULL, produce, &producers[i]));
+  }
+
+  for (int i = 0; i < SequenceProcess::PRODUCERS; i++) {
+    ASSERT_EQ(0, pthread_join(threads[i], NULL));
+  }
+
+  Future<bool> ordered = dispatch(process, &SequenceProcess::done);
+
+  ASSERT_TRUE(ordered.await(5.0));
+  EXPECT_TRUE(ordered.get());
+
+  terminate(process);
+  wait(process);
+}
+
+
 // #define ENUMERATE1(item) item##1
 // #define ENUMERATE2(item) ENUMERATE1(item), item##2
 // #define ENUMERATE3(item) ENUMERATE2(item), item##3
@@ -912,6 +1114,71 @@ TEST(libprocess, http)
 }
 
 
+// Reads the response to an HTTP request for the path of a process,
+// given that the response body ends in "]}".
+static void request(
+    int s,
+    const UPID& pid,
+    const std::string& path,
+    std::string* response)
+{
+  std::ostringstream out;
+
+  out << "GET /" << pid.id << "/" << path
+      << " HTTP/1.0\r\n"
+      << "Connection: Keep-Alive\r\n"
+      << "\r\n";
+
+  const std::string& data = out.str();
+
+  ASSERT_EQ(data.size(), write(s, data.data(), data.size()));
+
+  response->clear();
+  while (response->find("]}") == std::string::npos) {
+    char temp[1024];
+    ssize_t length = read(s, temp, sizeof(temp));
+    ASSERT_LT(0, length);
+    response->append(temp, length);
+  }
+}
+
+
+TEST(libprocess, workers)
+{
+  ASSERT_TRUE(GTEST_IS_THREADSAFE);
+
+  // The workers process runs at the same address as any other.
+  ProcessBase process;
+  UPID pid("__workers__", process.self().ip, process.self().port);
+
+  int s = socket(AF_INET, SOCK_STREAM, IPPROTO_IP);
+
+  ASSERT_LE(0, s);
+
+  sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = PF_INET;
+  addr.sin_port = htons(pid.port);
+  addr.sin_addr.s_addr = pid.ip;
+
+  ASSERT_EQ(0, connect(s, (sockaddr*) &addr, sizeof(addr)));
+
+  std::string response;
+
+  ASSERT_NO_FATAL_FAILURE(request(s, pid, "stats.json", &response));
+
+  EXPECT_EQ(0, response.find("HTTP/1.1 200 OK"));
+  EXPECT_NE(std::string::npos, response.find("\"threads\":[{\"index\":0,"));
+
+  ASSERT_NO_FATAL_FAILURE(request(s, pid, "processes.json", &response));
+
+  EXPECT_EQ(0, response.find("HTTP/1.1 200 OK"));
+  EXPECT_NE(std::string::npos, response.find("{\"id\":\"__workers__\","));
+
+  ASSERT_EQ(0, close(s));
+}
+
+
 int main(int argc, char** argv)
 {
   // Initialize Google Mock/Test.
@@ -0,0 +1,300 @@
+#ifndef __TIMER_WHEEL_HPP__
+#define __TIMER_WHEEL_HPP__
+
+#include <stdint.h>
+
+#include <cmath>
+#include <limits>
+#include <list>
+
+#include <tr1/unordered_map>
+
+#include <process/timer.hpp>
+
+namespace process {
+
+// Hierarchical timing wheel of pending timers (see Varghese and
+// Lauck, "Hashed and Hierarchical Timing Wheels"). Time is divided
+// into ticks of 1/1024th of a second (a power of two so that
+// converting between ticks and seconds is exact). The first level has
+// a slot for each of the next 256 ticks, and each of the next four
+// levels has 64 slots, each slot covering 64 times as many ticks as a
+// slot of the level below (for a total of 2^32 ticks, about 48 days).
+// A timer further out than that goes in the last slot it fits in and
+// gets placed again once that slot is reached.
+//
+// Whenever the current tick crosses into the ticks covered by a slot
+// of a higher level, the timers in that slot get "cascaded" into the
+// levels below. Thus inserting and canceling a timer take constant
+// time, and a timer is moved at most once per level.
+//
+// Not thread-safe (libprocess protects it with the timeouts lock).
+class TimerWheel
+{
+public:
+  TimerWheel() : tick(0)
+  {
+    for (int level = 0; level < LEVELS; level++) {
+      counts[level] = 0;
+    }
+  }
+
+  bool empty() const
+  {
+    return locations.empty();
+  }
+
+  size_t size() const
+  {
+    return locations.size();
+  }
+
+  // Adds a timer given the current time.
+  void insert(const Timer& timer, double now)
+  {
+    // Without any timers we can just start from the current tick.
+    if (empty()) {
+      tick = ticks(now);
+    }
+
+    place(timer, slots[0].end(), slots[0]);
+  }
+
+  // Removes a timer, returns false if the timer wasn't pending.
+  bool cancel(const Timer& timer)
+  {
+    Locations::iterator location = locations.find(timer.id);
+    if (location == locations.end()) {
+      return false;
+    }
+
+    int slot = location->second.slot;
+    counts[level(slot)]--;
+    slots[slot].erase(location->second.timer);
+    locations.erase(location);
+    return true;
+  }
+
+  // Advances the wheel to the current time, removing and returning
+  // the timers that have timed out (in order of their timeouts).
+  std::list<Timer> advance(double now)
+  {
+    std::list<Timer> timedout;
+
+    const uint64_t until = ticks(now);
+
+    while (!empty()) {
+      // Time out the timers in the slot of the current tick (only
+      // some of them might be due if that is the tick of 'now').
+      std::list<Timer>& slot = slots[tick & (SLOTS0 - 1)];
+      std::list<Timer>::iterator timer = slot.begin();
+      while (timer != slot.end()) {
+        if (timer->timeout().value() <= now) {
+          counts[0]--;
+          locations.erase(timer->id);
+          timedout.splice(timedout.end(), slot, timer++);
+        } else {
+          ++timer;
+        }
+      }
+
+      if (tick >= until) {
+        break;
+      }
+
+      // Move on to the next tick, or skip ahead to the next tick
+      // where a level needs to be cascaded if the levels below it
+      // have no timers.
+      int level = 0;
+      while (level < LEVELS - 1 && counts[level] == 0) {
+        level++;
+      }
+
+      const uint64_t next = ((tick >> shift(level)) + 1) << shift(level);
+
+      tick = std::min(next, until);
+
+      // Cascade the slots of the higher levels that the tick has now
+      // crossed into, the lowest level first (and a level only if
+      // the tick has wrapped around the one below).
+      if (tick == next && (tick & (SLOTS0 - 1)) == 0) {
+        for (int level = 1; level < LEVELS; level++) {
+          int index = (tick >> shift(level)) & (SLOTS - 1);
+          cascade(offset(level) + index);
+          if (index != 0) {
+            break;
+          }
+        }
+      }
+    }
+
+    // Without any timers left we can just continue from 'now'.
+    if (empty()) {
+      tick = until;
+    }
+
+    timedout.sort(earlier);
+
+    return timedout;
+  }
+
+  // Returns the earliest time a pending timer might time out (or
+  // infinity if there are none). This is exact for timers in the
+  // first level, and otherwise the time the tick crosses into the
+  // slot of a higher level (i.e., when 'advance' would cascade it),
+  // which is no later than the timeouts of the timers in that slot.
+  double next() const
+  {
+    double next = std::numeric_limits<double>::infinity();
+
+    if (counts[0] > 0) {
+      for (int i = 0; i < SLOTS0; i++) {
+        const std::list<Timer>& slot = slots[(tick + i) & (SLOTS0 - 1)];
+        if (!slot.empty()) {
+          for (std::list<Timer>::const_iterator timer = slot.begin();
+               timer != slot.end();
+               ++timer) {
+            next = std::min(next, timer->timeout().value());
+          }
+          break;
+        }
+      }
+    }
+
+    for (int level = 1; level < LEVELS; level++) {
+      if (counts[level] > 0) {
+        const uint64_t current = tick >> shift(level);
+        for (int i = 1; i <= SLOTS; i++) {
+          int index = (current + i) & (SLOTS - 1);
+          if (!slots[offset(level) + index].empty()) {
+            next = std::min(next, seconds((current + i) << shift(level)));
+            break;
+          }
+        }
+      }
+    }
+
+    return next;
+  }
+
+private:
+  enum {
+    TICKS_PER_SECOND = 1024,
+    LEVELS = 5,
+    SLOTS0 = 256, // Slots in the first level.
+    SLOTS = 64 // Slots in each of the higher levels.
+  };
+
+  // Location of a pending timer.
+  struct Location
+  {
+    int slot;
+    std::list<Timer>::iterator timer;
+  };
+
+  typedef std::tr1::unordered_map<uint64_t, Location> Locations;
+
+  static uint64_t ticks(double seconds)
+  {
+    return (uint64_t) floor(seconds * TICKS_PER_SECOND);
+  }
+
+  static double seconds(uint64_t ticks)
+  {
+    return (double) ticks / TICKS_PER_SECOND;
+  }
+
+  // Number of ticks (as a power of two) covered by a slot of a level.
+  static int shift(int level)
+  {
+    return level == 0 ? 0 : 8 + 6 * (level - 1);
+  }
+
+  // Index of the first slot of a level.
+  static int offset(int level)
+  {
+    return level == 0 ? 0 : SLOTS0 + SLOTS * (level - 1);
+  }
+
+  static int level(int slot)
+  {
+    return slot < SLOTS0 ? 0 : 1 + (slot - SLOTS0) / SLOTS;
+  }
+
+  static bool earlier(const Timer& left, const Timer& right)
+  {
+    return left.timeout().value() < right.timeout().value();
+  }
+
+  // Returns the slot for a timer timing out at the specified tick.
+  int slot(uint64_t t) const
+  {
+    // A timer that is already due goes in the slot of the current
+    // tick, and one too far out goes in the last slot it fits in.
+    if (t < tick) {
+      t = tick;
+    } else if (t - tick >= (1ULL << shift(LEVELS))) {
+      t = tick + (1ULL << shift(LEVELS)) - 1;
+    }
+
+    const uint64_t delta = t - tick;
+
+    if (delta < SLOTS0) {
+      return t & (SLOTS0 - 1);
+    }
+
+    int level = 1;
+    while (delta >= (1ULL << shift(level + 1))) {
+      level++;
+    }
+
+    return offset(level) + ((t >> shift(level)) & (SLOTS - 1));
+  }
+
+  // Moves the timer at 'position' in 'from' (or, if 'position' is the
+  // end of 'from', a copy of 'timer') to the slot it now belongs in.
+  void place(
+      const Timer& timer,
+      std::list<Timer>::iterator position,
+      std::list<Timer>& from)
+  {
+    int to = slot(ticks(timer.timeout().value()));
+
+    if (position == from.end()) {
+      slots[to].push_back(timer);
+    } else {
+      slots[to].splice(slots[to].end(), from, position);
+    }
+
+    Location location;
+    location.slot = to;
+    location.timer = --slots[to].end();
+    locations[timer.id] = location;
+
+    counts[level(to)]++;
+  }
+
+  // Places the timers of a slot again (relative to the current tick).
+  void cascade(int index)
+  {
+    std::list<Timer>& slot = slots[index];
+    counts[level(index)] -= slot.size();
+    while (!slot.empty()) {
+      place(slot.front(), slot.begin(), slot);
+    }
+  }
+
+  // Current tick, all earlier ticks have been advanced past.
+  uint64_t tick;
+
+  std::list<Timer> slots[SLOTS0 + SLOTS * (LEVELS - 1)];
+
+  // Number of timers in each level.
+  size_t counts[LEVELS];
+
+  Locations locations;
+};
+
+} // namespace process {
+
+#endif // __TIMER_WHEEL_HPP__